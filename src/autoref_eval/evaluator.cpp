@@ -0,0 +1,717 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Evaluation of automatic referees by comparison to the human referee.
+
+#include "autoref_eval/evaluator.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "autoref_eval/event_matcher.h"
+#include "autoref_eval/metrics.h"
+#include "autoref_eval/referee_event.h"
+#include "autoref_eval/vision_store.h"
+#include "autoref_eval/world_timeline.h"
+#include "referee.pb.h"
+#include "shared/log_index.h"
+#include "shared/log_reader.h"
+#include "shared/misc_util.h"
+#include "shared/trace.h"
+#include "shared/vision_decoder.h"
+#include "shared/wire_decoder.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+// UDP Multicast address for referees.
+static const char* kRefereeMulticast = "224.5.23.1";
+
+// UDP Multicast address for SSL Vision.
+static const char* kVisionMulticast = "224.5.23.2";
+
+// Port number for SSL Vision.
+static const int kVisionPort = 10006;
+
+// Port number for main refbox.
+static const int kRefboxPort = 10003;
+
+// Maximum age of the vision frames of the context of an event, in
+// microseconds.
+static const uint64_t kContextMaxAge = 100000;
+
+// Retention of the vision frames around the stop and event commands, whose
+// receive times are about the times of the contexts of the events, in
+// microseconds. It also allows for a stop command reported late, or with a
+// timestamp off from its receive time.
+static const uint64_t kContextRetention = 1000000;
+
+// Number of robots nearest to the ball in the context of an event.
+static const int kContextRobots = 3;
+
+// Time read before every window of a filtered log, in microseconds, to find
+// the stop commands before the first events of the window.
+static const uint64_t kFilterMargin = 30000000;
+
+// Longest time by which a record may be logged after records received later
+// than it, in microseconds.
+static const uint64_t kMaxLogReorder = 1000000;
+
+// Orders robots by their distance to a point.
+struct RobotDistanceLess {
+  RobotDistanceLess(float x, float y) : x(x), y(y) {}
+  bool operator()(const RobotSample& r1, const RobotSample& r2) const {
+    return ((r1.x - x) * (r1.x - x) + (r1.y - y) * (r1.y - y) <
+            (r2.x - x) * (r2.x - x) + (r2.y - y) * (r2.y - y));
+  }
+  const float x;
+  const float y;
+};
+
+// Comparison of a referee command with a command counter, to find commands by
+// their counters.
+bool CommandCounterLess(const RefereeView& command, uint32_t counter) {
+  return (command.command_counter < counter);
+}
+
+// Lexicographic order of the fields that operator!= compares for events.
+bool EventLess(const RefereeEvent& e1, const RefereeEvent& e2) {
+  if (e1.stop_timestamp != e2.stop_timestamp) {
+    return (e1.stop_timestamp < e2.stop_timestamp);
+  }
+  if (e1.command_timestamp != e2.command_timestamp) {
+    return (e1.command_timestamp < e2.command_timestamp);
+  }
+  if (e1.command_counter != e2.command_counter) {
+    return (e1.command_counter < e2.command_counter);
+  }
+  return (e1.command < e2.command);
+}
+
+// Lexicographic order of the fields that operator!= compares for
+// evaluations, to look up the annotations of evaluations.
+bool EvaluationLess(const EventEvaluation& e1, const EventEvaluation& e2) {
+  if (e1.value != e2.value) return (e1.value < e2.value);
+  if (e1.autoref_event != e2.autoref_event) {
+    return EventLess(e1.autoref_event, e2.autoref_event);
+  }
+  return EventLess(e1.humanref_event, e2.humanref_event);
+}
+
+// Read at most max_evaluations evaluations from an annotation file, until the
+// end of the file or the first invalid line.
+void ReadEvaluations(const string& evaluations_file,
+                     size_t max_evaluations,
+                     vector<EventEvaluation>* evaluations) {
+  evaluations->clear();
+  ScopedFile fid(evaluations_file, "r");
+  if (fid() == NULL) return;
+  for (int i = 0; i < max_evaluations; ++i) {
+    EventEvaluation eval;
+    int j = 0;
+    char value_string[32];
+    int ignore_int = 0;
+    int autoref_command_int = 0;
+    int humanref_command_int = 0;
+    const int num_read = 
+        fscanf(fid,
+               "%3d %2s %d "
+               "%"PRIu64" %"PRIu64" %"PRIu32" %d "
+               "%"PRIu64" %"PRIu64" %"PRIu32" %d\n",
+               &j,
+               value_string,
+               &ignore_int,
+               &(eval.autoref_event.stop_timestamp),
+               &(eval.autoref_event.command_timestamp),
+               &(eval.autoref_event.command_counter),
+               &(autoref_command_int),
+               &(eval.humanref_event.stop_timestamp),
+               &(eval.humanref_event.command_timestamp),
+               &(eval.humanref_event.command_counter),
+               &(humanref_command_int));
+    if (num_read != 11 || j != i) return;
+    if (strcmp(value_string, "TP") == 0) {
+      eval.value = EventEvaluation::kTruePositive;
+    } else if (strcmp(value_string, "FP") == 0) {
+      eval.value = EventEvaluation::kFalsePositive;
+    } else if (strcmp(value_string, "FN") == 0) {
+      eval.value = EventEvaluation::kFalseNegative;
+    }
+    if (ignore_int == 0) {
+      eval.ignore = false;
+    } else {
+      eval.ignore = true;
+    }
+    eval.autoref_event.command =
+        static_cast<SSL_Referee_Command>(autoref_command_int);
+    eval.humanref_event.command =
+        static_cast<SSL_Referee_Command>(humanref_command_int);
+    evaluations->push_back(eval);
+  }
+}
+
+bool LoadEvaluations(const string& evaluations_file,
+                     vector<EventEvaluation>* evaluations_ptr) {
+  vector<EventEvaluation>& evaluations = *evaluations_ptr;
+  // Human-annotated ignore flags, only applied if all evaluations match.
+  vector<EventEvaluation> annotations;
+  ReadEvaluations(evaluations_file, evaluations.size(), &annotations);
+  if (annotations.size() != evaluations.size()) return false;
+  for (int i = 0; i < evaluations.size(); ++i) {
+    if (annotations[i] != evaluations[i]) {
+      return false;
+    }
+  }
+  for (int i = 0; i < evaluations.size(); ++i) {
+    evaluations[i].ignore = annotations[i].ignore;
+  }
+  return true;
+}
+
+// Apply the human-annotated ignore flags of the evaluations of a whole log to
+// the evaluations of a part of it. Returns true iff every evaluation was
+// annotated.
+bool ApplyAnnotations(const string& evaluations_file,
+                      vector<EventEvaluation>* evaluations_ptr) {
+  vector<EventEvaluation>& evaluations = *evaluations_ptr;
+  vector<EventEvaluation> annotations;
+  ReadEvaluations(evaluations_file,
+                  std::numeric_limits<size_t>::max(),
+                  &annotations);
+  // The first annotation of equal ones in the file is applied.
+  std::stable_sort(annotations.begin(), annotations.end(), EvaluationLess);
+  // Evaluations at the boundaries of the parts may have been matched
+  // differently than in the whole log, and are then not annotated.
+  bool annotated = true;
+  for (int i = 0; i < evaluations.size(); ++i) {
+    vector<EventEvaluation>::const_iterator annotation = std::lower_bound(
+        annotations.begin(), annotations.end(), evaluations[i],
+        EvaluationLess);
+    if (annotation != annotations.end() &&
+        !(*annotation != evaluations[i])) {
+      evaluations[i].ignore = annotation->ignore;
+    } else {
+      annotated = false;
+    }
+  }
+  return annotated;
+}
+
+void SaveEvaluations(const string& evaluations_file,
+                     const vector<EventEvaluation>& evaluations) {
+  ScopedFile fid(evaluations_file, "w");
+  for (int i = 0; i < evaluations.size(); ++i) {
+    const EventEvaluation& eval = evaluations[i];
+    fprintf(fid,
+            "%3d %2s %d "
+            "%"PRIu64" %"PRIu64" %"PRIu32" %d "
+            "%"PRIu64" %"PRIu64" %"PRIu32" %d\n",
+            i,
+            eval.ValueString(),
+            (eval.ignore ? 1 : 0),
+            eval.autoref_event.stop_timestamp,
+            eval.autoref_event.command_timestamp,
+            eval.autoref_event.command_counter,
+            eval.autoref_event.command,
+            eval.humanref_event.stop_timestamp,
+            eval.humanref_event.command_timestamp,
+            eval.humanref_event.command_counter,
+            eval.humanref_event.command);
+  }
+}
+
+bool SummarizeEvaluation(uint64_t auto_to_human_delay,
+                         uint64_t human_to_auto_delay,
+                         AutorefEvaluation* autoref_evaluation) {
+  AutorefEvaluation& result = *autoref_evaluation;
+  const vector<EventEvaluation>& evaluations = result.evaluations;
+  // Timing of the true positives. False positives and false negatives that
+  // overlap in time are events that both referees called, with different
+  // commands.
+  GameEvaluation& game = result.game;
+  EventTiming& timing = result.timing;
+  game = GameEvaluation();
+  timing = EventTiming();
+  vector<RefereeEvent> missed_events;
+  vector<RefereeEvent> extra_events;
+  for (int i = 0; i < evaluations.size(); ++i) {
+    const EventEvaluation& evaluation = evaluations[i];
+    if (evaluation.ignore) continue;
+    game.values.push_back(evaluation.value);
+    switch (evaluation.value) {
+      case EventEvaluation::kTruePositive: {
+        ++game.true_positives;
+        const RefereeEvent& autoref = evaluation.autoref_event;
+        const RefereeEvent& human = evaluation.humanref_event;
+        const int command_class = ConfusionMatrix::Class(human.command);
+        timing.confusion.Add(command_class, command_class);
+        timing.command_delay.Add(
+            static_cast<int64_t>(autoref.command_timestamp) -
+            static_cast<int64_t>(human.command_timestamp));
+        if (autoref.stop_timestamp > 0 && human.stop_timestamp > 0) {
+          timing.stop_delay.Add(
+              static_cast<int64_t>(autoref.stop_timestamp) -
+              static_cast<int64_t>(human.stop_timestamp));
+        }
+      } break;
+      case EventEvaluation::kFalsePositive: {
+        ++game.false_positives;
+        extra_events.push_back(evaluation.autoref_event);
+      } break;
+      case EventEvaluation::kFalseNegative: {
+        ++game.false_negatives;
+        missed_events.push_back(evaluation.humanref_event);
+      } break;
+      default: {
+        // Should never happen.
+        fprintf(stderr,
+                "ERROR: Unknown evaluation %d for autoref %d, command %d\n",
+                evaluation.value,
+                result.port,
+                i);
+        return false;
+      }
+    }
+  }
+  vector<EventEvaluation> mismatches;
+  EventMatcher(missed_events, extra_events, false).Match(
+      auto_to_human_delay, human_to_auto_delay, &mismatches);
+  for (int i = 0; i < mismatches.size(); ++i) {
+    timing.confusion.Add(
+        ConfusionMatrix::Class(mismatches[i].humanref_event.command),
+        ConfusionMatrix::Class(mismatches[i].autoref_event.command));
+  }
+  return true;
+}
+
+// Returns true iff the command is that of an event.
+bool IsEventCommand(int command) {
+  switch (command) {
+    case SSL_Referee_Command_DIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_DIRECT_FREE_BLUE:
+    case SSL_Referee_Command_INDIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_INDIRECT_FREE_BLUE:
+    case SSL_Referee_Command_GOAL_YELLOW:
+    case SSL_Referee_Command_GOAL_BLUE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void ExtractEvents(const vector<RefereeView>& commands,
+                   vector<RefereeEvent>* events,
+                   vector<int>* command_indices) {
+  events->clear();
+  if (command_indices != NULL) command_indices->clear();
+  uint64_t t_last_stop = 0;
+  for (int j = 0; j < commands.size(); ++j) {
+    const RefereeView& command = commands[j];
+    switch (command.command) {
+      case SSL_Referee_Command_STOP: {
+        t_last_stop = command.command_timestamp;
+      } break;
+
+      case SSL_Referee_Command_DIRECT_FREE_YELLOW:
+      case SSL_Referee_Command_DIRECT_FREE_BLUE:
+      case SSL_Referee_Command_INDIRECT_FREE_YELLOW:
+      case SSL_Referee_Command_INDIRECT_FREE_BLUE:
+      case SSL_Referee_Command_GOAL_YELLOW:
+      case SSL_Referee_Command_GOAL_BLUE: {
+        events->push_back(
+            RefereeEvent(t_last_stop,
+                         command.command_timestamp,
+                         command.command_counter,
+                         command.command));
+        if (command_indices != NULL) command_indices->push_back(j);
+        t_last_stop = 0;
+      } break;
+
+      default: {
+        // Ignore this command.
+      }
+    }
+  }
+}
+
+const uint64_t Evaluator::kDefaultAutoToHumanDelay;
+const uint64_t Evaluator::kDefaultHumanToAutoDelay;
+
+Evaluator::Evaluator() :
+    auto_to_human_delay_(kDefaultAutoToHumanDelay),
+    human_to_auto_delay_(kDefaultHumanToAutoDelay),
+    use_annotations_(true),
+    load_vision_(false),
+    has_geometry_(false) {}
+
+string Evaluator::AnnotationFile(int i) const {
+  return StringPrintf("%s.%d.eval", log_file_.c_str(), i);
+}
+
+uint64_t Evaluator::ParametersHash() const {
+  // Version of the evaluation, to be incremented whenever it changes the
+  // results for the same parameters.
+  static const int kVersion = 1;
+  string parameters = StringPrintf(
+      "version=%d a2h=%" PRIu64 " h2a=%" PRIu64 " annotations=%d",
+      kVersion,
+      auto_to_human_delay_,
+      human_to_auto_delay_,
+      use_annotations_ ? 1 : 0);
+  // Only the filtered evaluations depend on the filter, so that the hash of
+  // the unfiltered evaluations does not change.
+  string filter;
+  for (int i = 0; i < filter_.stages.size(); ++i) {
+    filter += StringPrintf(" stage=%d", filter_.stages[i]);
+  }
+  if (filter_.has_time_window) {
+    filter += StringPrintf(" %s=%" PRIu64 ":%" PRIu64,
+                           filter_.relative_time ? "time" : "abstime",
+                           filter_.begin,
+                           filter_.end);
+  }
+  parameters += filter;
+  return Hash64(parameters.data(), parameters.size());
+}
+
+void Evaluator::SetDelays(uint64_t auto_to_human_delay,
+                          uint64_t human_to_auto_delay) {
+  auto_to_human_delay_ = auto_to_human_delay;
+  human_to_auto_delay_ = human_to_auto_delay;
+}
+
+void Evaluator::FindWindows(const LogIndex& index,
+                           vector<TimeWindow>* windows) const {
+  windows->assign(
+      1, TimeWindow(index.first_timestamp(), index.last_timestamp() + 1));
+  vector<TimeWindow> selected;
+  if (filter_.has_time_window) {
+    TimeWindow time_window(filter_.begin, filter_.end);
+    if (filter_.relative_time) {
+      const uint64_t t0 = index.first_timestamp();
+      const uint64_t kMax = std::numeric_limits<uint64_t>::max();
+      time_window.begin = std::min(filter_.begin, kMax - t0) + t0;
+      time_window.end = std::min(filter_.end, kMax - t0) + t0;
+    }
+    IntersectWindows(*windows, vector<TimeWindow>(1, time_window), &selected);
+    windows->swap(selected);
+  }
+  if (!filter_.stages.empty()) {
+    vector<TimeWindow> stage_windows;
+    index.FindStageWindows(filter_.stages, &stage_windows);
+    IntersectWindows(*windows, stage_windows, &selected);
+    windows->swap(selected);
+  }
+}
+
+bool Evaluator::IsSelected(uint64_t t) const {
+  if (!filter_.IsSet()) return true;
+  for (int i = 0; i < windows_.size(); ++i) {
+    if (windows_[i].Contains(t)) return true;
+  }
+  return false;
+}
+
+bool Evaluator::Load(const string& log_file) {
+  TRACE_SCOPE("load");
+  LogReader reader;
+  if (!reader.Open(log_file)) {
+    return false;
+  }
+  log_file_ = log_file;
+  // Initialize map, and commands to only track human refbox first, to ensure
+  // that it will correspond to the first entry in referees_.
+  referees_.clear();
+  referee_map_.clear();
+  vision_.Clear();
+  vision_.SetRetention(kContextRetention);
+  geometry_.Clear();
+  has_geometry_ = false;
+  windows_.clear();
+  referees_.resize(1);
+  referees_[0].port = kRefboxPort;
+  referee_map_[kRefboxPort] = 0;
+
+  // Windows of the log to read, and the file offsets to read them from.
+  // Without a filter, the whole log is read from the start.
+  LogIndex index;
+  vector<TimeWindow> read_windows(
+      1, TimeWindow(0, std::numeric_limits<uint64_t>::max()));
+  if (filter_.IsSet()) {
+    if (!index.Open(log_file)) return false;
+    FindWindows(index, &windows_);
+    read_windows.clear();
+    for (int i = 0; i < windows_.size(); ++i) {
+      // Also read the margin before the window, without overlapping the
+      // previous window, for the stop commands before the first events.
+      uint64_t begin = (windows_[i].begin > kFilterMargin) ?
+          (windows_[i].begin - kFilterMargin) : 0;
+      if (!read_windows.empty()) {
+        begin = std::max(begin, read_windows.back().end);
+      }
+      read_windows.push_back(TimeWindow(begin, windows_[i].end));
+    }
+  }
+
+  RefereeView referee_message;
+  VisionDecoder vision_decoder;
+  for (int i = 0; i < read_windows.size(); ++i) {
+    const TimeWindow& window = read_windows[i];
+    if (filter_.IsSet() && !reader.Seek(index.FindOffset(window.begin))) {
+      perror(("Error reading \"" + log_file + "\"").c_str());
+      return false;
+    }
+    while (reader.ReadRecord()) {
+      TRACE_SCOPE("parse");
+      EnvelopeView envelope;
+      if (!DecodeEnvelope(reader.record(), reader.record_size(), &envelope)) {
+        continue;
+      }
+      if (envelope.timestamp >= window.end) {
+        // The receive timestamps of the log are not quite in order, read on
+        // for records of the window logged after later ones.
+        if (envelope.timestamp - window.end >= kMaxLogReorder) break;
+        continue;
+      }
+      if (envelope.timestamp < window.begin) continue;
+      if (load_vision_ &&
+          envelope.port == kVisionPort &&
+          envelope.AddressIs(kVisionMulticast)) {
+        if (vision_decoder.Decode(envelope.data, envelope.data_size) &&
+            vision_decoder.has_detection()) {
+          vision_.AddFrame(vision_decoder.detection(), envelope.timestamp);
+        }
+        continue;
+      }
+      // Only the fields identifying the commands are decoded, the team
+      // infos are not needed.
+      if (!envelope.AddressIs(kRefereeMulticast) ||
+          !DecodeReferee(envelope.data, envelope.data_size,
+                         &referee_message)) {
+        continue;
+      }
+      const uint16_t port = envelope.port;
+      map<uint16_t, int>::iterator it = referee_map_.find(port);
+      if (it == referee_map_.end()) {
+        // This referee has not bee seen before, allocate space for it.
+        it = referee_map_.insert(
+            std::make_pair(port, referees_.size())).first;
+        referees_.push_back(RefereeLog());
+        referees_.back().port = port;
+      }
+      RefereeLog& referee = referees_[it->second];
+      vector<RefereeView>& commands = referee.commands;
+      if (commands.size() == 0 ||
+          commands.back().command_counter <
+              referee_message.command_counter) {
+        commands.push_back(referee_message);
+        referee.receive_timestamps.push_back(envelope.timestamp);
+        TRACE_COUNTER("commands", commands.size());
+        // The context of an event is at its stop command, or at the event
+        // command if there was none.
+        if (load_vision_ &&
+            (referee_message.command == SSL_Referee_Command_STOP ||
+             IsEventCommand(referee_message.command))) {
+          vision_.Keep(envelope.timestamp);
+        }
+      }
+    }
+  }
+  vision_.Finish();
+
+  if (vision_decoder.has_geometry()) {
+    geometry_.CopyFrom(vision_decoder.geometry());
+    has_geometry_ = true;
+  }
+
+  // Index the events of every referee, that were received in the windows of
+  // the filter.
+  TRACE_SCOPE("index");
+  vector<int> command_indices;
+  for (int i = 0; i < referees_.size(); ++i) {
+    vector<RefereeEvent>& events = referees_[i].events;
+    ExtractEvents(referees_[i].commands, &events, &command_indices);
+    int num_selected = 0;
+    for (int j = 0; j < events.size(); ++j) {
+      if (IsSelected(referees_[i].receive_timestamps[command_indices[j]])) {
+        events[num_selected] = events[j];
+        ++num_selected;
+      }
+    }
+    events.resize(num_selected);
+  }
+  return true;
+}
+
+bool Evaluator::Evaluate(vector<AutorefEvaluation>* evaluations) const {
+  TRACE_SCOPE("evaluate");
+  evaluations->clear();
+  if (referees_.empty() || referees_[0].events.empty()) {
+    fprintf(stderr, "ERROR: No human referee events found!\n");
+    return false;
+  }
+  evaluations->resize(referees_.size() - 1);
+  for (int i = 1; i < referees_.size(); ++i) {
+    if (!EvaluateAutoref(i, &((*evaluations)[i - 1]))) {
+      evaluations->clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Evaluator::EvaluateAutoref(int ref_id,
+                                AutorefEvaluation* autoref_evaluation) const {
+  AutorefEvaluation& result = *autoref_evaluation;
+  vector<EventEvaluation>& evaluations = result.evaluations;
+  {
+    TRACE_SCOPE("match");
+    const EventMatcher matcher(referees_[0].events, referees_[ref_id].events);
+    matcher.Match(auto_to_human_delay_, human_to_auto_delay_, &evaluations);
+  }
+  result.port = referees_[ref_id].port;
+  result.annotated = false;
+
+  // Merge evaluations with possible human correction.
+  if (use_annotations_ && filter_.IsSet()) {
+    // Only parts of the log were evaluated, do not overwrite the evaluations
+    // of the whole log.
+    const string evaluations_file_name = AnnotationFile(ref_id);
+    result.annotated = FileExists(evaluations_file_name) &&
+        ApplyAnnotations(evaluations_file_name, &evaluations);
+  } else if (use_annotations_) {
+    const string evaluations_file_name = AnnotationFile(ref_id);
+    if (FileExists(evaluations_file_name) &&
+        LoadEvaluations(evaluations_file_name, &evaluations)) {
+      // Human-annotated evaluations exist, and are consistent.
+      result.annotated = true;
+    } else {
+      // Save the evaluations.
+      SaveEvaluations(evaluations_file_name, evaluations);
+    }
+  }
+
+  if (!SummarizeEvaluation(auto_to_human_delay_,
+                           human_to_auto_delay_,
+                           autoref_evaluation)) {
+    return false;
+  }
+
+  result.contexts.clear();
+  if (load_vision_) {
+    result.contexts.resize(evaluations.size());
+    for (int i = 0; i < evaluations.size(); ++i) {
+      FindContext(ref_id, evaluations[i], &(result.contexts[i]));
+    }
+  }
+  return true;
+}
+
+void Evaluator::FindContext(int ref_id,
+                            const EventEvaluation& evaluation,
+                            EventContext* context) const {
+  const bool is_autoref =
+      (evaluation.value == EventEvaluation::kFalsePositive);
+  const RefereeEvent& event =
+      is_autoref ? evaluation.autoref_event : evaluation.humanref_event;
+  const RefereeLog& referee = referees_[is_autoref ? ref_id : 0];
+  *context = EventContext();
+  // The command of the event, found by its command counter, which increases
+  // with every command of the referee.
+  const vector<RefereeView>::const_iterator command = std::lower_bound(
+      referee.commands.begin(), referee.commands.end(),
+      event.command_counter, CommandCounterLess);
+  if (command == referee.commands.end() ||
+      command->command_counter != event.command_counter) {
+    return;
+  }
+  context->t =
+      referee.receive_timestamps[command - referee.commands.begin()];
+  if (event.stop_timestamp > 0 &&
+      event.stop_timestamp <= event.command_timestamp) {
+    const uint64_t stop_to_command =
+        event.command_timestamp - event.stop_timestamp;
+    context->t -= std::min(context->t, stop_to_command);
+  }
+  // Fuse the cameras into a single world frame at the time of the event.
+  WorldTimeline world;
+  if (!world.Build(vision_, context->t, context->t, 1, kContextMaxAge)) {
+    return;
+  }
+  context->has_ball = world.GetBall(0, &(context->ball));
+  context->robots.clear();
+  if (context->has_ball) {
+    vector<RobotSample>& robots = context->robots;
+    world.GetRobots(0, &robots);
+    const size_t num_robots =
+        std::min(robots.size(), static_cast<size_t>(kContextRobots));
+    std::partial_sort(robots.begin(),
+                      robots.begin() + num_robots,
+                      robots.end(),
+                      RobotDistanceLess(context->ball.x, context->ball.y));
+    robots.resize(num_robots);
+  }
+}
+
+// The delays of a sweep range, in increasing order.
+void SweepDelays(const SweepRange& range, vector<uint64_t>* delays) {
+  delays->clear();
+  for (uint64_t delay = range.min; delay <= range.max; delay += range.step) {
+    delays->push_back(delay);
+    if (range.step == 0) break;
+  }
+}
+
+void Evaluator::Sweep(int ref_id,
+                      const SweepRange& auto_to_human,
+                      const SweepRange& human_to_auto,
+                      vector<SweepPoint>* points) const {
+  TRACE_SCOPE("match");
+  points->clear();
+  const vector<RefereeEvent>& human_referee = referees_[0].events;
+  const vector<RefereeEvent>& autoref = referees_[ref_id].events;
+  const EventMatcher matcher(human_referee, autoref);
+  vector<uint64_t> a2h_delays;
+  vector<uint64_t> h2a_delays;
+  SweepDelays(auto_to_human, &a2h_delays);
+  SweepDelays(human_to_auto, &h2a_delays);
+  vector<int> counts;
+  matcher.CountMatches(a2h_delays, h2a_delays, &counts);
+  for (size_t i = 0; i < a2h_delays.size(); ++i) {
+    for (size_t j = 0; j < h2a_delays.size(); ++j) {
+      SweepPoint point;
+      point.auto_to_human_delay = a2h_delays[i];
+      point.human_to_auto_delay = h2a_delays[j];
+      point.true_positives = counts[i * h2a_delays.size() + j];
+      point.false_positives = autoref.size() - point.true_positives;
+      point.false_negatives = human_referee.size() - point.true_positives;
+      point.metrics = Metrics(point.true_positives,
+                              point.false_positives,
+                              point.false_negatives);
+      points->push_back(point);
+    }
+  }
+}
@@ -0,0 +1,280 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Evaluation of automatic referees by comparison to the human referee: loads
+// the referee commands of a log, extracts their events, matches the events of
+// every autoref to those of the human referee, and computes the metrics.
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "autoref_eval/metrics.h"
+#include "autoref_eval/referee_event.h"
+#include "autoref_eval/vision_store.h"
+#include "autoref_eval/world_timeline.h"
+#include "messages_robocup_ssl_geometry.pb.h"
+#include "referee.pb.h"
+#include "shared/log_index.h"
+#include "shared/wire_decoder.h"
+
+#ifndef EVALUATOR_H_
+#define EVALUATOR_H_
+
+// Commands and events of one referee in a log.
+struct RefereeLog {
+  RefereeLog() : port(0) {}
+
+  // Port number of the referee.
+  uint16_t port;
+
+  // Commands, in order of their command counters.
+  std::vector<RefereeView> commands;
+
+  // Receive timestamps in the log of the commands.
+  std::vector<uint64_t> receive_timestamps;
+
+  // Events, in order of time.
+  std::vector<RefereeEvent> events;
+};
+
+// Extract the events of a referee from its commands, in order. If
+// command_indices is not NULL, it is set to the index in commands of the
+// command of every event.
+void ExtractEvents(const std::vector<RefereeView>& commands,
+                   std::vector<RefereeEvent>* events,
+                   std::vector<int>* command_indices);
+
+// Vision context of an event: the ball, and the robots nearest to it, at the
+// time of the event.
+struct EventContext {
+  EventContext() : t(0), has_ball(false) {}
+
+  // Time of the event, as a receive timestamp of the log: the time of the
+  // stop of the event, or of its command if it had no stop. The human
+  // referee event is used for true positives and false negatives, and the
+  // autoref event for false positives. The timestamps of the event are on
+  // the clock of its referee, so they are mapped to the clock of the log
+  // through the receive timestamp of the command of the event.
+  uint64_t t;
+
+  // True iff the ball was detected at time t.
+  bool has_ball;
+  BallSample ball;
+
+  // Robots nearest to the ball, in order of increasing distance.
+  std::vector<RobotSample> robots;
+};
+
+// Evaluation of one autoref in one game (log file).
+struct AutorefEvaluation {
+  AutorefEvaluation() : port(0), annotated(false) {}
+
+  // Port number of the autoref.
+  uint16_t port;
+
+  // True iff consistent human annotations of the evaluations were loaded.
+  bool annotated;
+
+  // Evaluations of all the events, in order of time.
+  std::vector<EventEvaluation> evaluations;
+
+  // Vision context of each of the evaluations, if vision was loaded.
+  std::vector<EventContext> contexts;
+
+  // Counts of the evaluations that are not ignored.
+  GameEvaluation game;
+
+  // Command confusion and timing of the evaluations that are not ignored.
+  EventTiming timing;
+};
+
+// Compute the counts and the command confusion and timing of the evaluations
+// of an autoref, from its evaluations, matching the false positives and
+// false negatives with different commands with the given delays. Returns
+// false if an evaluation is invalid.
+bool SummarizeEvaluation(uint64_t auto_to_human_delay,
+                         uint64_t human_to_auto_delay,
+                         AutorefEvaluation* evaluation);
+
+// Parts of a log to evaluate. The default filter selects the whole log.
+struct LogFilter {
+  LogFilter() :
+      has_time_window(false), relative_time(false), begin(0), end(0) {}
+
+  // Returns true iff the filter selects only parts of the log.
+  bool IsSet() const { return (has_time_window || !stages.empty()); }
+
+  // Stages of the game of the human referee to evaluate, or all of them if
+  // empty.
+  std::vector<SSL_Referee_Stage> stages;
+
+  // If set, only evaluate the time window [begin, end), in microseconds.
+  // The times are receive timestamps of the log if relative_time is not
+  // set, and relative to the first record of the log otherwise.
+  bool has_time_window;
+  bool relative_time;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Range of values to sweep a tolerance over, in microseconds.
+struct SweepRange {
+  SweepRange(uint64_t min, uint64_t max, uint64_t step) :
+      min(min), max(max), step(step) {}
+  uint64_t min;
+  uint64_t max;
+  uint64_t step;
+};
+
+// Counts and metrics of an autoref at one point of a tolerance sweep.
+struct SweepPoint {
+  uint64_t auto_to_human_delay;
+  uint64_t human_to_auto_delay;
+  int true_positives;
+  int false_positives;
+  int false_negatives;
+  Metrics metrics;
+};
+
+// Evaluator of the autorefs in one log. The evaluator has no global state,
+// so that several logs can be evaluated concurrently by separate instances.
+class Evaluator {
+ public:
+  // The default maximum time delay between an autoref event, and a human
+  // referee event after the autoref event.
+  static const uint64_t kDefaultAutoToHumanDelay = 2000000;
+
+  // The default maximum time delay between a human referee event, and an
+  // autoref event after the human referee event.
+  static const uint64_t kDefaultHumanToAutoDelay = 0;
+
+  Evaluator();
+
+  // Set the tolerances of the matching of events, in microseconds.
+  void SetDelays(uint64_t auto_to_human_delay, uint64_t human_to_auto_delay);
+
+  uint64_t auto_to_human_delay() const { return auto_to_human_delay_; }
+  uint64_t human_to_auto_delay() const { return human_to_auto_delay_; }
+
+  // If set (the default), Evaluate() uses the human annotations of the
+  // evaluations of autoref i in the file "<log file>.<i>.eval", if they are
+  // consistent with the evaluations, and otherwise saves the evaluations to
+  // that file for annotation.
+  void set_use_annotations(bool use_annotations) {
+    use_annotations_ = use_annotations;
+  }
+
+  // If set, Load() also stores the vision detections of the log, and
+  // Evaluate() returns the vision context of every evaluation. Not set by
+  // default.
+  void set_load_vision(bool load_vision) {
+    load_vision_ = load_vision;
+  }
+
+  // Only evaluate the parts of the log selected by a filter. The log index
+  // ("<log file>.idx") is used to read only those parts of the log, and is
+  // built on the first filtered load of a log. If a filter is set,
+  // Evaluate() applies the ignore flags of the human annotations of the whole
+  // log to the evaluations that are in them, and does not save the
+  // evaluations for annotation.
+  void set_filter(const LogFilter& filter) { filter_ = filter; }
+  const LogFilter& filter() const { return filter_; }
+
+  // Returns a hash of the parameters of the evaluation, which identifies the
+  // evaluations of a log with these parameters. Vision is not included, as
+  // it does not change the evaluations.
+  uint64_t ParametersHash() const;
+
+  // Load the referee commands of a log file, and extract their events.
+  // Returns false on error.
+  bool Load(const std::string& log_file);
+
+  // Windows of receive timestamps of the loaded log selected by the filter,
+  // in order of time. Empty if no filter is set.
+  const std::vector<TimeWindow>& windows() const { return windows_; }
+
+  // The referees of the loaded log. The first referee is the human refbox,
+  // the rest are autorefs.
+  const std::vector<RefereeLog>& referees() const { return referees_; }
+
+  // The vision detections of the loaded log, if loaded.
+  const VisionStore& vision() const { return vision_; }
+
+  // The latest field geometry of the loaded log, if vision was loaded, or
+  // NULL if there is none.
+  const SSL_GeometryData* geometry() const {
+    return has_geometry_ ? &geometry_ : NULL;
+  }
+
+  // Returns the name of the file of the human annotations of autoref i of
+  // referees().
+  std::string AnnotationFile(int i) const;
+
+  // Evaluate every autoref of the loaded log, in the order of referees().
+  // Returns false if the human referee has no events.
+  bool Evaluate(std::vector<AutorefEvaluation>* evaluations) const;
+
+  // Compute the counts and metrics of autoref i of referees() for every
+  // combination of delays in the given ranges, without human annotations.
+  void Sweep(int i,
+             const SweepRange& auto_to_human,
+             const SweepRange& human_to_auto,
+             std::vector<SweepPoint>* points) const;
+
+ private:
+  // Evaluate autoref i of referees().
+  bool EvaluateAutoref(int i, AutorefEvaluation* evaluation) const;
+
+  // Find the windows of a log selected by the filter.
+  void FindWindows(const LogIndex& index,
+                   std::vector<TimeWindow>* windows) const;
+
+  // Returns true iff an event command received at time t is selected by the
+  // filter.
+  bool IsSelected(uint64_t t) const;
+
+  // Find the vision context of an evaluation of autoref i of referees().
+  void FindContext(int i,
+                   const EventEvaluation& evaluation,
+                   EventContext* context) const;
+
+  std::string log_file_;
+  uint64_t auto_to_human_delay_;
+  uint64_t human_to_auto_delay_;
+  bool use_annotations_;
+  bool load_vision_;
+  LogFilter filter_;
+
+  // Windows of the loaded log selected by the filter.
+  std::vector<TimeWindow> windows_;
+
+  // Referees of the loaded log. The first one is the human refbox.
+  std::vector<RefereeLog> referees_;
+
+  // Map from referee port number, to index in referees_.
+  std::map<uint16_t, int> referee_map_;
+
+  VisionStore vision_;
+  SSL_GeometryData geometry_;
+  bool has_geometry_;
+};
+
+#endif  // EVALUATOR_H_
@@ -0,0 +1,391 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Optimal matching of autoref events to human referee events.
+
+#include "autoref_eval/event_matcher.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "autoref_eval/referee_event.h"
+
+using std::make_pair;
+using std::map;
+using std::multiset;
+using std::pair;
+using std::sort;
+using std::vector;
+
+// Comparison of event indices by the command timestamps of the events.
+struct CommandTimestampLess {
+  explicit CommandTimestampLess(const vector<RefereeEvent>& events) :
+      events(events) {}
+  bool operator()(int i, int j) const {
+    return (events[i].command_timestamp < events[j].command_timestamp);
+  }
+  const vector<RefereeEvent>& events;
+};
+
+// Comparison of event indices by the stop timestamps of the events.
+struct StopTimestampLess {
+  explicit StopTimestampLess(const vector<RefereeEvent>& events) :
+      events(events) {}
+  bool operator()(int i, int j) const {
+    return (events[i].stop_timestamp < events[j].stop_timestamp);
+  }
+  const vector<RefereeEvent>& events;
+};
+
+// Comparison of evaluations by the time of their event: the autoref event for
+// true and false positives, and the human referee event for false negatives.
+bool EvaluationTimeLess(const EventEvaluation& e1, const EventEvaluation& e2) {
+  const uint64_t t1 = (e1.value == EventEvaluation::kFalseNegative) ?
+      e1.humanref_event.command_timestamp : e1.autoref_event.command_timestamp;
+  const uint64_t t2 = (e2.value == EventEvaluation::kFalseNegative) ?
+      e2.humanref_event.command_timestamp : e2.autoref_event.command_timestamp;
+  return (t1 < t2 || (t1 == t2 && e1.value < e2.value));
+}
+
+// Maximum number of pairs of overlapping events per event, for
+// EventMatcher::CountMatches() to match the components of the events
+// separately. With more pairs, the components are large, and matching them
+// separately would not save time.
+static const size_t kMaxEdgesPerEvent = 16;
+
+// The events of a connected component of the pairs of overlapping events, see
+// EventMatcher::CountMatches().
+struct EventComponent {
+  // Indices of the events, in the orders of EventMatcher::MatchCommand().
+  vector<int> autoref;
+  vector<int> human;
+
+  // Smallest delays with which each pair of events overlaps.
+  vector<uint64_t> min_a2h;
+  vector<uint64_t> min_h2a;
+};
+
+// Returns the root of the tree of a node in a union-find forest, halving the
+// path to it.
+int FindRoot(int node, vector<int>* parent) {
+  while ((*parent)[node] != node) {
+    (*parent)[node] = (*parent)[(*parent)[node]];
+    node = (*parent)[node];
+  }
+  return node;
+}
+
+// Find the ranges of indices of a sorted list of delays that satisfy the same
+// minimum delays: the first index of every range, in increasing order.
+void FindRangeStarts(const vector<uint64_t>& delays,
+                     const vector<uint64_t>& min_delays,
+                     vector<size_t>* starts) {
+  starts->assign(1, 0);
+  for (size_t i = 0; i < min_delays.size(); ++i) {
+    const size_t start = std::lower_bound(
+        delays.begin(), delays.end(), min_delays[i]) - delays.begin();
+    if (start > 0 && start < delays.size()) starts->push_back(start);
+  }
+  sort(starts->begin(), starts->end());
+  starts->erase(std::unique(starts->begin(), starts->end()), starts->end());
+}
+
+EventMatcher::EventMatcher(const vector<RefereeEvent>& human_events,
+                           const vector<RefereeEvent>& autoref_events,
+                           bool match_commands) :
+    human_events_(human_events), autoref_events_(autoref_events) {
+  for (size_t i = 0; i < human_events.size(); ++i) {
+    human_by_command_[match_commands ? human_events[i].command : 0]
+        .push_back(i);
+  }
+  for (size_t i = 0; i < autoref_events.size(); ++i) {
+    autoref_by_command_[match_commands ? autoref_events[i].command : 0]
+        .push_back(i);
+  }
+  for (map<int, vector<int> >::iterator it = human_by_command_.begin();
+       it != human_by_command_.end(); ++it) {
+    std::stable_sort(it->second.begin(),
+                     it->second.end(),
+                     StopTimestampLess(human_events));
+  }
+  for (map<int, vector<int> >::iterator it = autoref_by_command_.begin();
+       it != autoref_by_command_.end(); ++it) {
+    std::stable_sort(it->second.begin(),
+                     it->second.end(),
+                     CommandTimestampLess(autoref_events));
+  }
+}
+
+void EventMatcher::Match(uint64_t auto_to_human_delay,
+                         uint64_t human_to_auto_delay,
+                         vector<EventEvaluation>* evaluations) const {
+  evaluations->clear();
+  vector<int> autoref_match;
+  MatchIndices(auto_to_human_delay, human_to_auto_delay, &autoref_match);
+  vector<bool> human_matched(human_events_.size(), false);
+  for (size_t i = 0; i < autoref_events_.size(); ++i) {
+    if (autoref_match[i] < 0) {
+      evaluations->push_back(EventEvaluation(
+          EventEvaluation::kFalsePositive,
+          autoref_events_[i],
+          RefereeEvent(),
+          false));
+    } else {
+      human_matched[autoref_match[i]] = true;
+      evaluations->push_back(EventEvaluation(
+          EventEvaluation::kTruePositive,
+          autoref_events_[i],
+          human_events_[autoref_match[i]],
+          false));
+    }
+  }
+  for (size_t i = 0; i < human_events_.size(); ++i) {
+    if (human_matched[i]) continue;
+    evaluations->push_back(EventEvaluation(
+        EventEvaluation::kFalseNegative,
+        RefereeEvent(),
+        human_events_[i],
+        false));
+  }
+  sort(evaluations->begin(), evaluations->end(), EvaluationTimeLess);
+}
+
+int EventMatcher::CountMatches(uint64_t auto_to_human_delay,
+                               uint64_t human_to_auto_delay) const {
+  vector<int> autoref_match;
+  return MatchIndices(
+      auto_to_human_delay, human_to_auto_delay, &autoref_match);
+}
+
+int EventMatcher::MatchIndices(uint64_t auto_to_human_delay,
+                               uint64_t human_to_auto_delay,
+                               vector<int>* autoref_match) const {
+  autoref_match->assign(autoref_events_.size(), -1);
+  int num_matches = 0;
+  for (map<int, vector<int> >::const_iterator it =
+           autoref_by_command_.begin();
+       it != autoref_by_command_.end(); ++it) {
+    map<int, vector<int> >::const_iterator human_it =
+        human_by_command_.find(it->first);
+    if (human_it == human_by_command_.end()) continue;
+    num_matches += MatchCommand(it->second,
+                                human_it->second,
+                                auto_to_human_delay,
+                                human_to_auto_delay,
+                                autoref_match);
+  }
+  return num_matches;
+}
+
+int EventMatcher::MatchCommand(const vector<int>& autoref,
+                               const vector<int>& human,
+                               uint64_t auto_to_human_delay,
+                               uint64_t human_to_auto_delay,
+                               vector<int>* autoref_match) const {
+  int num_matches = 0;
+  // Human events that start before the end of the current autoref event,
+  // and have not been matched yet, keyed by their end time.
+  multiset<pair<uint64_t, int> > candidates;
+  size_t next_human = 0;
+  for (size_t i = 0; i < autoref.size(); ++i) {
+    const RefereeEvent& autoref_event = autoref_events_[autoref[i]];
+    while (next_human < human.size() &&
+           !Before(autoref_event,
+                   human_events_[human[next_human]],
+                   auto_to_human_delay)) {
+      const int j = human[next_human];
+      candidates.insert(make_pair(human_events_[j].command_timestamp, j));
+      ++next_human;
+    }
+    // The candidate that ends first, without ending before the autoref
+    // event starts.
+    const uint64_t t_min_end =
+        (autoref_event.stop_timestamp > human_to_auto_delay) ?
+        (autoref_event.stop_timestamp - human_to_auto_delay) : 0;
+    multiset<pair<uint64_t, int> >::iterator match =
+        candidates.lower_bound(make_pair(t_min_end, -1));
+    if (match != candidates.end() &&
+        Overlaps(human_events_[match->second],
+                 autoref_event,
+                 auto_to_human_delay,
+                 human_to_auto_delay)) {
+      if (autoref_match != NULL) (*autoref_match)[autoref[i]] = match->second;
+      ++num_matches;
+      candidates.erase(match);
+    }
+  }
+  return num_matches;
+}
+
+bool EventMatcher::FindEdges(uint64_t auto_to_human_delay,
+                             uint64_t human_to_auto_delay,
+                             size_t max_edges,
+                             vector<Edge>* edges) const {
+  edges->clear();
+  // Human events that start before the end of the current autoref event,
+  // keyed by their end time, as in MatchCommand(), but without removing
+  // the matched ones.
+  multiset<pair<uint64_t, int> > started;
+  for (map<int, vector<int> >::const_iterator it =
+           autoref_by_command_.begin();
+       it != autoref_by_command_.end(); ++it) {
+    map<int, vector<int> >::const_iterator human_it =
+        human_by_command_.find(it->first);
+    if (human_it == human_by_command_.end()) continue;
+    const vector<int>& autoref = it->second;
+    const vector<int>& human = human_it->second;
+    started.clear();
+    size_t next_human = 0;
+    for (size_t i = 0; i < autoref.size(); ++i) {
+      const RefereeEvent& autoref_event = autoref_events_[autoref[i]];
+      while (next_human < human.size() &&
+             !Before(autoref_event,
+                     human_events_[human[next_human]],
+                     auto_to_human_delay)) {
+        const int j = human[next_human];
+        started.insert(make_pair(human_events_[j].command_timestamp, j));
+        ++next_human;
+      }
+      const uint64_t t_min_end =
+          (autoref_event.stop_timestamp > human_to_auto_delay) ?
+          (autoref_event.stop_timestamp - human_to_auto_delay) : 0;
+      for (multiset<pair<uint64_t, int> >::const_iterator match =
+               started.lower_bound(make_pair(t_min_end, -1));
+           match != started.end(); ++match) {
+        if (edges->size() >= max_edges) return false;
+        const RefereeEvent& human_event = human_events_[match->second];
+        edges->push_back(Edge(
+            autoref[i],
+            match->second,
+            (human_event.stop_timestamp > autoref_event.command_timestamp) ?
+                (human_event.stop_timestamp -
+                 autoref_event.command_timestamp) : 0,
+            (autoref_event.stop_timestamp > human_event.command_timestamp) ?
+                (autoref_event.stop_timestamp -
+                 human_event.command_timestamp) : 0));
+      }
+    }
+  }
+  return true;
+}
+
+void EventMatcher::CountMatches(const vector<uint64_t>& auto_to_human_delays,
+                                const vector<uint64_t>& human_to_auto_delays,
+                                vector<int>* counts) const {
+  const size_t num_a2h = auto_to_human_delays.size();
+  const size_t num_h2a = human_to_auto_delays.size();
+  counts->assign(num_a2h * num_h2a, 0);
+  if (num_a2h == 0 || num_h2a == 0) return;
+  vector<Edge> edges;
+  const size_t num_events = autoref_events_.size() + human_events_.size();
+  if (!FindEdges(auto_to_human_delays.back(),
+                 human_to_auto_delays.back(),
+                 kMaxEdgesPerEvent * num_events,
+                 &edges)) {
+    for (size_t i = 0; i < num_a2h; ++i) {
+      for (size_t j = 0; j < num_h2a; ++j) {
+        (*counts)[i * num_h2a + j] = CountMatches(auto_to_human_delays[i],
+                                                  human_to_auto_delays[j]);
+      }
+    }
+    return;
+  }
+
+  // Connected components of the events, with autoref event i as node i, and
+  // human event j as node autoref_events_.size() + j.
+  const int human_node = autoref_events_.size();
+  vector<int> parent(num_events);
+  for (size_t i = 0; i < num_events; ++i) parent[i] = i;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    parent[FindRoot(edges[i].autoref, &parent)] =
+        FindRoot(human_node + edges[i].human, &parent);
+  }
+  // Index in components of the component of every root node with edges.
+  vector<int> component_index(num_events, -1);
+  vector<EventComponent> components;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const int root = FindRoot(edges[i].autoref, &parent);
+    if (component_index[root] < 0) {
+      component_index[root] = components.size();
+      components.push_back(EventComponent());
+    }
+    EventComponent& component = components[component_index[root]];
+    component.min_a2h.push_back(edges[i].min_a2h);
+    component.min_h2a.push_back(edges[i].min_h2a);
+  }
+  // The events of every component, in the orders of MatchCommand().
+  for (map<int, vector<int> >::const_iterator it =
+           autoref_by_command_.begin();
+       it != autoref_by_command_.end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      const int index = component_index[FindRoot(it->second[i], &parent)];
+      if (index >= 0) components[index].autoref.push_back(it->second[i]);
+    }
+  }
+  for (map<int, vector<int> >::const_iterator it = human_by_command_.begin();
+       it != human_by_command_.end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      const int index =
+          component_index[FindRoot(human_node + it->second[i], &parent)];
+      if (index >= 0) components[index].human.push_back(it->second[i]);
+    }
+  }
+
+  // Add the matches of every component over each range of delays with the
+  // same edges to a two-dimensional difference array of the counts.
+  const size_t stride = num_h2a + 1;
+  vector<int> differences((num_a2h + 1) * stride, 0);
+  vector<size_t> a2h_starts;
+  vector<size_t> h2a_starts;
+  for (size_t c = 0; c < components.size(); ++c) {
+    const EventComponent& component = components[c];
+    FindRangeStarts(auto_to_human_delays, component.min_a2h, &a2h_starts);
+    FindRangeStarts(human_to_auto_delays, component.min_h2a, &h2a_starts);
+    for (size_t i = 0; i < a2h_starts.size(); ++i) {
+      const size_t i_end =
+          (i + 1 < a2h_starts.size()) ? a2h_starts[i + 1] : num_a2h;
+      for (size_t j = 0; j < h2a_starts.size(); ++j) {
+        const size_t j_end =
+            (j + 1 < h2a_starts.size()) ? h2a_starts[j + 1] : num_h2a;
+        const int num_matches = MatchCommand(
+            component.autoref,
+            component.human,
+            auto_to_human_delays[a2h_starts[i]],
+            human_to_auto_delays[h2a_starts[j]],
+            NULL);
+        differences[a2h_starts[i] * stride + h2a_starts[j]] += num_matches;
+        differences[a2h_starts[i] * stride + j_end] -= num_matches;
+        differences[i_end * stride + h2a_starts[j]] -= num_matches;
+        differences[i_end * stride + j_end] += num_matches;
+      }
+    }
+  }
+  for (size_t i = 0; i < num_a2h; ++i) {
+    int row_sum = 0;
+    for (size_t j = 0; j < num_h2a; ++j) {
+      row_sum += differences[i * stride + j];
+      (*counts)[i * num_h2a + j] =
+          row_sum + ((i > 0) ? (*counts)[(i - 1) * num_h2a + j] : 0);
+    }
+  }
+}
@@ -0,0 +1,132 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Optimal matching of autoref events to human referee events.
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "autoref_eval/referee_event.h"
+
+#ifndef EVENT_MATCHER_H_
+#define EVENT_MATCHER_H_
+
+// Matches the events of an autoref to those of the human referee. An autoref
+// event may only match a human referee event with the same command that
+// overlaps it in time, and every event may be matched at most once. The
+// matching maximizes the number of matched events, independently of the
+// order of the events.
+//
+// Events of different commands never match, so each command is matched on
+// its own by a sweep over the autoref events in order of their end time.
+// Human events are added to the candidate set as soon as they start before
+// the end of the current autoref event, and the autoref event is matched to
+// the candidate that overlaps it and ends first. Any optimal matching can be
+// transformed into this one by exchanging partners, so it is optimal, and
+// takes O((n + m) log(n + m)) time for n autoref and m human events.
+class EventMatcher {
+ public:
+  // The matcher keeps references to the events, which must outlive it. If
+  // match_commands is false, events match regardless of their commands.
+  EventMatcher(const std::vector<RefereeEvent>& human_events,
+               const std::vector<RefereeEvent>& autoref_events,
+               bool match_commands = true);
+
+  // Match the events, allowing an autoref event to end up to
+  // auto_to_human_delay before the human event starts, and a human event to
+  // end up to human_to_auto_delay before the autoref event starts. The
+  // evaluations are returned in order of time.
+  void Match(uint64_t auto_to_human_delay,
+             uint64_t human_to_auto_delay,
+             std::vector<EventEvaluation>* evaluations) const;
+
+  // Returns the number of matched events with the given delays, see Match().
+  int CountMatches(uint64_t auto_to_human_delay,
+                   uint64_t human_to_auto_delay) const;
+
+  // Count the matched events for every combination of the delays in two
+  // lists, sorted in increasing order. counts[i * human_to_auto_delays.size()
+  // + j] is CountMatches(auto_to_human_delays[i], human_to_auto_delays[j]).
+  //
+  // Two events can only match if their delays are at least those at which
+  // they overlap, so the events that overlap with the largest delays split
+  // into connected components that are matched independently. The matches of
+  // a component only change at the delays at which its events start to
+  // overlap, so every component is matched once for every range of delays
+  // between them that the lists cover, instead of once for every
+  // combination. Components are small unless the delays are long compared to
+  // the time between events; if the events overlap too much, every
+  // combination is matched from scratch.
+  void CountMatches(const std::vector<uint64_t>& auto_to_human_delays,
+                    const std::vector<uint64_t>& human_to_auto_delays,
+                    std::vector<int>* counts) const;
+
+ private:
+  // A pair of events of the same command that overlap with large enough
+  // delays.
+  struct Edge {
+    Edge(int autoref, int human, uint64_t min_a2h, uint64_t min_h2a) :
+        autoref(autoref), human(human), min_a2h(min_a2h), min_h2a(min_h2a) {}
+
+    // Indices of the events.
+    int autoref;
+    int human;
+
+    // Smallest delays with which the events overlap.
+    uint64_t min_a2h;
+    uint64_t min_h2a;
+  };
+
+  // Match the events, and return for each autoref event the index of the
+  // matched human event, or -1 if unmatched. Returns the number of matches.
+  int MatchIndices(uint64_t auto_to_human_delay,
+                   uint64_t human_to_auto_delay,
+                   std::vector<int>* autoref_match) const;
+
+  // Match the autoref events of a command in order of their command
+  // timestamps to the human events of the command in order of their stop
+  // timestamps. Matches are returned in autoref_match, if not NULL. Returns
+  // the number of matches.
+  int MatchCommand(const std::vector<int>& autoref,
+                   const std::vector<int>& human,
+                   uint64_t auto_to_human_delay,
+                   uint64_t human_to_auto_delay,
+                   std::vector<int>* autoref_match) const;
+
+  // Find the pairs of events that overlap with the given delays. Returns
+  // false, with edges incomplete, if there are more than max_edges.
+  bool FindEdges(uint64_t auto_to_human_delay,
+                 uint64_t human_to_auto_delay,
+                 size_t max_edges,
+                 std::vector<Edge>* edges) const;
+
+  const std::vector<RefereeEvent>& human_events_;
+  const std::vector<RefereeEvent>& autoref_events_;
+
+  // Indices of the human referee events of every command, in order of their
+  // stop timestamps.
+  std::map<int, std::vector<int> > human_by_command_;
+
+  // Indices of the autoref events of every command, in order of their
+  // command timestamps.
+  std::map<int, std::vector<int> > autoref_by_command_;
+};
+
+#endif  // EVENT_MATCHER_H_
@@ -0,0 +1,342 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Tests of EventMatcher against the greedy matching that it replaced, and
+// against a maximum matching found by augmenting paths.
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "autoref_eval/event_matcher.h"
+#include "autoref_eval/referee_event.h"
+#include "shared/misc_util.h"
+
+using std::sort;
+using std::vector;
+
+// Number of random event sets compared.
+static const int kNumRandomCases = 20000;
+
+// Number of random event sets and grids of delays compared.
+static const int kNumRandomGrids = 500;
+
+static int num_failures = 0;
+
+// Record a failure if condition is false.
+void Expect(bool condition, const char* what, int line) {
+  if (condition) return;
+  fprintf(stderr, "Line %d: expected %s\n", line, what);
+  ++num_failures;
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+// Comparison of events by their stop timestamps, the order of the events of
+// a log.
+bool StopTimestampLess(const RefereeEvent& e1, const RefereeEvent& e2) {
+  return (e1.stop_timestamp < e2.stop_timestamp);
+}
+
+// The greedy matching that EventMatcher replaced, unchanged except for
+// stopping instead of reading past the last human referee event. Returns the
+// number of true positives.
+int GreedyMatch(const vector<RefereeEvent>& human_referee,
+                const vector<RefereeEvent>& autoref,
+                uint64_t auto_to_human_delay,
+                uint64_t human_to_auto_delay) {
+  int num_matches = 0;
+  size_t k = 0;
+  for (size_t j = 0; j < autoref.size(); ++j) {
+    // Indicates if a matching human referee command has been found.
+    bool match_found = false;
+    // Indicates if the autoref event has been evaluated.
+    bool evaluated = false;
+    while (!match_found && !evaluated && k < human_referee.size()) {
+      if (Before(human_referee[k], autoref[j], human_to_auto_delay)) {
+        // False negative.
+      } else if (Before(autoref[j], human_referee[k], auto_to_human_delay)) {
+        // False positive.
+        evaluated = true;
+      } else {
+        match_found = (human_referee[k].command == autoref[j].command);
+      }
+      if (!match_found) ++k;
+    }
+    if (match_found) {
+      ++num_matches;
+      ++k;
+    }
+  }
+  return num_matches;
+}
+
+// Look for an augmenting path from autoref event i, see MaxMatches().
+bool Augment(int i,
+             const vector<vector<int> >& edges,
+             vector<bool>* visited,
+             vector<int>* human_match) {
+  for (size_t e = 0; e < edges[i].size(); ++e) {
+    const int j = edges[i][e];
+    if ((*visited)[j]) continue;
+    (*visited)[j] = true;
+    if ((*human_match)[j] < 0 ||
+        Augment((*human_match)[j], edges, visited, human_match)) {
+      (*human_match)[j] = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the size of a maximum matching, found by augmenting paths.
+int MaxMatches(const vector<RefereeEvent>& human_referee,
+               const vector<RefereeEvent>& autoref,
+               uint64_t auto_to_human_delay,
+               uint64_t human_to_auto_delay) {
+  vector<vector<int> > edges(autoref.size());
+  for (size_t i = 0; i < autoref.size(); ++i) {
+    for (size_t j = 0; j < human_referee.size(); ++j) {
+      if (autoref[i].command == human_referee[j].command &&
+          Overlaps(human_referee[j], autoref[i],
+                   auto_to_human_delay, human_to_auto_delay)) {
+        edges[i].push_back(j);
+      }
+    }
+  }
+  vector<int> human_match(human_referee.size(), -1);
+  int num_matches = 0;
+  for (size_t i = 0; i < autoref.size(); ++i) {
+    vector<bool> visited(human_referee.size(), false);
+    if (Augment(i, edges, &visited, &human_match)) ++num_matches;
+  }
+  return num_matches;
+}
+
+// Match the events with EventMatcher, check that the evaluations are
+// consistent, and return the number of true positives.
+int MatcherMatches(const vector<RefereeEvent>& human_referee,
+                   const vector<RefereeEvent>& autoref,
+                   uint64_t auto_to_human_delay,
+                   uint64_t human_to_auto_delay) {
+  const EventMatcher matcher(human_referee, autoref);
+  vector<EventEvaluation> evaluations;
+  matcher.Match(auto_to_human_delay, human_to_auto_delay, &evaluations);
+  int num_matches = 0;
+  size_t num_autoref = 0;
+  size_t num_human = 0;
+  for (size_t i = 0; i < evaluations.size(); ++i) {
+    const EventEvaluation& evaluation = evaluations[i];
+    if (evaluation.value == EventEvaluation::kTruePositive) {
+      EXPECT(evaluation.autoref_event.command ==
+             evaluation.humanref_event.command);
+      EXPECT(Overlaps(evaluation.humanref_event, evaluation.autoref_event,
+                      auto_to_human_delay, human_to_auto_delay));
+      ++num_matches;
+      ++num_autoref;
+      ++num_human;
+    } else if (evaluation.value == EventEvaluation::kFalsePositive) {
+      ++num_autoref;
+    } else {
+      EXPECT(evaluation.value == EventEvaluation::kFalseNegative);
+      ++num_human;
+    }
+  }
+  EXPECT(num_autoref == autoref.size());
+  EXPECT(num_human == human_referee.size());
+  EXPECT(matcher.CountMatches(auto_to_human_delay, human_to_auto_delay) ==
+         num_matches);
+  return num_matches;
+}
+
+// Returns up to max_events random events in order of their stop timestamps,
+// with one of num_commands commands.
+vector<RefereeEvent> RandomEvents(Random* random,
+                                  int max_events,
+                                  int num_commands) {
+  static const uint32_t kLogDuration = 60000000;
+  static const uint32_t kMaxEventDuration = 5000000;
+  vector<RefereeEvent> events(random->Uniform(max_events + 1));
+  for (size_t i = 0; i < events.size(); ++i) {
+    const uint64_t stop = random->Uniform(kLogDuration);
+    events[i] = RefereeEvent(
+        stop,
+        stop + random->Uniform(kMaxEventDuration),
+        i,
+        static_cast<SSL_Referee_Command>(
+            SSL_Referee_Command_DIRECT_FREE_YELLOW +
+            random->Uniform(num_commands)));
+  }
+  sort(events.begin(), events.end(), StopTimestampLess);
+  return events;
+}
+
+void TestRandomEventSets() {
+  Random random(0x5eed);
+  int num_better = 0;
+  for (int i = 0; i < kNumRandomCases; ++i) {
+    const int num_commands = 1 + random.Uniform(3);
+    const vector<RefereeEvent> human = RandomEvents(&random, 20, num_commands);
+    const vector<RefereeEvent> autoref =
+        RandomEvents(&random, 20, num_commands);
+    const uint64_t auto_to_human_delay = random.Uniform(3000000);
+    const uint64_t human_to_auto_delay = random.Uniform(2) *
+        random.Uniform(3000000);
+    const int greedy = GreedyMatch(
+        human, autoref, auto_to_human_delay, human_to_auto_delay);
+    const int matcher = MatcherMatches(
+        human, autoref, auto_to_human_delay, human_to_auto_delay);
+    const int optimal = MaxMatches(
+        human, autoref, auto_to_human_delay, human_to_auto_delay);
+    EXPECT(matcher >= greedy);
+    EXPECT(matcher == optimal);
+    if (matcher > greedy) ++num_better;
+  }
+  printf("Random event sets: %d, with more matches than greedy: %d\n",
+         kNumRandomCases, num_better);
+}
+
+// Returns up to max_delays random delays in increasing order.
+vector<uint64_t> RandomDelays(Random* random, int max_delays) {
+  vector<uint64_t> delays(random->Uniform(max_delays + 1));
+  for (size_t i = 0; i < delays.size(); ++i) {
+    delays[i] = random->Uniform(2) * random->Uniform(10000000);
+  }
+  sort(delays.begin(), delays.end());
+  return delays;
+}
+
+// The counts of matches over a grid of delays must be the counts at each of
+// its points, both with the components of few overlapping events, and with
+// so many overlaps that CountMatches falls back to matching each point.
+void TestRandomGrids() {
+  Random random(0x6e1d);
+  for (int i = 0; i < kNumRandomGrids; ++i) {
+    const int max_events = (i % 10 == 0) ? 200 : 30;
+    const int num_commands = 1 + random.Uniform(3);
+    const vector<RefereeEvent> human =
+        RandomEvents(&random, max_events, num_commands);
+    const vector<RefereeEvent> autoref =
+        RandomEvents(&random, max_events, num_commands);
+    const EventMatcher matcher(human, autoref);
+    const vector<uint64_t> a2h = RandomDelays(&random, 12);
+    const vector<uint64_t> h2a = RandomDelays(&random, 12);
+    vector<int> counts;
+    matcher.CountMatches(a2h, h2a, &counts);
+    EXPECT(counts.size() == a2h.size() * h2a.size());
+    if (counts.size() != a2h.size() * h2a.size()) continue;
+    for (size_t j = 0; j < a2h.size(); ++j) {
+      for (size_t k = 0; k < h2a.size(); ++k) {
+        EXPECT(counts[j * h2a.size() + k] ==
+               matcher.CountMatches(a2h[j], h2a[k]));
+      }
+    }
+  }
+}
+
+// An autoref event that ends before a human event starts is a false
+// positive, but the greedy matching also skipped the human event, which a
+// later autoref event overlaps.
+void TestGreedySkipsAfterFalsePositive() {
+  static const SSL_Referee_Command kCommand =
+      SSL_Referee_Command_DIRECT_FREE_YELLOW;
+  vector<RefereeEvent> human;
+  human.push_back(RefereeEvent(10000000, 12000000, 1, kCommand));
+  vector<RefereeEvent> autoref;
+  autoref.push_back(RefereeEvent(1000000, 2000000, 1, kCommand));
+  autoref.push_back(RefereeEvent(10500000, 11000000, 2, kCommand));
+  EXPECT(GreedyMatch(human, autoref, 0, 0) == 0);
+  EXPECT(MatcherMatches(human, autoref, 0, 0) == 1);
+}
+
+// A human event that overlaps an autoref event of another command was
+// skipped by the greedy matching, although a later autoref event of its
+// command overlaps it.
+void TestGreedySkipsOtherCommand() {
+  static const SSL_Referee_Command kYellow =
+      SSL_Referee_Command_DIRECT_FREE_YELLOW;
+  static const SSL_Referee_Command kBlue =
+      SSL_Referee_Command_DIRECT_FREE_BLUE;
+  vector<RefereeEvent> human;
+  human.push_back(RefereeEvent(10000000, 14000000, 1, kYellow));
+  human.push_back(RefereeEvent(11000000, 13000000, 2, kBlue));
+  vector<RefereeEvent> autoref;
+  autoref.push_back(RefereeEvent(11500000, 12000000, 1, kBlue));
+  autoref.push_back(RefereeEvent(12500000, 13500000, 2, kYellow));
+  EXPECT(GreedyMatch(human, autoref, 0, 0) == 1);
+  EXPECT(MatcherMatches(human, autoref, 0, 0) == 2);
+}
+
+// Matching an autoref event to the first overlapping human event can leave a
+// later autoref event without a partner.
+void TestGreedyTakesFirstOverlap() {
+  static const SSL_Referee_Command kCommand =
+      SSL_Referee_Command_INDIRECT_FREE_BLUE;
+  vector<RefereeEvent> human;
+  human.push_back(RefereeEvent(10000000, 20000000, 1, kCommand));
+  human.push_back(RefereeEvent(11000000, 12000000, 2, kCommand));
+  vector<RefereeEvent> autoref;
+  autoref.push_back(RefereeEvent(11500000, 11800000, 1, kCommand));
+  autoref.push_back(RefereeEvent(18000000, 19000000, 2, kCommand));
+  EXPECT(GreedyMatch(human, autoref, 0, 0) == 1);
+  EXPECT(MatcherMatches(human, autoref, 0, 0) == 2);
+}
+
+// Before() computed e2.stop_timestamp - td, which wrapped around for events
+// that stop within td of the start of the log, so that every event was
+// before them.
+void TestBeforeNearZero() {
+  const RefereeEvent early(3, 4, 1, SSL_Referee_Command_GOAL_YELLOW);
+  const RefereeEvent later(2, 5, 2, SSL_Referee_Command_GOAL_YELLOW);
+  EXPECT(!Before(later, early, 10));
+  EXPECT(Overlaps(early, later, 10));
+  EXPECT(Before(early, RefereeEvent(20, 30, 3, early.command), 10));
+  EXPECT(!Before(early, RefereeEvent(14, 30, 3, early.command), 10));
+}
+
+// The EventEvaluation constructor stored kUnknown instead of its value.
+void TestEvaluationValue() {
+  const RefereeEvent event(1, 2, 3, SSL_Referee_Command_GOAL_BLUE);
+  EXPECT(EventEvaluation(EventEvaluation::kTruePositive, event, event,
+                         false).value == EventEvaluation::kTruePositive);
+  EXPECT(EventEvaluation(EventEvaluation::kFalsePositive, event,
+                         RefereeEvent(), false).value ==
+         EventEvaluation::kFalsePositive);
+  EXPECT(EventEvaluation(EventEvaluation::kFalseNegative, RefereeEvent(),
+                         event, true).value ==
+         EventEvaluation::kFalseNegative);
+}
+
+int main(int argc, char* argv[]) {
+  TestGreedySkipsAfterFalsePositive();
+  TestGreedySkipsOtherCommand();
+  TestGreedyTakesFirstOverlap();
+  TestBeforeNearZero();
+  TestEvaluationValue();
+  TestRandomEventSets();
+  TestRandomGrids();
+  if (num_failures > 0) {
+    fprintf(stderr, "%d checks failed\n", num_failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,235 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Metrics of the evaluations of an autoref: precision, recall and F1 score,
+// command confusion, event timing, and bootstrap confidence intervals.
+
+#include "autoref_eval/metrics.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "autoref_eval/referee_event.h"
+#include "referee.pb.h"
+#include "shared/histogram.h"
+#include "shared/misc_util.h"
+#include "shared/trace.h"
+
+using std::sort;
+using std::vector;
+
+// Work of one bootstrap thread: resamples [begin, end) of an autoref.
+struct BootstrapTask {
+  // Games of the autoref.
+  const vector<GameEvaluation>* games;
+
+  // Evaluations of all the games.
+  const vector<EventEvaluation::Evaluation>* events;
+
+  // Seed of the bootstrap.
+  uint64_t seed;
+
+  int begin;
+  int end;
+
+  // Metrics of every resample, by event and by game, indexed by resample.
+  vector<Metrics>* event_metrics;
+  vector<Metrics>* game_metrics;
+};
+
+void* BootstrapThread(void* task_ptr) {
+  TRACE_SCOPE("bootstrap");
+  const BootstrapTask& task = *reinterpret_cast<BootstrapTask*>(task_ptr);
+  const vector<GameEvaluation>& games = *task.games;
+  const vector<EventEvaluation::Evaluation>& events = *task.events;
+  for (int i = task.begin; i < task.end; ++i) {
+    Random random(task.seed ^ (0x9E3779B97F4A7C15ULL * (i + 1)));
+    // Resample events.
+    int counts[4] = {0, 0, 0, 0};
+    for (size_t j = 0; j < events.size(); ++j) {
+      ++counts[events[random.Uniform(events.size())]];
+    }
+    (*task.event_metrics)[i] = Metrics(
+        counts[EventEvaluation::kTruePositive],
+        counts[EventEvaluation::kFalsePositive],
+        counts[EventEvaluation::kFalseNegative]);
+    // Resample games.
+    int true_positives = 0;
+    int false_positives = 0;
+    int false_negatives = 0;
+    for (size_t j = 0; j < games.size(); ++j) {
+      const GameEvaluation& game = games[random.Uniform(games.size())];
+      true_positives += game.true_positives;
+      false_positives += game.false_positives;
+      false_negatives += game.false_negatives;
+    }
+    (*task.game_metrics)[i] =
+        Metrics(true_positives, false_positives, false_negatives);
+  }
+  return NULL;
+}
+
+bool IsNaN(float value) {
+  return (value != value);
+}
+
+// Returns the percentile p of the defined (non-NaN) values, sorting them.
+float Percentile(vector<float>* values_ptr, double p) {
+  vector<float>& values = *values_ptr;
+  values.erase(std::remove_if(values.begin(), values.end(), IsNaN),
+               values.end());
+  if (values.empty()) return NAN;
+  sort(values.begin(), values.end());
+  const int index = static_cast<int>(
+      floor(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5));
+  return values[index];
+}
+
+// Compute the lower and upper percentiles of every metric of the resamples.
+void MetricPercentiles(const vector<Metrics>& resamples,
+                       double p_low,
+                       double p_high,
+                       Metrics* low,
+                       Metrics* high) {
+  float Metrics::* const kMetrics[3] =
+      {&Metrics::precision, &Metrics::recall, &Metrics::f1_score};
+  vector<float> values;
+  for (int i = 0; i < 3; ++i) {
+    values.clear();
+    for (size_t j = 0; j < resamples.size(); ++j) {
+      values.push_back(resamples[j].*kMetrics[i]);
+    }
+    // Percentile() drops NaN values and sorts the rest, which leaves the
+    // percentiles of the remaining values unchanged.
+    low->*kMetrics[i] = Percentile(&values, p_low);
+    high->*kMetrics[i] = Percentile(&values, p_high);
+  }
+}
+
+void ComputeBootstrapIntervals(const vector<GameEvaluation>& games,
+                               int num_resamples,
+                               int num_threads,
+                               uint64_t seed,
+                               double confidence,
+                               BootstrapIntervals* intervals) {
+  vector<EventEvaluation::Evaluation> events;
+  int true_positives = 0;
+  int false_positives = 0;
+  int false_negatives = 0;
+  for (size_t i = 0; i < games.size(); ++i) {
+    events.insert(events.end(), games[i].values.begin(), games[i].values.end());
+    true_positives += games[i].true_positives;
+    false_positives += games[i].false_positives;
+    false_negatives += games[i].false_negatives;
+  }
+  intervals->num_games = games.size();
+  intervals->num_events = events.size();
+  intervals->estimate =
+      Metrics(true_positives, false_positives, false_negatives);
+
+  vector<Metrics> event_metrics(num_resamples);
+  vector<Metrics> game_metrics(num_resamples);
+  vector<BootstrapTask> tasks(num_threads);
+  vector<pthread_t> threads(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    BootstrapTask& task = tasks[i];
+    task.games = &games;
+    task.events = &events;
+    task.seed = seed;
+    task.begin = (num_resamples * i) / num_threads;
+    task.end = (num_resamples * (i + 1)) / num_threads;
+    task.event_metrics = &event_metrics;
+    task.game_metrics = &game_metrics;
+    pthread_create(&threads[i], NULL, BootstrapThread, &task);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  const double p_low = 50.0 * (1.0 - confidence);
+  const double p_high = 100.0 - p_low;
+  MetricPercentiles(event_metrics,
+                    p_low,
+                    p_high,
+                    &intervals->event_low,
+                    &intervals->event_high);
+  MetricPercentiles(game_metrics,
+                    p_low,
+                    p_high,
+                    &intervals->game_low,
+                    &intervals->game_high);
+}
+
+void ConfusionMatrix::Clear() {
+  for (int i = 0; i < kNumClasses; ++i) {
+    for (int j = 0; j < kNumClasses; ++j) {
+      counts[i][j] = 0;
+    }
+  }
+}
+
+int ConfusionMatrix::Class(SSL_Referee_Command command) {
+  switch (command) {
+    case SSL_Referee_Command_DIRECT_FREE_YELLOW: return 0;
+    case SSL_Referee_Command_DIRECT_FREE_BLUE: return 1;
+    case SSL_Referee_Command_INDIRECT_FREE_YELLOW: return 2;
+    case SSL_Referee_Command_INDIRECT_FREE_BLUE: return 3;
+    case SSL_Referee_Command_GOAL_YELLOW: return 4;
+    case SSL_Referee_Command_GOAL_BLUE: return 5;
+    default: return kNone;
+  }
+}
+
+void ConfusionMatrix::Merge(const ConfusionMatrix& other) {
+  for (int i = 0; i < kNumClasses; ++i) {
+    for (int j = 0; j < kNumClasses; ++j) {
+      counts[i][j] += other.counts[i][j];
+    }
+  }
+}
+
+void ConfusionMatrix::Print(FILE* out) const {
+  static const char* kNames[kNumClasses] =
+      {"DFY", "DFB", "IFY", "IFB", "GY", "GB", "none"};
+  fprintf(out, "%-12s", "Human\\Auto");
+  for (int j = 0; j < kNumClasses; ++j) {
+    fprintf(out, "%6s", kNames[j]);
+  }
+  fprintf(out, "\n");
+  for (int i = 0; i < kNumClasses; ++i) {
+    fprintf(out, "%-12s", kNames[i]);
+    for (int j = 0; j < kNumClasses; ++j) {
+      if (i == kNone && j == kNone) {
+        fprintf(out, "%6s", "-");
+      } else {
+        fprintf(out, "%6d", counts[i][j]);
+      }
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void EventTiming::Print(FILE* out) const {
+  confusion.Print(out);
+  command_delay.Print(out, "Command delay (us)");
+  stop_delay.Print(out, "Stop delay (us)");
+}
@@ -0,0 +1,151 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Metrics of the evaluations of an autoref: precision, recall and F1 score,
+// command confusion, event timing, and bootstrap confidence intervals.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "autoref_eval/referee_event.h"
+#include "referee.pb.h"
+#include "shared/histogram.h"
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+// Precision, recall and F1 score of a set of evaluations. Metrics that are
+// undefined, e.g. precision without any autoref events, are NaN.
+struct Metrics {
+  Metrics() : precision(0.0), recall(0.0), f1_score(0.0) {}
+
+  Metrics(int true_positives, int false_positives, int false_negatives) {
+    precision = static_cast<float>(true_positives) /
+        static_cast<float>(true_positives + false_positives);
+    recall = static_cast<float>(true_positives) /
+        static_cast<float>(true_positives + false_negatives);
+    f1_score = (true_positives == 0) ? 0.0 :
+        2.0 * precision * recall / (precision + recall);
+  }
+
+  float precision;
+  float recall;
+  float f1_score;
+};
+
+// Counts of the evaluations of one autoref in one game (log file).
+struct GameEvaluation {
+  GameEvaluation() :
+      true_positives(0), false_positives(0), false_negatives(0) {}
+
+  Metrics GetMetrics() const {
+    return Metrics(true_positives, false_positives, false_negatives);
+  }
+
+  // Values of the evaluations that are not ignored.
+  std::vector<EventEvaluation::Evaluation> values;
+
+  int true_positives;
+  int false_positives;
+  int false_negatives;
+};
+
+// Confusion matrix of the event commands of the human referee (rows) and an
+// autoref (columns). Events that only one of the referees called are counted
+// against the "none" class.
+struct ConfusionMatrix {
+  // Number of classes: the six event commands, and "none".
+  static const int kNumClasses = 7;
+  static const int kNone = kNumClasses - 1;
+
+  ConfusionMatrix() {
+    Clear();
+  }
+
+  void Clear();
+
+  // Returns the class of an event command, kNone if it is not an event.
+  static int Class(SSL_Referee_Command command);
+
+  void Add(int human_class, int autoref_class) {
+    ++counts[human_class][autoref_class];
+  }
+
+  void Merge(const ConfusionMatrix& other);
+
+  void Print(FILE* out) const;
+
+  int counts[kNumClasses][kNumClasses];
+};
+
+// Command confusion and timing of the events of an autoref, which can be
+// accumulated over several games.
+struct EventTiming {
+  void Merge(const EventTiming& other) {
+    confusion.Merge(other.confusion);
+    command_delay.Merge(other.command_delay);
+    stop_delay.Merge(other.stop_delay);
+  }
+
+  void Print(FILE* out) const;
+
+  ConfusionMatrix confusion;
+
+  // Autoref minus human referee command timestamps of true positives.
+  Histogram command_delay;
+
+  // Autoref minus human referee stop timestamps of true positives, where
+  // both events were preceded by a stop.
+  Histogram stop_delay;
+};
+
+// Point estimates and bootstrap confidence intervals of the metrics of an
+// autoref over several games.
+struct BootstrapIntervals {
+  BootstrapIntervals() : num_games(0), num_events(0) {}
+
+  int num_games;
+  int num_events;
+
+  // Metrics of all the games together.
+  Metrics estimate;
+
+  // Bounds of the intervals from resampling individual events.
+  Metrics event_low;
+  Metrics event_high;
+
+  // Bounds of the intervals from resampling whole games.
+  Metrics game_low;
+  Metrics game_high;
+};
+
+// Compute the bootstrap confidence intervals of the metrics of the games at
+// the given confidence level, from num_resamples resamples by event and by
+// game, on num_threads threads. Each resample uses its own pseudo-random
+// generator seeded from seed and its index, so the results do not depend on
+// the number of threads.
+void ComputeBootstrapIntervals(const std::vector<GameEvaluation>& games,
+                               int num_resamples,
+                               int num_threads,
+                               uint64_t seed,
+                               double confidence,
+                               BootstrapIntervals* intervals);
+
+#endif  // METRICS_H_
@@ -0,0 +1,161 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Referee events, and the evaluation of autoref events against those of the
+// human referee.
+
+#include <stdint.h>
+
+#include "referee.pb.h"
+
+#ifndef REFEREE_EVENT_H_
+#define REFEREE_EVENT_H_
+
+// Struct to keep track of a referee events. An "event" is a stop command,
+// followed by one of the following commands:
+  // DIRECT_FREE_YELLOW
+  // DIRECT_FREE_BLUE
+  // INDIRECT_FREE_YELLOW
+  // INDIRECT_FREE_BLUE
+  // GOAL_YELLOW
+  // GOAL_BLUE
+struct RefereeEvent {
+  RefereeEvent() :
+      stop_timestamp(0),
+      command_timestamp(0),
+      command_counter(0),
+      command(SSL_Referee_Command_HALT) {}
+
+  RefereeEvent(uint64_t stop_timestamp,
+               uint64_t command_timestamp,
+               uint32_t command_counter,
+               SSL_Referee_Command command) :
+      stop_timestamp(stop_timestamp),
+      command_timestamp(command_timestamp),
+      command_counter(command_counter),
+      command(command) {}
+
+  // Timestamp that the "STOP" command was sent, previous to the event command.
+  uint64_t stop_timestamp;
+
+  // Timestamp that the command was sent.
+  uint64_t command_timestamp;
+
+  // Value of the command counter when this command was received.
+  uint32_t command_counter;
+
+  // Command for the event.
+  SSL_Referee_Command command;
+};
+
+// Struct to represent the evaluation of a single referee event.
+struct EventEvaluation {
+  enum Evaluation {
+    kUnknown = 0,
+    kTruePositive = 1,
+    kFalsePositive = 2,
+    kFalseNegative = 3
+  };
+
+  EventEvaluation() : value(kUnknown), ignore(true) {}
+
+  EventEvaluation(Evaluation value,
+                  const RefereeEvent& autoref_event,
+                  const RefereeEvent& humanref_event,
+                  bool ignore) :
+      value(value),
+      autoref_event(autoref_event),
+      humanref_event(humanref_event),
+      ignore(ignore) {}
+
+  const char* ValueString() const {
+    switch (value) {
+      case kTruePositive : {
+        return "TP";
+      } break;
+
+      case kFalsePositive : {
+        return "FP";
+      } break;
+
+      case kFalseNegative : {
+        return "FN";
+      } break;
+
+      default: {
+        return "UN";
+      }
+    }
+  }
+
+  // The evaluation of this event.
+  Evaluation value;
+
+  // The autoref event corresponding to this evaluation. Valid for True
+  // Positives and False Positives.
+  RefereeEvent autoref_event;
+
+  // The human referee event corresponding to this evaluation. Valid for True
+  // Positives and False Negatives.
+  RefereeEvent humanref_event;
+
+  // Human-annotated flag to indicate that the evaluator should not count
+  // this event.
+  bool ignore;
+};
+
+inline bool operator!=(const RefereeEvent& e1, const RefereeEvent& e2) {
+  return (e1.stop_timestamp != e2.stop_timestamp ||
+      e1.command_timestamp != e2.command_timestamp ||
+      e1.command_counter != e2.command_counter ||
+      e1.command != e2.command);
+}
+
+inline bool operator!=(const EventEvaluation& e1,
+                       const EventEvaluation& e2) {
+  return (e1.value != e2.value ||
+      e1.autoref_event != e2.autoref_event ||
+      e1.humanref_event != e2.humanref_event);
+}
+
+// Returns true iff event e1 does not overlap with event e2, and the events do
+// not overlap, allowing for time delay "td" before event e2.
+inline bool Before(const RefereeEvent& e1,
+                   const RefereeEvent& e2,
+                   uint64_t td) {
+  return (e1.command_timestamp + td < e2.stop_timestamp);
+}
+
+// Returns true iff the events e1 and e2 overlap in time, allowing for time
+// delay "td1" before event e1, and time delay "td2" before event e2.
+inline bool Overlaps(const RefereeEvent& e1,
+                     const RefereeEvent& e2,
+                     uint64_t td1,
+                     uint64_t td2) {
+  return (!Before(e1, e2, td2) && !Before(e2, e1, td1));
+}
+
+// Returns true iff the events e1 and e2 overlap in time, allowing for time
+// delay "td" before event e1.
+inline bool Overlaps(const RefereeEvent& e1,
+                     const RefereeEvent& e2,
+                     uint64_t td) {
+  return Overlaps(e1, e2, td, 0);
+}
+
+#endif  // REFEREE_EVENT_H_
@@ -0,0 +1,276 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Append-only store of the evaluations of logs, so that only the logs whose
+// inputs changed need to be evaluated again.
+
+#include "autoref_eval/results_store.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "autoref_eval/evaluator.h"
+#include "autoref_eval/referee_event.h"
+#include "autoref_eval/results_writer.h"
+#include "autoref_results.pb.h"
+#include "referee.pb.h"
+#include "shared/log_reader.h"
+#include "shared/misc_util.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Returns the Hash64 of the contents of an annotation file, or zero if it
+// does not exist.
+uint64_t AnnotationHash(const string& file_name) {
+  uint64_t hash = 0;
+  if (!FileExists(file_name) || !HashFile(file_name, &hash)) return 0;
+  return hash;
+}
+
+// Get a referee event from the fields of an event result.
+bool GetEvent(uint64_t stop_timestamp,
+              uint64_t command_timestamp,
+              uint32_t command_counter,
+              const string& command_name,
+              RefereeEvent* event) {
+  SSL_Referee_Command command = SSL_Referee_Command_HALT;
+  if (!SSL_Referee_Command_Parse(command_name, &command)) return false;
+  *event = RefereeEvent(
+      stop_timestamp, command_timestamp, command_counter, command);
+  return true;
+}
+
+// Get the evaluation of an event from its result. Returns false if the result
+// is invalid.
+bool GetEventEvaluation(const AutorefEventResult& result,
+                        EventEvaluation* evaluation) {
+  if (result.evaluation() == "TP") {
+    evaluation->value = EventEvaluation::kTruePositive;
+  } else if (result.evaluation() == "FP") {
+    evaluation->value = EventEvaluation::kFalsePositive;
+  } else if (result.evaluation() == "FN") {
+    evaluation->value = EventEvaluation::kFalseNegative;
+  } else {
+    return false;
+  }
+  evaluation->ignore = result.ignore();
+  evaluation->autoref_event = RefereeEvent();
+  evaluation->humanref_event = RefereeEvent();
+  if (result.has_autoref_command() &&
+      !GetEvent(result.autoref_stop_timestamp(),
+                result.autoref_command_timestamp(),
+                result.autoref_command_counter(),
+                result.autoref_command(),
+                &(evaluation->autoref_event))) {
+    return false;
+  }
+  if (result.has_human_command() &&
+      !GetEvent(result.human_stop_timestamp(),
+                result.human_command_timestamp(),
+                result.human_command_counter(),
+                result.human_command(),
+                &(evaluation->humanref_event))) {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+ResultsStore::ResultsStore() : fid_(NULL) {}
+
+ResultsStore::~ResultsStore() {
+  Close();
+}
+
+bool ResultsStore::Open(const string& file_name) {
+  Close();
+  entries_.clear();
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if (GetFileStatus(file_name, &size, &mtime)) {
+    LogReader reader;
+    if (!reader.Open(file_name)) return false;
+    // Records hold the evaluations of whole logs, which may be larger than
+    // the records of a log, but not larger than the store.
+    reader.set_max_record_size(static_cast<uint32_t>(
+        std::min<uint64_t>(size, std::numeric_limits<uint32_t>::max())));
+    // End of the last valid record.
+    uint64_t valid_size = 0;
+    StoredLogResult result;
+    bool valid = true;
+    while (reader.ReadRecord()) {
+      if (!result.ParseFromArray(reader.record(), reader.record_size())) {
+        valid = false;
+        break;
+      }
+      entries_[result.log_file()].Swap(&result);
+      valid_size = reader.Tell();
+    }
+    if (reader.status() == LogReader::kReadError) return false;
+    if (!valid || reader.status() != LogReader::kEnd) {
+      // A damaged record, e.g. from a killed evaluation. Records appended
+      // after it could not be read back, so it is removed.
+      fprintf(stderr,
+              "Damaged record in results store %s, truncating it to %" PRIu64
+              " bytes\n",
+              file_name.c_str(),
+              valid_size);
+      if (truncate(file_name.c_str(), static_cast<off_t>(valid_size)) != 0) {
+        fprintf(stderr, "Error truncating results store %s: ",
+                file_name.c_str());
+        perror("");
+        return false;
+      }
+    }
+  }
+  fid_ = fopen(file_name.c_str(), "ab");
+  if (fid_ == NULL) {
+    fprintf(stderr, "Error opening results store %s: ", file_name.c_str());
+    perror("");
+    return false;
+  }
+  return true;
+}
+
+void ResultsStore::Close() {
+  if (fid_ != NULL) {
+    fclose(fid_);
+    fid_ = NULL;
+  }
+}
+
+const StoredLogResult* ResultsStore::Find(const string& log_file,
+                                          uint64_t parameters_hash) const {
+  map<string, StoredLogResult>::const_iterator it = entries_.find(log_file);
+  if (it == entries_.end()) return NULL;
+  const StoredLogResult& result = it->second;
+  if (result.parameters_hash() != parameters_hash) return NULL;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if (!GetFileStatus(log_file, &size, &mtime)) return NULL;
+  if (size != result.log_size() || mtime != result.log_mtime()) {
+    // The log may have changed, compare its contents.
+    uint64_t hash = 0;
+    if (!HashFile(log_file, &hash) || hash != result.log_hash()) return NULL;
+  }
+  for (int i = 0; i < result.autorefs_size(); ++i) {
+    const StoredAutorefResult& autoref = result.autorefs(i);
+    if (AnnotationHash(autoref.annotation_file()) !=
+        autoref.annotation_hash()) {
+      return NULL;
+    }
+  }
+  return &result;
+}
+
+bool ResultsStore::Append(const StoredLogResult& result) {
+  if (fid_ == NULL) return false;
+  string record;
+  const uint32_t size = result.ByteSizeLong();
+  record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  result.AppendToString(&record);
+  if (fwrite(record.data(), 1, record.size(), fid_) != record.size() ||
+      fflush(fid_) != 0) {
+    perror("Error writing results store");
+    return false;
+  }
+  entries_[result.log_file()] = result;
+  return true;
+}
+
+bool MakeStoredResult(const Evaluator& evaluator,
+                      const string& log_file,
+                      const vector<AutorefEvaluation>& evaluations,
+                      StoredLogResult* result) {
+  result->Clear();
+  result->set_log_file(log_file);
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  uint64_t hash = 0;
+  if (!GetFileStatus(log_file, &size, &mtime) ||
+      !HashFile(log_file, &hash)) {
+    return false;
+  }
+  result->set_log_hash(hash);
+  result->set_log_size(size);
+  result->set_log_mtime(mtime);
+  result->set_parameters_hash(evaluator.ParametersHash());
+  for (int i = 0; i < evaluations.size(); ++i) {
+    const AutorefEvaluation& evaluation = evaluations[i];
+    StoredAutorefResult* autoref = result->add_autorefs();
+    // The evaluations are in the order of the autorefs in referees().
+    const string annotation_file = evaluator.AnnotationFile(i + 1);
+    autoref->set_autoref_port(evaluation.port);
+    autoref->set_annotated(evaluation.annotated);
+    autoref->set_annotation_file(annotation_file);
+    autoref->set_annotation_hash(AnnotationHash(annotation_file));
+    for (int j = 0; j < evaluation.evaluations.size(); ++j) {
+      AutorefEventResult* event = autoref->add_events();
+      GetEventResult(log_file, evaluation, j, event);
+      event->clear_log_file();
+    }
+  }
+  return true;
+}
+
+bool RestoreEvaluations(const Evaluator& evaluator,
+                        const StoredLogResult& result,
+                        vector<AutorefEvaluation>* evaluations) {
+  evaluations->clear();
+  evaluations->resize(result.autorefs_size());
+  for (int i = 0; i < result.autorefs_size(); ++i) {
+    const StoredAutorefResult& autoref = result.autorefs(i);
+    AutorefEvaluation& evaluation = (*evaluations)[i];
+    evaluation.port = autoref.autoref_port();
+    evaluation.annotated = autoref.annotated();
+    evaluation.evaluations.resize(autoref.events_size());
+    for (int j = 0; j < autoref.events_size(); ++j) {
+      if (!GetEventEvaluation(autoref.events(j),
+                              &(evaluation.evaluations[j]))) {
+        fprintf(stderr,
+                "ERROR: Invalid stored evaluation %d of autoref %d in %s\n",
+                j,
+                evaluation.port,
+                result.log_file().c_str());
+        evaluations->clear();
+        return false;
+      }
+    }
+    if (!SummarizeEvaluation(evaluator.auto_to_human_delay(),
+                             evaluator.human_to_auto_delay(),
+                             &evaluation)) {
+      evaluations->clear();
+      return false;
+    }
+  }
+  return true;
+}
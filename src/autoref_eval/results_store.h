@@ -0,0 +1,92 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Append-only store of the evaluations of logs, so that only the logs whose
+// inputs changed need to be evaluated again.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "autoref_eval/evaluator.h"
+#include "autoref_results.pb.h"
+
+#ifndef RESULTS_STORE_H_
+#define RESULTS_STORE_H_
+
+// Store of the evaluations of logs, in a file of size-prefixed
+// StoredLogResult records, framed like the logs. New evaluations are
+// appended, and supersede any earlier evaluations of the same log file. An
+// evaluation is reused as long as the contents of the log, the contents of
+// its annotation files, and the parameters of the evaluation are unchanged.
+class ResultsStore {
+ public:
+  ResultsStore();
+  ~ResultsStore();
+
+  // Open a store, creating it if it does not exist, and read the latest
+  // evaluation of every log in it. The store is truncated after its last
+  // valid record if it ends with a damaged one, e.g. one partly written by a
+  // killed evaluation, so that new evaluations can be read back. Returns
+  // false on error.
+  bool Open(const std::string& file_name);
+
+  // Close the store, if open.
+  void Close();
+
+  // Returns the stored evaluation of a log with the given parameters hash, if
+  // it is still valid, or NULL otherwise.
+  const StoredLogResult* Find(const std::string& log_file,
+                              uint64_t parameters_hash) const;
+
+  // Append the evaluation of a log to the store. Returns false on error.
+  bool Append(const StoredLogResult& result);
+
+  // Number of logs in the store.
+  int NumLogs() const { return entries_.size(); }
+
+ private:
+  // Disable the copy constructor and assignment operator.
+  ResultsStore(const ResultsStore&);
+  void operator=(const ResultsStore&);
+
+  FILE* fid_;
+
+  // Latest evaluation of every log, indexed by log file.
+  std::map<std::string, StoredLogResult> entries_;
+};
+
+// Get the stored evaluation of a log evaluated by an evaluator. Returns false
+// if the log or the annotation files could not be read.
+bool MakeStoredResult(const Evaluator& evaluator,
+                      const std::string& log_file,
+                      const std::vector<AutorefEvaluation>& evaluations,
+                      StoredLogResult* result);
+
+// Restore the evaluations of the autorefs of a log from a stored evaluation,
+// with the counts, confusion and timing computed with the delays of the
+// evaluator. Vision contexts are not stored. Returns false if an evaluation
+// is invalid.
+bool RestoreEvaluations(const Evaluator& evaluator,
+                        const StoredLogResult& result,
+                        std::vector<AutorefEvaluation>* evaluations);
+
+#endif  // RESULTS_STORE_H_
@@ -0,0 +1,326 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Buffered writers of evaluation results as JSON lines, CSV, or protobuf.
+
+#include "autoref_eval/results_writer.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "autoref_eval/evaluator.h"
+#include "autoref_results.pb.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "referee.pb.h"
+#include "shared/misc_util.h"
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+using std::string;
+
+namespace {
+
+// Returns true iff the string ends with the suffix.
+bool EndsWith(const string& s, const char* suffix) {
+  const size_t n = strlen(suffix);
+  return (s.size() >= n && s.compare(s.size() - n, n, suffix) == 0);
+}
+
+// Append a JSON string literal.
+void AppendJsonString(const string& value, string* out) {
+  out->push_back('"');
+  for (size_t i = 0; i < value.size(); ++i) {
+    const char c = value[i];
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      *out += StringPrintf("\\u%04x", c);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+// Append a CSV cell, quoted if necessary.
+void AppendCsvString(const string& value, string* out) {
+  if (value.find_first_of(",\"\r\n") == string::npos) {
+    *out += value;
+    return;
+  }
+  out->push_back('"');
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] == '"') out->push_back('"');
+    out->push_back(value[i]);
+  }
+  out->push_back('"');
+}
+
+// Append the value of a singular scalar field. Strings are appended as JSON
+// string literals or CSV cells. Undefined floating point values are appended
+// as null in JSON, and empty in CSV. JSON has no infinities either, they are
+// also null in JSON, and inf or -inf in CSV.
+void AppendValue(const Message& record,
+                 const FieldDescriptor* field,
+                 bool json,
+                 string* out) {
+  const Reflection* reflection = record.GetReflection();
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32: {
+      *out += StringPrintf("%d", reflection->GetInt32(record, field));
+    } break;
+    case FieldDescriptor::CPPTYPE_INT64: {
+      *out += StringPrintf("%" PRId64, reflection->GetInt64(record, field));
+    } break;
+    case FieldDescriptor::CPPTYPE_UINT32: {
+      *out += StringPrintf("%u", reflection->GetUInt32(record, field));
+    } break;
+    case FieldDescriptor::CPPTYPE_UINT64: {
+      *out += StringPrintf("%" PRIu64, reflection->GetUInt64(record, field));
+    } break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      const double value =
+          (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) ?
+          reflection->GetFloat(record, field) :
+          reflection->GetDouble(record, field);
+      if (json && !isfinite(value)) {
+        *out += "null";
+      } else if (value != value) {
+        // Empty CSV cell.
+      } else {
+        *out += StringPrintf("%.9g", value);
+      }
+    } break;
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      if (json) {
+        *out += reflection->GetBool(record, field) ? "true" : "false";
+      } else {
+        *out += reflection->GetBool(record, field) ? "1" : "0";
+      }
+    } break;
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      const string& name = reflection->GetEnum(record, field)->name();
+      if (json) {
+        AppendJsonString(name, out);
+      } else {
+        AppendCsvString(name, out);
+      }
+    } break;
+    case FieldDescriptor::CPPTYPE_STRING: {
+      const string value = reflection->GetString(record, field);
+      if (json) {
+        AppendJsonString(value, out);
+      } else {
+        AppendCsvString(value, out);
+      }
+    } break;
+    default: {
+      // Nested messages are not supported by the flat formats.
+      if (json) *out += "null";
+    }
+  }
+}
+
+}  // namespace
+
+ResultsWriter::ResultsWriter() :
+    fid_(NULL), format_(kProtobuf), header_written_(false), error_(false) {}
+
+ResultsWriter::~ResultsWriter() {
+  Close();
+}
+
+ResultsWriter::Format ResultsWriter::FormatOf(const string& file_name) {
+  if (EndsWith(file_name, ".jsonl") || EndsWith(file_name, ".json")) {
+    return kJsonLines;
+  }
+  if (EndsWith(file_name, ".csv")) return kCsv;
+  return kProtobuf;
+}
+
+bool ResultsWriter::Open(const string& file_name) {
+  return Open(file_name, FormatOf(file_name));
+}
+
+bool ResultsWriter::Open(const string& file_name, Format format) {
+  Close();
+  fid_ = fopen(file_name.c_str(), "wb");
+  if (fid_ == NULL) {
+    fprintf(stderr, "Error opening %s: ", file_name.c_str());
+    perror("");
+    return false;
+  }
+  format_ = format;
+  header_written_ = false;
+  error_ = false;
+  buffer_.clear();
+  buffer_.reserve(kBufferSize);
+  return true;
+}
+
+bool ResultsWriter::Write(const Message& record) {
+  if (fid_ == NULL) return false;
+  switch (format_) {
+    case kJsonLines: {
+      AppendJson(record);
+    } break;
+    case kCsv: {
+      AppendCsv(record);
+    } break;
+    default: {
+      AppendProtobuf(record);
+    }
+  }
+  if (buffer_.size() >= kBufferSize) return Flush();
+  return !error_;
+}
+
+bool ResultsWriter::Close() {
+  if (fid_ == NULL) return true;
+  const bool success = Flush() && (fclose(fid_) == 0);
+  fid_ = NULL;
+  return success;
+}
+
+bool ResultsWriter::Flush() {
+  if (!buffer_.empty() &&
+      fwrite(buffer_.data(), 1, buffer_.size(), fid_) != buffer_.size()) {
+    perror("Error writing results");
+    error_ = true;
+  }
+  buffer_.clear();
+  return !error_;
+}
+
+void ResultsWriter::AppendJson(const Message& record) {
+  const Descriptor* descriptor = record.GetDescriptor();
+  const Reflection* reflection = record.GetReflection();
+  buffer_.push_back('{');
+  bool first = true;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (field->is_repeated() || !reflection->HasField(record, field)) {
+      continue;
+    }
+    if (!first) buffer_.push_back(',');
+    first = false;
+    AppendJsonString(field->name(), &buffer_);
+    buffer_.push_back(':');
+    AppendValue(record, field, true, &buffer_);
+  }
+  buffer_ += "}\n";
+}
+
+void ResultsWriter::AppendCsv(const Message& record) {
+  const Descriptor* descriptor = record.GetDescriptor();
+  const Reflection* reflection = record.GetReflection();
+  if (!header_written_) {
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+      if (i > 0) buffer_.push_back(',');
+      buffer_ += descriptor->field(i)->name();
+    }
+    buffer_.push_back('\n');
+    header_written_ = true;
+  }
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (i > 0) buffer_.push_back(',');
+    if (field->is_repeated() || !reflection->HasField(record, field)) {
+      continue;
+    }
+    AppendValue(record, field, false, &buffer_);
+  }
+  buffer_.push_back('\n');
+}
+
+void ResultsWriter::AppendProtobuf(const Message& record) {
+  const uint32_t size = record.ByteSizeLong();
+  buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  record.AppendToString(&buffer_);
+}
+
+void GetEventResult(const string& log_file,
+                    const AutorefEvaluation& autoref,
+                    int i,
+                    AutorefEventResult* result) {
+  const EventEvaluation& evaluation = autoref.evaluations[i];
+  result->Clear();
+  result->set_log_file(log_file);
+  result->set_autoref_port(autoref.port);
+  result->set_index(i);
+  result->set_evaluation(evaluation.ValueString());
+  result->set_ignore(evaluation.ignore);
+  if (evaluation.value != EventEvaluation::kFalseNegative) {
+    const RefereeEvent& event = evaluation.autoref_event;
+    result->set_autoref_stop_timestamp(event.stop_timestamp);
+    result->set_autoref_command_timestamp(event.command_timestamp);
+    result->set_autoref_command_counter(event.command_counter);
+    result->set_autoref_command(SSL_Referee_Command_Name(event.command));
+  }
+  if (evaluation.value != EventEvaluation::kFalsePositive) {
+    const RefereeEvent& event = evaluation.humanref_event;
+    result->set_human_stop_timestamp(event.stop_timestamp);
+    result->set_human_command_timestamp(event.command_timestamp);
+    result->set_human_command_counter(event.command_counter);
+    result->set_human_command(SSL_Referee_Command_Name(event.command));
+  }
+  if (i < autoref.contexts.size()) {
+    const EventContext& context = autoref.contexts[i];
+    result->set_context_timestamp(context.t);
+    if (context.has_ball) {
+      result->set_ball_x(context.ball.x);
+      result->set_ball_y(context.ball.y);
+    }
+  }
+}
+
+void GetSummaryResult(const string& log_file,
+                      const AutorefEvaluation& autoref,
+                      AutorefSummaryResult* result) {
+  const GameEvaluation& game = autoref.game;
+  const Metrics metrics = game.GetMetrics();
+  result->Clear();
+  result->set_log_file(log_file);
+  result->set_autoref_port(autoref.port);
+  result->set_annotated(autoref.annotated);
+  result->set_true_positives(game.true_positives);
+  result->set_false_positives(game.false_positives);
+  result->set_false_negatives(game.false_negatives);
+  result->set_precision(metrics.precision);
+  result->set_recall(metrics.recall);
+  result->set_f1_score(metrics.f1_score);
+  const EventTiming& timing = autoref.timing;
+  if (timing.command_delay.Count() > 0) {
+    result->set_command_delay_p50(timing.command_delay.Percentile(50.0));
+    result->set_command_delay_p95(timing.command_delay.Percentile(95.0));
+  }
+  if (timing.stop_delay.Count() > 0) {
+    result->set_stop_delay_p50(timing.stop_delay.Percentile(50.0));
+    result->set_stop_delay_p95(timing.stop_delay.Percentile(95.0));
+  }
+}
@@ -0,0 +1,107 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Buffered writers of evaluation results as JSON lines, CSV, or protobuf.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "autoref_eval/evaluator.h"
+#include "autoref_results.pb.h"
+
+#ifndef RESULTS_WRITER_H_
+#define RESULTS_WRITER_H_
+
+namespace google {
+namespace protobuf {
+class Message;
+}  // namespace protobuf
+}  // namespace google
+
+// Writer of a stream of result records, all of the same protobuf message
+// type. The records are written incrementally, through a buffer that is
+// flushed whenever it fills up, in one of the formats:
+//   JSON lines: one JSON object per record, with the fields that are set.
+//   CSV: a header with the names of all the fields, then one row per record,
+//        with empty cells for the fields that are not set.
+//   Protobuf: a 32-bit size followed by the serialized record, as in logs.
+class ResultsWriter {
+ public:
+  enum Format {
+    kJsonLines = 0,
+    kCsv = 1,
+    kProtobuf = 2
+  };
+
+  ResultsWriter();
+  ~ResultsWriter();
+
+  // Returns the format of a file by its extension: ".jsonl" or ".json" for
+  // JSON lines, ".csv" for CSV, and protobuf otherwise.
+  static Format FormatOf(const std::string& file_name);
+
+  // Open a file for writing, in the format of its extension. Returns false on
+  // error.
+  bool Open(const std::string& file_name);
+
+  // Open a file for writing in the given format. Returns false on error.
+  bool Open(const std::string& file_name, Format format);
+
+  // Write a record. Returns false on error.
+  bool Write(const google::protobuf::Message& record);
+
+  // Flush the buffer and close the file. Returns false on error.
+  bool Close();
+
+ private:
+  // Size of the buffer, in bytes.
+  static const size_t kBufferSize = 1 << 16;
+
+  // Disable the copy constructor and assignment operator.
+  ResultsWriter(const ResultsWriter&);
+  void operator=(const ResultsWriter&);
+
+  // Append a record to the buffer in each of the formats.
+  void AppendJson(const google::protobuf::Message& record);
+  void AppendCsv(const google::protobuf::Message& record);
+  void AppendProtobuf(const google::protobuf::Message& record);
+
+  // Write the buffer to the file. Returns false on error.
+  bool Flush();
+
+  FILE* fid_;
+  Format format_;
+  bool header_written_;
+  bool error_;
+  std::string buffer_;
+};
+
+// Get the result record of evaluation i of an autoref.
+void GetEventResult(const std::string& log_file,
+                    const AutorefEvaluation& evaluation,
+                    int i,
+                    AutorefEventResult* result);
+
+// Get the summary record of an autoref.
+void GetSummaryResult(const std::string& log_file,
+                      const AutorefEvaluation& evaluation,
+                      AutorefSummaryResult* result);
+
+#endif  // RESULTS_WRITER_H_
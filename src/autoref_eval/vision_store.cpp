@@ -0,0 +1,221 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Time-indexed store of the ball and robot detections of a log.
+
+#include "autoref_eval/vision_store.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "messages_robocup_ssl_detection.pb.h"
+
+using std::map;
+using std::vector;
+
+namespace {
+
+// Returns the capacity of a vector in bytes.
+template <typename T>
+uint64_t Capacity(const vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+// Release the excess capacity of a vector.
+template <typename T>
+void ShrinkVector(vector<T>* v) {
+  vector<T>(*v).swap(*v);
+}
+
+}  // namespace
+
+VisionStore::VisionStore() : num_frames_(0), retention_(0) {}
+
+void VisionStore::Clear() {
+  cameras_.clear();
+  num_frames_ = 0;
+  kept_times_.clear();
+}
+
+void VisionStore::Keep(uint64_t t) {
+  // Times are mostly kept in increasing order.
+  kept_times_.insert(
+      std::upper_bound(kept_times_.begin(), kept_times_.end(), t), t);
+}
+
+bool VisionStore::IsKept(uint64_t begin, uint64_t end) const {
+  const vector<uint64_t>::const_iterator it = std::lower_bound(
+      kept_times_.begin(), kept_times_.end(),
+      begin - std::min(begin, retention_));
+  return (it != kept_times_.end() && *it <= end + retention_);
+}
+
+void VisionStore::Evict(uint64_t t, bool final, Camera* camera) {
+  size_t i = camera->num_kept;
+  while (i < camera->chunks.size()) {
+    const vector<uint64_t>& t_capture = camera->chunks[i].t_capture;
+    if (!final && t_capture.back() + 2 * retention_ >= t) break;
+    if (IsKept(t_capture.front(), t_capture.back())) {
+      ++i;
+      continue;
+    }
+    num_frames_ -= t_capture.size();
+    camera->chunks.erase(camera->chunks.begin() + i);
+    camera->chunk_start.erase(camera->chunk_start.begin() + i);
+  }
+  camera->num_kept = i;
+}
+
+void VisionStore::Finish() {
+  if (retention_ == 0) return;
+  map<uint32_t, Camera>::iterator it = cameras_.begin();
+  while (it != cameras_.end()) {
+    Evict(0, true, &(it->second));
+    if (it->second.chunks.empty()) {
+      cameras_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void VisionStore::AddFrame(const SSL_DetectionFrame& frame,
+                           uint64_t receive_timestamp) {
+  const double processing_time =
+      std::max(0.0, frame.t_sent() - frame.t_capture());
+  uint64_t t_capture = receive_timestamp - std::min(
+      receive_timestamp,
+      static_cast<uint64_t>(processing_time * 1e6 + 0.5));
+  Camera& camera = cameras_[frame.camera_id()];
+  if (!camera.chunks.empty()) {
+    t_capture = std::max(t_capture, camera.chunks.back().t_capture.back());
+  }
+  if (camera.chunks.empty() ||
+      camera.chunks.back().t_capture.size() >= kChunkFrames) {
+    if (!camera.chunks.empty()) Shrink(&camera.chunks.back());
+    if (retention_ > 0) Evict(t_capture, false, &camera);
+    camera.chunks.push_back(Chunk());
+    camera.chunk_start.push_back(t_capture);
+    Chunk& chunk = camera.chunks.back();
+    chunk.t_capture.reserve(kChunkFrames);
+    chunk.ball_begin.reserve(kChunkFrames + 1);
+    chunk.robot_begin.reserve(kChunkFrames + 1);
+    chunk.ball_begin.push_back(0);
+    chunk.robot_begin.push_back(0);
+  }
+  Chunk& chunk = camera.chunks.back();
+  chunk.t_capture.push_back(t_capture);
+  for (int i = 0; i < frame.balls_size(); ++i) {
+    const SSL_DetectionBall& ball = frame.balls(i);
+    chunk.ball_x.push_back(ball.x());
+    chunk.ball_y.push_back(ball.y());
+    chunk.ball_confidence.push_back(ball.confidence());
+  }
+  chunk.ball_begin.push_back(chunk.ball_x.size());
+  // Yellow robots are team 0, and blue robots team 1.
+  for (int team = 0; team < 2; ++team) {
+    const google::protobuf::RepeatedPtrField<SSL_DetectionRobot>& robots =
+        (team == 0) ?
+        frame.robots_yellow() : frame.robots_blue();
+    for (int i = 0; i < robots.size(); ++i) {
+      const SSL_DetectionRobot& robot = robots.Get(i);
+      chunk.robot_x.push_back(robot.x());
+      chunk.robot_y.push_back(robot.y());
+      chunk.robot_orientation.push_back(robot.orientation());
+      chunk.robot_confidence.push_back(robot.confidence());
+      chunk.robot_id.push_back((robot.robot_id() & 0x7F) | (team << 7));
+    }
+  }
+  chunk.robot_begin.push_back(chunk.robot_x.size());
+  ++num_frames_;
+}
+
+void VisionStore::Shrink(Chunk* chunk) {
+  ShrinkVector(&chunk->ball_x);
+  ShrinkVector(&chunk->ball_y);
+  ShrinkVector(&chunk->ball_confidence);
+  ShrinkVector(&chunk->robot_x);
+  ShrinkVector(&chunk->robot_y);
+  ShrinkVector(&chunk->robot_orientation);
+  ShrinkVector(&chunk->robot_confidence);
+  ShrinkVector(&chunk->robot_id);
+}
+
+uint64_t VisionStore::MemoryUsage() const {
+  uint64_t bytes = Capacity(kept_times_);
+  for (map<uint32_t, Camera>::const_iterator it = cameras_.begin();
+       it != cameras_.end(); ++it) {
+    const Camera& camera = it->second;
+    bytes += Capacity(camera.chunk_start);
+    for (size_t i = 0; i < camera.chunks.size(); ++i) {
+      const Chunk& chunk = camera.chunks[i];
+      bytes += sizeof(chunk) +
+          Capacity(chunk.t_capture) +
+          Capacity(chunk.ball_begin) +
+          Capacity(chunk.robot_begin) +
+          Capacity(chunk.ball_x) +
+          Capacity(chunk.ball_y) +
+          Capacity(chunk.ball_confidence) +
+          Capacity(chunk.robot_x) +
+          Capacity(chunk.robot_y) +
+          Capacity(chunk.robot_orientation) +
+          Capacity(chunk.robot_confidence) +
+          Capacity(chunk.robot_id);
+    }
+  }
+  return bytes;
+}
+
+uint64_t VisionStore::StartTime() const {
+  uint64_t t = 0;
+  for (map<uint32_t, Camera>::const_iterator it = cameras_.begin();
+       it != cameras_.end(); ++it) {
+    const uint64_t t_camera = it->second.chunk_start.front();
+    if (t == 0 || t_camera < t) t = t_camera;
+  }
+  return t;
+}
+
+uint64_t VisionStore::EndTime() const {
+  uint64_t t = 0;
+  for (map<uint32_t, Camera>::const_iterator it = cameras_.begin();
+       it != cameras_.end(); ++it) {
+    t = std::max(t, it->second.chunks.back().t_capture.back());
+  }
+  return t;
+}
+
+bool VisionStore::FindFrame(const Camera& camera,
+                            uint64_t t,
+                            int* chunk,
+                            int* frame) {
+  // The last chunk that starts at or before t.
+  const vector<uint64_t>::const_iterator chunk_it = std::upper_bound(
+      camera.chunk_start.begin(), camera.chunk_start.end(), t);
+  if (chunk_it == camera.chunk_start.begin()) return false;
+  *chunk = (chunk_it - camera.chunk_start.begin()) - 1;
+  // The last frame of the chunk captured at or before t.
+  const vector<uint64_t>& t_capture = camera.chunks[*chunk].t_capture;
+  *frame = (std::upper_bound(t_capture.begin(), t_capture.end(), t) -
+            t_capture.begin()) - 1;
+  return true;
+}
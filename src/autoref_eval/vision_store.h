@@ -0,0 +1,161 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Time-indexed store of the ball and robot detections of a log.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#ifndef VISION_STORE_H_
+#define VISION_STORE_H_
+
+class SSL_DetectionFrame;
+
+// Store of the ball and robot detections of every camera, in order of their
+// capture times. Capture times are on the clock of the receive timestamps of
+// the log, which is the only clock shared by all the messages of a log:
+// SSL-Vision and the referees stamp their messages with their own clocks.
+//
+// Detections are stored in columns of floats, in chunks of a fixed number of
+// frames, so that the store grows without reallocating and copying the
+// frames stored so far, and needs little memory beyond the detections
+// themselves. Keeping every frame takes about 70 MB for an hour of 4 cameras
+// at 60 Hz, so with a retention set, only the chunks with frames captured
+// within the retention of the times passed to Keep() are kept, and the
+// others are evicted as frames are added. Memory is then bounded by the
+// number of kept times instead of the length of the log. The frame of a
+// camera at a given time is found by binary search over the start times of
+// the chunks, then the capture times of the frames in the chunk. Detections
+// are queried through a WorldTimeline, which fuses the frames of all
+// cameras.
+class VisionStore {
+ public:
+  // Number of frames per chunk, about a second at 60 Hz, which is also the
+  // granularity of the eviction.
+  static const int kChunkFrames = 64;
+
+  VisionStore();
+
+  // Remove all the frames and kept times. The retention is unchanged.
+  void Clear();
+
+  // Only keep the frames captured within retention of the times passed to
+  // Keep(), in microseconds. Zero, the default, keeps all frames. Chunks are
+  // evicted once frames captured 2 * retention after their end are added,
+  // so times must be kept before the frames of the log that much later.
+  void SetRetention(uint64_t retention) { retention_ = retention; }
+
+  // Keep the frames captured within the retention of t.
+  void Keep(uint64_t t);
+
+  // Evict the chunks not kept that were not evicted yet, after the last
+  // frame and kept time were added.
+  void Finish();
+
+  // Add a detection frame received at a receive timestamp of the log. Its
+  // capture time is the receive timestamp, less the time that SSL-Vision
+  // took to process it (t_sent - t_capture, both on the clock of vision).
+  // The frames of each camera must be added in order of their receive
+  // timestamps. The logger stamps messages before it orders them, so these
+  // may go back by a little; capture times that would go back are set to
+  // the previous capture time of the camera.
+  void AddFrame(const SSL_DetectionFrame& frame, uint64_t receive_timestamp);
+
+  // Number of frames stored, of all cameras.
+  uint64_t NumFrames() const { return num_frames_; }
+
+  // Approximate memory used by the store, in bytes.
+  uint64_t MemoryUsage() const;
+
+  // Capture times of the first and the last frames stored, of all cameras.
+  // Zero if empty.
+  uint64_t StartTime() const;
+  uint64_t EndTime() const;
+
+ private:
+  // Frames of one camera, in columns.
+  struct Chunk {
+    // Capture times of the frames on the clock of the log, in microseconds.
+    std::vector<uint64_t> t_capture;
+
+    // Index of the first ball and robot of each frame, with one more entry
+    // for the end of the last frame.
+    std::vector<uint32_t> ball_begin;
+    std::vector<uint32_t> robot_begin;
+
+    std::vector<float> ball_x;
+    std::vector<float> ball_y;
+    std::vector<float> ball_confidence;
+
+    std::vector<float> robot_x;
+    std::vector<float> robot_y;
+    std::vector<float> robot_orientation;
+    std::vector<float> robot_confidence;
+    // Robot id in the lower 7 bits, and team in the highest bit: 0 for
+    // yellow, 1 for blue.
+    std::vector<uint8_t> robot_id;
+  };
+
+  // Chunks of one camera. Adding a chunk to the deque does not copy the
+  // existing ones.
+  struct Camera {
+    Camera() : num_kept(0) {}
+
+    // Capture times of the first frame of each chunk.
+    std::vector<uint64_t> chunk_start;
+    std::deque<Chunk> chunks;
+
+    // Number of chunks at the start that were checked, and kept.
+    size_t num_kept;
+  };
+
+  friend class WorldTimeline;
+
+  // Find the chunk and the index in the chunk of the latest frame of a
+  // camera captured at or before t. Returns false if there is none.
+  static bool FindFrame(const Camera& camera,
+                        uint64_t t,
+                        int* chunk,
+                        int* frame);
+
+  // Release the excess capacity of the columns of a chunk.
+  static void Shrink(Chunk* chunk);
+
+  // Returns true iff a kept time is within the retention of [begin, end].
+  bool IsKept(uint64_t begin, uint64_t end) const;
+
+  // Evict the chunks of a camera that are not kept, up to the first chunk
+  // that frames captured at t may still be kept for, or all if final.
+  void Evict(uint64_t t, bool final, Camera* camera);
+
+  // Cameras, indexed by camera id.
+  std::map<uint32_t, Camera> cameras_;
+
+  uint64_t num_frames_;
+
+  uint64_t retention_;
+
+  // Kept times, in increasing order.
+  std::vector<uint64_t> kept_times_;
+};
+
+#endif  // VISION_STORE_H_
@@ -0,0 +1,166 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Fusion of the detection frames of all cameras into a timeline of world
+// frames at a fixed rate.
+
+#include "autoref_eval/world_timeline.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "autoref_eval/vision_store.h"
+
+using std::map;
+using std::vector;
+
+WorldTimeline::WorldTimeline() : t_begin_(0), period_(1) {}
+
+void WorldTimeline::Clear() {
+  ball_x_.clear();
+  ball_y_.clear();
+  ball_confidence_.clear();
+  ball_camera_.clear();
+  robot_x_.clear();
+  robot_y_.clear();
+  robot_orientation_.clear();
+  robot_confidence_.clear();
+  robot_camera_.clear();
+}
+
+bool WorldTimeline::Build(const VisionStore& store,
+                          uint64_t t_begin,
+                          uint64_t t_end,
+                          uint64_t period,
+                          uint64_t max_age) {
+  Clear();
+  if (period == 0 || t_end < t_begin ||
+      (t_end - t_begin) / period >= kMaxFrames) {
+    return false;
+  }
+  t_begin_ = t_begin;
+  period_ = period;
+  const size_t num_frames = (t_end - t_begin) / period + 1;
+  ball_x_.resize(num_frames, 0.0f);
+  ball_y_.resize(num_frames, 0.0f);
+  ball_confidence_.resize(num_frames, 0.0f);
+  ball_camera_.resize(num_frames, 0);
+  robot_x_.resize(num_frames * kNumSlots, 0.0f);
+  robot_y_.resize(num_frames * kNumSlots, 0.0f);
+  robot_orientation_.resize(num_frames * kNumSlots, 0.0f);
+  robot_confidence_.resize(num_frames * kNumSlots, 0.0f);
+  robot_camera_.resize(num_frames * kNumSlots, 0);
+
+  for (map<uint32_t, VisionStore::Camera>::const_iterator it =
+           store.cameras_.begin();
+       it != store.cameras_.end(); ++it) {
+    const VisionStore::Camera& camera = it->second;
+    // The latest frame of the camera at or before the current world frame,
+    // with frame = -1 before the first frame.
+    int chunk = 0;
+    int frame = -1;
+    VisionStore::FindFrame(camera, t_begin, &chunk, &frame);
+    for (size_t k = 0; k < num_frames; ++k) {
+      const uint64_t t = FrameTime(k);
+      while (true) {
+        int next_chunk = chunk;
+        int next_frame = frame + 1;
+        if (next_frame >= camera.chunks[chunk].t_capture.size()) {
+          ++next_chunk;
+          next_frame = 0;
+        }
+        if (next_chunk >= camera.chunks.size() ||
+            camera.chunks[next_chunk].t_capture[next_frame] > t) {
+          break;
+        }
+        chunk = next_chunk;
+        frame = next_frame;
+      }
+      if (frame < 0 ||
+          camera.chunks[chunk].t_capture[frame] + max_age < t) {
+        continue;
+      }
+      MergeFrame(camera.chunks[chunk], frame, it->first, k);
+    }
+  }
+  return true;
+}
+
+void WorldTimeline::MergeFrame(const VisionStore::Chunk& chunk,
+                               int frame,
+                               uint32_t camera_id,
+                               size_t k) {
+  for (uint32_t i = chunk.ball_begin[frame];
+       i < chunk.ball_begin[frame + 1]; ++i) {
+    if (chunk.ball_confidence[i] <= ball_confidence_[k]) continue;
+    ball_x_[k] = chunk.ball_x[i];
+    ball_y_[k] = chunk.ball_y[i];
+    ball_confidence_[k] = chunk.ball_confidence[i];
+    ball_camera_[k] = camera_id;
+  }
+  for (uint32_t i = chunk.robot_begin[frame];
+       i < chunk.robot_begin[frame + 1]; ++i) {
+    const int robot_id = chunk.robot_id[i] & 0x7F;
+    if (robot_id >= kMaxRobotIds) continue;
+    const int slot = (chunk.robot_id[i] >> 7) * kMaxRobotIds + robot_id;
+    const size_t j = k * kNumSlots + slot;
+    if (chunk.robot_confidence[i] <= robot_confidence_[j]) continue;
+    robot_x_[j] = chunk.robot_x[i];
+    robot_y_[j] = chunk.robot_y[i];
+    robot_orientation_[j] = chunk.robot_orientation[i];
+    robot_confidence_[j] = chunk.robot_confidence[i];
+    robot_camera_[j] = camera_id;
+  }
+}
+
+int WorldTimeline::FindFrame(uint64_t t) const {
+  if (NumFrames() == 0 || t < t_begin_) return -1;
+  const uint64_t frame = (t - t_begin_) / period_;
+  return (frame < NumFrames()) ? frame : (NumFrames() - 1);
+}
+
+bool WorldTimeline::GetBall(int frame, BallSample* ball) const {
+  if (ball_confidence_[frame] <= 0.0f) return false;
+  ball->camera_id = ball_camera_[frame];
+  ball->t = FrameTime(frame);
+  ball->x = ball_x_[frame];
+  ball->y = ball_y_[frame];
+  ball->confidence = ball_confidence_[frame];
+  return true;
+}
+
+void WorldTimeline::GetRobots(int frame, vector<RobotSample>* robots) const {
+  robots->clear();
+  for (int slot = 0; slot < kNumSlots; ++slot) {
+    const size_t j = static_cast<size_t>(frame) * kNumSlots + slot;
+    if (robot_confidence_[j] <= 0.0f) continue;
+    RobotSample robot;
+    robot.camera_id = robot_camera_[j];
+    robot.t = FrameTime(frame);
+    robot.team = static_cast<RobotSample::Team>(slot / kMaxRobotIds);
+    robot.robot_id = slot % kMaxRobotIds;
+    robot.x = robot_x_[j];
+    robot.y = robot_y_[j];
+    robot.orientation = robot_orientation_[j];
+    robot.confidence = robot_confidence_[j];
+    robots->push_back(robot);
+  }
+}
@@ -0,0 +1,166 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Fusion of the detection frames of all cameras into a timeline of world
+// frames at a fixed rate.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "autoref_eval/vision_store.h"
+
+#ifndef WORLD_TIMELINE_H_
+#define WORLD_TIMELINE_H_
+
+// A ball detection.
+struct BallSample {
+  BallSample() : camera_id(0), t(0), x(0), y(0), confidence(0) {}
+
+  uint32_t camera_id;
+
+  // Time of the world frame of the detection, in microseconds.
+  uint64_t t;
+
+  float x;
+  float y;
+  float confidence;
+};
+
+// A robot detection.
+struct RobotSample {
+  enum Team {
+    kYellow = 0,
+    kBlue = 1
+  };
+
+  RobotSample() :
+      camera_id(0), t(0), team(kYellow), robot_id(0),
+      x(0), y(0), orientation(0), confidence(0) {}
+
+  uint32_t camera_id;
+
+  // Time of the world frame of the detection, in microseconds.
+  uint64_t t;
+
+  Team team;
+  uint32_t robot_id;
+  float x;
+  float y;
+  float orientation;
+  float confidence;
+};
+
+// Timeline of world frames at a fixed rate, each the fusion of the latest
+// detection frames of every camera. Balls and robots seen by several cameras
+// in the overlap of their views are kept once, with the detection of the
+// highest confidence; a world frame has at most one ball.
+//
+// The frames are stored in columns of floats with a fixed number of robot
+// slots per frame, one for every robot id of each team, so that analyses
+// over many frames are simple loops over contiguous arrays. Confidences are
+// zero for balls and robots that were not detected.
+class WorldTimeline {
+ public:
+  // Number of robot ids of each team.
+  static const int kMaxRobotIds = 16;
+
+  // Number of robot slots per frame. The slot of a robot is
+  // team * kMaxRobotIds + robot id.
+  static const int kNumSlots = 2 * kMaxRobotIds;
+
+  // Maximum number of world frames, about 2.7 GB of columns, or 19 hours at
+  // 60 Hz.
+  static const size_t kMaxFrames = 1 << 22;
+
+  WorldTimeline();
+
+  // Remove all the frames.
+  void Clear();
+
+  // Fuse the frames of a vision store into world frames at the times
+  // t_begin + k * period, up to t_end. Every world frame merges the latest
+  // frame of each camera captured at most max_age before it. Takes
+  // O(cameras * log(frames)) time to find the first frames, and then time
+  // linear in the number of world frames and detections. Returns false, and
+  // leaves the timeline empty, if period is zero, t_end is before t_begin, or
+  // there would be more than kMaxFrames world frames.
+  bool Build(const VisionStore& store,
+             uint64_t t_begin,
+             uint64_t t_end,
+             uint64_t period,
+             uint64_t max_age);
+
+  // Number of world frames.
+  int NumFrames() const { return ball_confidence_.size(); }
+
+  // Time of a world frame, in microseconds.
+  uint64_t FrameTime(int frame) const {
+    return t_begin_ + static_cast<uint64_t>(frame) * period_;
+  }
+
+  // Returns the latest world frame at or before t, or -1 if there is none.
+  int FindFrame(uint64_t t) const;
+
+  // Get the ball of a world frame. Returns false if no ball was detected.
+  bool GetBall(int frame, BallSample* ball) const;
+
+  // Get the robots detected in a world frame, in order of their slots.
+  void GetRobots(int frame, std::vector<RobotSample>* robots) const;
+
+  // Columns of the balls, indexed by frame.
+  const std::vector<float>& ball_x() const { return ball_x_; }
+  const std::vector<float>& ball_y() const { return ball_y_; }
+  const std::vector<float>& ball_confidence() const {
+    return ball_confidence_;
+  }
+
+  // Columns of the robots, indexed by frame * kNumSlots + slot.
+  const std::vector<float>& robot_x() const { return robot_x_; }
+  const std::vector<float>& robot_y() const { return robot_y_; }
+  const std::vector<float>& robot_orientation() const {
+    return robot_orientation_;
+  }
+  const std::vector<float>& robot_confidence() const {
+    return robot_confidence_;
+  }
+
+ private:
+  // Merge a detection frame into world frame k.
+  void MergeFrame(const VisionStore::Chunk& chunk,
+                  int frame,
+                  uint32_t camera_id,
+                  size_t k);
+
+  uint64_t t_begin_;
+  uint64_t period_;
+
+  std::vector<float> ball_x_;
+  std::vector<float> ball_y_;
+  std::vector<float> ball_confidence_;
+  std::vector<uint32_t> ball_camera_;
+
+  std::vector<float> robot_x_;
+  std::vector<float> robot_y_;
+  std::vector<float> robot_orientation_;
+  std::vector<float> robot_confidence_;
+  std::vector<uint32_t> robot_camera_;
+};
+
+#endif  // WORLD_TIMELINE_H_
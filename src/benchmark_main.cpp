@@ -0,0 +1,1392 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+//
+// Benchmarks of the log pipeline: reading logs, loading and evaluating the
+// referee commands, publishing messages for playback, and serializing and
+// writing messages in the logger, on synthetic logs.
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "autoref_eval/evaluator.h"
+#include "autoref_eval/event_matcher.h"
+#include "autoref_eval/referee_event.h"
+#include "google/protobuf/stubs/logging.h"
+#include "google/protobuf/unknown_field_set.h"
+#include "referee.pb.h"
+#include "shared/log_generator.h"
+#include "shared/log_reader.h"
+#include "shared/log_writer.h"
+#include "shared/memory_transport.h"
+#include "shared/message_publisher.h"
+#include "shared/misc_util.h"
+#include "shared/netraw.h"
+#include "shared/pthread_utils.h"
+#include "shared/stream_recorder.h"
+#include "shared/wire_decoder.h"
+#include "udp_message_wrapper.pb.h"
+
+using google::protobuf::UnknownFieldSet;
+using std::make_pair;
+using std::map;
+using std::max;
+using std::min;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Maximum size of UDP datagrams to receive.
+static const int kMaxDatagramSize = 65536;
+
+// Multicast address of the referee messages.
+static const char* kRefereeMulticast = "224.5.23.1";
+
+// Duration of the game of the sample log of the micro benchmarks, in seconds.
+static const double kSampleDuration = 60.0;
+
+// Duration of the game of the log of the event benchmarks, in seconds, and
+// mean duration of play between events.
+static const double kEventsDuration = 7200.0;
+static const double kEventsPeriod = 3.0;
+
+// Number of memory allocations made so far, counted by the replacement of the
+// global operator new below, to report the allocations per item of every
+// benchmark.
+static uint64_t num_allocations_ = 0;
+
+void* operator new(size_t size) {
+  __sync_fetch_and_add(&num_allocations_, 1);
+  void* ptr = malloc((size > 0) ? size : 1);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+  __sync_fetch_and_add(&num_allocations_, 1);
+  return malloc((size > 0) ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) throw() {
+  return operator new(size, nothrow);
+}
+
+// All variants of operator delete free the memory of the replacements above.
+void operator delete(void* ptr) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) throw() {
+  free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+  free(ptr);
+}
+
+// State of a running benchmark, in the style of Google Benchmark: the
+// benchmark does its setup, then runs its loop while KeepRunning() returns
+// true, and reports the number of items and bytes processed. Only the loop is
+// timed.
+class BenchmarkState {
+ public:
+  explicit BenchmarkState(uint64_t iterations) :
+      iterations_(iterations), remaining_(iterations), items_(0), bytes_(0),
+      t_start_(0), t_end_(0), allocations_start_(0), allocations_end_(0),
+      error_(false) {}
+
+  bool KeepRunning() {
+    if (remaining_ == iterations_) {
+      allocations_start_ = num_allocations_;
+      t_start_ = GetMonotonicTimeNSec();
+    }
+    if (remaining_ == 0 || error_) {
+      t_end_ = GetMonotonicTimeNSec();
+      allocations_end_ = num_allocations_;
+      return false;
+    }
+    --remaining_;
+    return true;
+  }
+
+  void AddItems(uint64_t items) { items_ += items; }
+  void AddBytes(uint64_t bytes) { bytes_ += bytes; }
+
+  // Stop the benchmark, and report it as failed.
+  void SetError(const char* message) {
+    fprintf(stderr, "ERROR: %s\n", message);
+    error_ = true;
+  }
+
+  uint64_t iterations() const { return iterations_; }
+  uint64_t items() const { return items_; }
+  uint64_t bytes() const { return bytes_; }
+  bool error() const { return error_; }
+
+  // Duration of the loop, in nanoseconds.
+  uint64_t duration() const { return t_end_ - t_start_; }
+
+  // Number of memory allocations made in the loop.
+  uint64_t allocations() const {
+    return allocations_end_ - allocations_start_;
+  }
+
+ private:
+  const uint64_t iterations_;
+  uint64_t remaining_;
+  uint64_t items_;
+  uint64_t bytes_;
+  uint64_t t_start_;
+  uint64_t t_end_;
+  uint64_t allocations_start_;
+  uint64_t allocations_end_;
+  bool error_;
+};
+
+// Temporary directory of the generated logs, removed at exit.
+static string temp_dir_;
+
+// Remove the temporary directory, and the files in it.
+void RemoveTempDir() {
+  DIR* dir = opendir(temp_dir_.c_str());
+  if (dir != NULL) {
+    const struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+        unlink((temp_dir_ + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(temp_dir_.c_str());
+}
+
+// Create the temporary directory in $TMPDIR or /tmp, to be removed at exit.
+// Returns false on error.
+bool MakeTempDir() {
+  const char* tmp = getenv("TMPDIR");
+  string path = StringPrintf(
+      "%s/benchmark-XXXXXX", (tmp != NULL && tmp[0] != '\0') ? tmp : "/tmp");
+  if (mkdtemp(&path[0]) == NULL) {
+    perror(("Error creating \"" + path + "\"").c_str());
+    return false;
+  }
+  temp_dir_ = path;
+  atexit(RemoveTempDir);
+  return true;
+}
+
+// Inputs shared by the benchmarks.
+struct BenchmarkInputs {
+  // Short log with vision, and its records, in memory.
+  string sample_log;
+  vector<string> sample_records;
+
+  // Serialized SSL_Referee messages of the short log.
+  vector<string> referee_messages;
+
+  // Long log without vision, with many events.
+  string events_log;
+
+  // Directory for temporary files.
+  string dir;
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState* state,
+                                  const BenchmarkInputs& inputs);
+
+struct Benchmark {
+  Benchmark(const char* name, BenchmarkFunction function) :
+      name(name), function(function) {}
+  string name;
+  BenchmarkFunction function;
+};
+
+// Result of a benchmark, over all its repetitions.
+struct BenchmarkResult {
+  BenchmarkResult() :
+      iterations(0), repetitions(0), time_ns(0.0), min_time_ns(0.0),
+      items_per_second(0.0), bytes_per_second(0.0),
+      allocations_per_item(0.0) {}
+
+  string name;
+  uint64_t iterations;
+  int repetitions;
+
+  // Median and minimum time of an iteration over the repetitions, in
+  // nanoseconds.
+  double time_ns;
+  double min_time_ns;
+
+  // Throughput at the median time.
+  double items_per_second;
+  double bytes_per_second;
+
+  // Memory allocations per item processed.
+  double allocations_per_item;
+};
+
+// Recorders of the streams of a log, one for every address and port, as the
+// logger has one thread for every stream. Every datagram is recorded with
+// the current time as its receive timestamp.
+class LoggerStreams {
+ public:
+  explicit LoggerStreams(LogWriter* writer) : writer_(writer) {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+
+  ~LoggerStreams() {
+    for (size_t i = 0; i < recorders_.size(); ++i) {
+      delete recorders_[i];
+    }
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  // Record the datagram of a record, as the logger does when it receives it.
+  // Returns false on a write error.
+  bool Record(const EnvelopeView& envelope) {
+    StreamRecorder* recorder = NULL;
+    for (size_t i = 0; i < recorders_.size() && recorder == NULL; ++i) {
+      if (recorders_[i]->port() == envelope.port &&
+          envelope.AddressIs(recorders_[i]->address().c_str())) {
+        recorder = recorders_[i];
+      }
+    }
+    if (recorder == NULL) {
+      recorder = new StreamRecorder(
+          envelope.Address(), envelope.port, writer_, &mutex_);
+      recorders_.push_back(recorder);
+    }
+    return recorder->Record(envelope.data, envelope.data_size, GetTimeUSec());
+  }
+
+ private:
+  LogWriter* const writer_;
+  pthread_mutex_t mutex_;
+  vector<StreamRecorder*> recorders_;
+};
+
+// Write every record of a log to a log file, as the logger does.
+bool WriteLikeLogger(const vector<string>& records,
+                     const string& file_name,
+                     uint64_t* bytes) {
+  LogWriter writer;
+  if (!writer.Open(file_name)) return false;
+  bool success = true;
+  {
+    LoggerStreams streams(&writer);
+    for (size_t i = 0; i < records.size() && success; ++i) {
+      EnvelopeView envelope;
+      if (DecodeEnvelope(records[i].data(), records[i].size(), &envelope)) {
+        success = streams.Record(envelope);
+      }
+    }
+  }
+  *bytes = writer.bytes_written();
+  return (writer.Close() && success);
+}
+
+// Publisher of the messages of a log to in-process receivers, with the
+// publisher of playback.
+class MemoryPublisher {
+ public:
+  MemoryPublisher() : publisher_(&transport_), received_(0) {
+    publisher_.AddTarget(PlaybackTarget());
+    publisher_.Open();
+  }
+
+  ~MemoryPublisher() {
+    for (size_t i = 0; i < receivers_.size(); ++i) {
+      delete receivers_[i];
+    }
+  }
+
+  // Publish a message to its original address, and receive it.
+  bool Publish(const EnvelopeView& message) {
+    AddReceiver(message);
+    if (!publisher_.Publish(message)) return false;
+    // Drain the receivers, so that their queues never fill up.
+    Net::Address source;
+    for (size_t i = 0; i < receivers_.size(); ++i) {
+      while (receivers_[i]->recv(buffer_, kMaxDatagramSize, source) > 0) {
+        ++received_;
+      }
+    }
+    return true;
+  }
+
+  uint64_t received() const { return received_; }
+
+ private:
+  // Open a receiver for the original address and port of a message, unless
+  // there is one.
+  void AddReceiver(const EnvelopeView& message) {
+    for (size_t i = 0; i < streams_.size(); ++i) {
+      if (streams_[i].second == message.port &&
+          message.AddressIs(streams_[i].first.c_str())) {
+        return;
+      }
+    }
+    streams_.push_back(make_pair(message.Address(), message.port));
+    Net::Address address;
+    address.setHost(streams_.back().first.c_str(), message.port);
+    Net::Address interface;
+    interface.setAny();
+    Net::UDP* receiver = new Net::UDP(&transport_);
+    receiver->open(message.port, true, true, false);
+    receiver->addMulticast(address, interface);
+    receivers_.push_back(receiver);
+  }
+
+  Net::MemoryTransport transport_;
+  MessagePublisher publisher_;
+  vector<Net::UDP*> receivers_;
+  // Original address and port of every receiver.
+  vector<pair<string, int> > streams_;
+  char buffer_[kMaxDatagramSize];
+  uint64_t received_;
+};
+
+// Read every record of a log, and decode its envelope.
+void BM_ReadRecord(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  LogReader reader;
+  if (!reader.Open(inputs.sample_log)) state->SetError("Cannot read log");
+  while (state->KeepRunning()) {
+    reader.Rewind();
+    while (reader.ReadRecord()) {
+      EnvelopeView envelope;
+      DecodeEnvelope(reader.record(), reader.record_size(), &envelope);
+      state->AddItems(1);
+      state->AddBytes(reader.record_size());
+    }
+  }
+}
+
+// Read and parse every record of a log into a UDPMessageWrapper.
+void BM_ReadWrapper(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  LogReader reader;
+  if (!reader.Open(inputs.sample_log)) state->SetError("Cannot read log");
+  UDPMessageWrapper message;
+  while (state->KeepRunning()) {
+    reader.Rewind();
+    while (reader.Read(&message)) {
+      state->AddItems(1);
+      state->AddBytes(reader.record_size());
+    }
+  }
+}
+
+// Decode the envelopes of records in memory.
+void BM_DecodeEnvelope(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const vector<string>& records = inputs.sample_records;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < records.size(); ++i) {
+      EnvelopeView envelope;
+      DecodeEnvelope(records[i].data(), records[i].size(), &envelope);
+      state->AddBytes(records[i].size());
+    }
+    state->AddItems(records.size());
+  }
+}
+
+// Parse the envelopes of records in memory into a UDPMessageWrapper.
+void BM_ParseEnvelope(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const vector<string>& records = inputs.sample_records;
+  UDPMessageWrapper message;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < records.size(); ++i) {
+      message.ParseFromArray(records[i].data(), records[i].size());
+      state->AddBytes(records[i].size());
+    }
+    state->AddItems(records.size());
+  }
+}
+
+// Parse referee messages in memory into an SSL_Referee.
+void BM_ParseReferee(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const vector<string>& messages = inputs.referee_messages;
+  SSL_Referee message;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < messages.size(); ++i) {
+      message.ParseFromArray(messages[i].data(), messages[i].size());
+      state->AddBytes(messages[i].size());
+    }
+    state->AddItems(messages.size());
+  }
+}
+
+// Decode referee messages in memory with the wire decoder.
+void BM_DecodeReferee(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const vector<string>& messages = inputs.referee_messages;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < messages.size(); ++i) {
+      RefereeView view;
+      DecodeReferee(messages[i].data(), messages[i].size(), &view);
+      state->AddBytes(messages[i].size());
+    }
+    state->AddItems(messages.size());
+  }
+}
+
+// Load the referee commands of a log, and extract their events.
+void BM_LoadReferees(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  Evaluator evaluator;
+  while (state->KeepRunning()) {
+    if (!evaluator.Load(inputs.sample_log)) state->SetError("Cannot load log");
+    state->AddItems(inputs.sample_records.size());
+  }
+}
+
+// Load the referee commands and the vision of a log.
+void BM_LoadVision(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  Evaluator evaluator;
+  evaluator.set_load_vision(true);
+  while (state->KeepRunning()) {
+    if (!evaluator.Load(inputs.sample_log)) state->SetError("Cannot load log");
+    state->AddItems(inputs.sample_records.size());
+  }
+}
+
+// Extract the events from the commands of the human referee.
+void BM_ExtractEvents(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  Evaluator evaluator;
+  if (!evaluator.Load(inputs.events_log)) state->SetError("Cannot load log");
+  const vector<RefereeView>& commands = evaluator.referees()[0].commands;
+  vector<RefereeEvent> events;
+  while (state->KeepRunning()) {
+    ExtractEvents(commands, &events, NULL);
+    state->AddItems(commands.size());
+  }
+}
+
+// Match the events of an autoref to those of the human referee.
+void BM_MatchEvents(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  Evaluator evaluator;
+  if (!evaluator.Load(inputs.events_log) || evaluator.referees().size() < 2) {
+    state->SetError("Cannot load log");
+  }
+  const vector<RefereeEvent>& human = evaluator.referees()[0].events;
+  const vector<RefereeEvent>& autoref = evaluator.referees()[1].events;
+  vector<EventEvaluation> evaluations;
+  while (state->KeepRunning()) {
+    const EventMatcher matcher(human, autoref);
+    matcher.Match(Evaluator::kDefaultAutoToHumanDelay,
+                  Evaluator::kDefaultHumanToAutoDelay,
+                  &evaluations);
+    state->AddItems(human.size() + autoref.size());
+  }
+}
+
+// Evaluate every autoref of a loaded log: matching, and computing the counts,
+// confusion and timing.
+void BM_Evaluate(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  Evaluator evaluator;
+  evaluator.set_use_annotations(false);
+  if (!evaluator.Load(inputs.events_log)) state->SetError("Cannot load log");
+  int num_events = 0;
+  for (size_t i = 0; i < evaluator.referees().size(); ++i) {
+    num_events += evaluator.referees()[i].events.size();
+  }
+  vector<AutorefEvaluation> evaluations;
+  while (state->KeepRunning()) {
+    if (!evaluator.Evaluate(&evaluations)) state->SetError("Cannot evaluate");
+    state->AddItems(num_events);
+  }
+}
+
+// Publish the messages of a log, as playback does, to in-process receivers.
+void BM_Publish(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const vector<string>& records = inputs.sample_records;
+  MemoryPublisher publisher;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < records.size(); ++i) {
+      EnvelopeView message;
+      if (!DecodeEnvelope(records[i].data(), records[i].size(), &message)) {
+        continue;
+      }
+      if (!publisher.Publish(message)) state->SetError("Cannot publish");
+      state->AddBytes(message.data_size);
+    }
+    state->AddItems(records.size());
+  }
+  if (publisher.received() != state->items()) {
+    state->SetError("Messages were lost");
+  }
+}
+
+// Serialize and write the messages of a log, as the logger does.
+void BM_LoggerWrite(BenchmarkState* state, const BenchmarkInputs& inputs) {
+  const string file_name = inputs.dir + "/benchmark-write.log";
+  while (state->KeepRunning()) {
+    uint64_t bytes = 0;
+    if (!WriteLikeLogger(inputs.sample_records, file_name, &bytes)) {
+      state->SetError("Cannot write log");
+    }
+    state->AddItems(inputs.sample_records.size());
+    state->AddBytes(bytes);
+  }
+  unlink(file_name.c_str());
+}
+
+// Run a benchmark once with the given number of iterations. Returns false on
+// error.
+bool RunOnce(const Benchmark& benchmark,
+             const BenchmarkInputs& inputs,
+             uint64_t iterations,
+             BenchmarkState** state) {
+  *state = new BenchmarkState(iterations);
+  benchmark.function(*state, inputs);
+  return !(*state)->error();
+}
+
+// Run a benchmark: find the number of iterations that takes at least
+// min_time seconds, then time that number of iterations the given number of
+// times.
+bool RunBenchmark(const Benchmark& benchmark,
+                  const BenchmarkInputs& inputs,
+                  double min_time,
+                  int repetitions,
+                  BenchmarkResult* result) {
+  static const uint64_t kMaxIterations = 1000000000;
+  uint64_t iterations = 1;
+  while (true) {
+    BenchmarkState* state = NULL;
+    const bool success = RunOnce(benchmark, inputs, iterations, &state);
+    const double seconds = 1e-9 * static_cast<double>(state->duration());
+    delete state;
+    if (!success) return false;
+    if (seconds >= min_time || iterations >= kMaxIterations) break;
+    // Aim 40% beyond the minimum time, growing by at most 100x.
+    const double scale = (seconds > 0.0) ? (1.4 * min_time / seconds) : 100.0;
+    const uint64_t next = iterations * min(scale, 100.0);
+    iterations = min(kMaxIterations, max(iterations + 1, next));
+  }
+  vector<double> times;
+  uint64_t items = 0;
+  uint64_t bytes = 0;
+  uint64_t allocations = 0;
+  for (int i = 0; i < repetitions; ++i) {
+    BenchmarkState* state = NULL;
+    const bool success = RunOnce(benchmark, inputs, iterations, &state);
+    times.push_back(static_cast<double>(state->duration()) /
+                    static_cast<double>(iterations));
+    items = state->items();
+    bytes = state->bytes();
+    allocations = state->allocations();
+    delete state;
+    if (!success) return false;
+  }
+  std::sort(times.begin(), times.end());
+  result->name = benchmark.name;
+  result->iterations = iterations;
+  result->repetitions = repetitions;
+  result->time_ns = times[times.size() / 2];
+  result->min_time_ns = times[0];
+  const double seconds = 1e-9 * result->time_ns * iterations;
+  result->items_per_second = static_cast<double>(items) / seconds;
+  result->bytes_per_second = static_cast<double>(bytes) / seconds;
+  if (items > 0) {
+    result->allocations_per_item =
+        static_cast<double>(allocations) / static_cast<double>(items);
+  }
+  return true;
+}
+
+// Time one run of an end-to-end step over a log of the given size.
+struct EndToEndRun {
+  explicit EndToEndRun(const string& name) :
+      name(name), t_start(GetMonotonicTimeNSec()),
+      allocations_start(num_allocations_), bytes(0), items(0) {}
+
+  BenchmarkResult Finish() const {
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = 1;
+    result.repetitions = 1;
+    result.time_ns = GetMonotonicTimeNSec() - t_start;
+    result.min_time_ns = result.time_ns;
+    result.items_per_second =
+        1e9 * static_cast<double>(items) / result.time_ns;
+    result.bytes_per_second =
+        1e9 * static_cast<double>(bytes) / result.time_ns;
+    if (items > 0) {
+      result.allocations_per_item =
+          static_cast<double>(num_allocations_ - allocations_start) /
+          static_cast<double>(items);
+    }
+    return result;
+  }
+
+  const string name;
+  const uint64_t t_start;
+  const uint64_t allocations_start;
+  uint64_t bytes;
+  uint64_t items;
+};
+
+// Generate a synthetic log. Returns false on error.
+bool GenerateLog(const SyntheticLogParameters& parameters,
+                 const string& file_name,
+                 uint64_t* bytes) {
+  LogWriter writer;
+  if (!writer.Open(file_name) ||
+      !GenerateSyntheticLog(parameters, &writer) ||
+      !writer.Close()) {
+    fprintf(stderr, "Error writing \"%s\"\n", file_name.c_str());
+    return false;
+  }
+  *bytes = writer.bytes_written();
+  return true;
+}
+
+// Run the end-to-end benchmarks on a synthetic log of about the given size in
+// log_dir: reading it, evaluating it, playing it back to in-process
+// receivers, and writing it again as the logger would. The log is generated
+// first, unless it already exists.
+bool RunEndToEnd(double gigabytes,
+                 uint64_t seed,
+                 double bytes_per_second,
+                 const string& log_dir,
+                 const BenchmarkInputs& inputs,
+                 vector<BenchmarkResult>* results) {
+  const uint64_t size = gigabytes * 1024.0 * 1024.0 * 1024.0;
+  const string label = StringPrintf("e2e/%gGB", gigabytes);
+  const string log_file = StringPrintf(
+      "%s/benchmark-%gGB-%" PRIu64 ".log", log_dir.c_str(), gigabytes, seed);
+  uint64_t log_size = 0;
+  int64_t log_mtime = 0;
+  if (!GetFileStatus(log_file, &log_size, &log_mtime)) {
+    printf("Generating %s\n", log_file.c_str());
+    fflush(stdout);
+    SyntheticLogParameters parameters;
+    parameters.seed = seed;
+    parameters.duration = static_cast<double>(size) / bytes_per_second;
+    parameters.autorefs.resize(2);
+    EndToEndRun run(label + "/generate");
+    if (!GenerateLog(parameters, log_file, &log_size)) return false;
+    run.bytes = log_size;
+    results->push_back(run.Finish());
+  }
+
+  {
+    EndToEndRun run(label + "/read");
+    LogReader reader;
+    if (!reader.Open(log_file)) return false;
+    while (reader.ReadRecord()) {
+      EnvelopeView envelope;
+      DecodeEnvelope(reader.record(), reader.record_size(), &envelope);
+      ++run.items;
+    }
+    run.bytes = log_size;
+    results->push_back(run.Finish());
+  }
+
+  {
+    EndToEndRun run(label + "/evaluate");
+    Evaluator evaluator;
+    evaluator.set_use_annotations(false);
+    vector<AutorefEvaluation> evaluations;
+    if (!evaluator.Load(log_file) || !evaluator.Evaluate(&evaluations)) {
+      return false;
+    }
+    run.items = evaluator.referees()[0].events.size();
+    run.bytes = log_size;
+    results->push_back(run.Finish());
+  }
+
+  {
+    EndToEndRun run(label + "/playback");
+    LogReader reader;
+    if (!reader.Open(log_file)) return false;
+    MemoryPublisher publisher;
+    while (reader.ReadRecord()) {
+      EnvelopeView message;
+      if (!DecodeEnvelope(reader.record(), reader.record_size(), &message)) {
+        continue;
+      }
+      if (!publisher.Publish(message)) return false;
+      ++run.items;
+    }
+    run.bytes = log_size;
+    results->push_back(run.Finish());
+  }
+
+  {
+    EndToEndRun run(label + "/logger_write");
+    const string copy_file = inputs.dir + "/benchmark-copy.log";
+    LogReader reader;
+    if (!reader.Open(log_file)) return false;
+    LogWriter writer;
+    if (!writer.Open(copy_file)) return false;
+    {
+      LoggerStreams streams(&writer);
+      while (reader.ReadRecord()) {
+        EnvelopeView envelope;
+        if (!DecodeEnvelope(reader.record(), reader.record_size(),
+                            &envelope)) {
+          continue;
+        }
+        if (!streams.Record(envelope)) return false;
+        ++run.items;
+      }
+    }
+    if (!writer.Close()) return false;
+    run.bytes = writer.bytes_written();
+    results->push_back(run.Finish());
+    unlink(copy_file.c_str());
+  }
+  return true;
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  printf("%-36s %12.0f ns %10" PRIu64 " %14.0f items/s %10.1f MB/s "
+         "%8.3f allocs/item\n",
+         result.name.c_str(),
+         result.time_ns,
+         result.iterations,
+         result.items_per_second,
+         result.bytes_per_second / (1024.0 * 1024.0),
+         result.allocations_per_item);
+  fflush(stdout);
+}
+
+// Write the results as JSON, with one benchmark per line.
+bool WriteJson(const string& file_name,
+               const vector<BenchmarkResult>& results,
+               uint64_t seed) {
+  ScopedFile fid(file_name, "w", true);
+  if (fid() == NULL) return false;
+  char date[64];
+  const time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+#ifdef __OPTIMIZE__
+  static const bool kOptimized = true;
+#else
+  static const bool kOptimized = false;
+#endif
+  fprintf(fid,
+          "{\n"
+          "  \"context\": {\"date\": \"%s\", \"num_cpus\": %ld, "
+          "\"optimized\": %s, \"seed\": %" PRIu64 "},\n"
+          "  \"benchmarks\": [\n",
+          date,
+          sysconf(_SC_NPROCESSORS_ONLN),
+          kOptimized ? "true" : "false",
+          seed);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    fprintf(fid,
+            "    {\"name\": \"%s\", \"iterations\": %" PRIu64 ", "
+            "\"repetitions\": %d, \"time_ns\": %.1f, \"min_time_ns\": %.1f, "
+            "\"items_per_second\": %.1f, \"bytes_per_second\": %.1f, "
+            "\"allocations_per_item\": %.4f}%s\n",
+            result.name.c_str(),
+            result.iterations,
+            result.repetitions,
+            result.time_ns,
+            result.min_time_ns,
+            result.items_per_second,
+            result.bytes_per_second,
+            result.allocations_per_item,
+            (i + 1 < results.size()) ? "," : "");
+  }
+  fprintf(fid, "  ]\n}\n");
+  return (ferror(fid) == 0);
+}
+
+// Read the times of the benchmarks of a JSON file written by WriteJson().
+bool ReadJson(const string& file_name, map<string, double>* times) {
+  ScopedFile fid(file_name, "r", true);
+  if (fid() == NULL) return false;
+  char line[1024];
+  while (fgets(line, sizeof(line), fid) != NULL) {
+    const char* name = strstr(line, "\"name\": \"");
+    const char* time_ns = strstr(line, "\"time_ns\": ");
+    if (name == NULL || time_ns == NULL) continue;
+    name += strlen("\"name\": \"");
+    const char* name_end = strchr(name, '"');
+    if (name_end == NULL) continue;
+    (*times)[string(name, name_end - name)] =
+        atof(time_ns + strlen("\"time_ns\": "));
+  }
+  return true;
+}
+
+// Print the change of the time of every benchmark relative to a baseline.
+// Returns the number of benchmarks that are slower by more than threshold.
+int CompareToBaseline(const vector<BenchmarkResult>& results,
+                      const map<string, double>& baseline,
+                      double threshold) {
+  int num_regressions = 0;
+  printf("%-36s %15s %15s %8s\n", "Benchmark", "Baseline (ns)", "Time (ns)",
+         "Change");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    map<string, double>::const_iterator it = baseline.find(result.name);
+    if (it == baseline.end() || it->second <= 0.0) {
+      printf("%-36s %15s %15.0f\n", result.name.c_str(), "-", result.time_ns);
+      continue;
+    }
+    const double change = result.time_ns / it->second - 1.0;
+    const bool regression = (change > threshold);
+    if (regression) ++num_regressions;
+    printf("%-36s %15.0f %15.0f %+7.1f%%%s\n",
+           result.name.c_str(),
+           it->second,
+           result.time_ns,
+           100.0 * change,
+           regression ? "  REGRESSION" : "");
+  }
+  return num_regressions;
+}
+
+// Parse a comma-separated list of positive numbers.
+// Append a varint to a string.
+void AppendVarint(uint64_t value, string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Returns a random integer of random bit width.
+uint64_t RandomInteger(Random* random) {
+  return (random->Next() >> random->Uniform(64));
+}
+
+// Returns a string of up to max_size random bytes.
+string RandomBytes(size_t max_size, Random* random) {
+  string bytes(random->Uniform(max_size + 1), '\0');
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<char>(random->Next());
+  }
+  return bytes;
+}
+
+// Add up to three random unknown fields to a field set, including nested
+// groups. The field numbers are mostly those of known fields, so that known
+// fields also occur with the wrong wire types.
+void AddRandomUnknownFields(int depth,
+                            Random* random,
+                            UnknownFieldSet* fields) {
+  const int num_fields = random->Uniform(4);
+  for (int i = 0; i < num_fields; ++i) {
+    const int number = 1 + ((random->Uniform(4) == 0) ?
+        random->Uniform(1000) : random->Uniform(12));
+    switch (random->Uniform(5)) {
+      case 0: {
+        fields->AddVarint(number, RandomInteger(random));
+      } break;
+      case 1: {
+        fields->AddFixed32(number, random->Next());
+      } break;
+      case 2: {
+        fields->AddFixed64(number, random->Next());
+      } break;
+      case 3: {
+        fields->AddLengthDelimited(number, RandomBytes(16, random));
+      } break;
+      default: {
+        if (depth < 3) {
+          AddRandomUnknownFields(depth + 1, random, fields->AddGroup(number));
+        }
+      }
+    }
+  }
+}
+
+// Fill a team info with random values. Every required field is missing with a
+// small probability.
+void RandomTeamInfo(Random* random, SSL_Referee_TeamInfo* team) {
+  static const double kMissing = 0.05;
+  if (random->UniformReal() > kMissing) team->set_name(RandomBytes(8, random));
+  if (random->UniformReal() > kMissing) team->set_score(random->Uniform(10));
+  if (random->UniformReal() > kMissing) team->set_red_cards(random->Next());
+  const int num_yellow_cards = random->Uniform(4);
+  for (int i = 0; i < num_yellow_cards; ++i) {
+    team->add_yellow_card_times(RandomInteger(random));
+  }
+  if (random->UniformReal() > kMissing) team->set_yellow_cards(3);
+  if (random->UniformReal() > kMissing) team->set_timeouts(4);
+  if (random->UniformReal() > kMissing) {
+    team->set_timeout_time(RandomInteger(random));
+  }
+  if (random->UniformReal() > kMissing) team->set_goalie(random->Uniform(12));
+  if (random->Uniform(4) == 0) {
+    AddRandomUnknownFields(1, random, team->mutable_unknown_fields());
+  }
+}
+
+// Returns a random serialized SSL_Referee message, that is mostly valid, with
+// unknown fields, invalid enum values, and fields that occur several times.
+string RandomReferee(Random* random) {
+  static const double kMissing = 0.02;
+  SSL_Referee message;
+  if (random->UniformReal() > kMissing) {
+    message.set_packet_timestamp(RandomInteger(random));
+  }
+  const int stage = random->Uniform(SSL_Referee_Stage_Stage_MAX + 1);
+  if (random->UniformReal() > kMissing && SSL_Referee_Stage_IsValid(stage)) {
+    message.set_stage(static_cast<SSL_Referee_Stage>(stage));
+  }
+  if (random->Uniform(2) == 0) {
+    message.set_stage_time_left(RandomInteger(random));
+  }
+  const int command = random->Uniform(SSL_Referee_Command_Command_MAX + 1);
+  if (random->UniformReal() > kMissing &&
+      SSL_Referee_Command_IsValid(command)) {
+    message.set_command(static_cast<SSL_Referee_Command>(command));
+  }
+  if (random->UniformReal() > kMissing) {
+    message.set_command_counter(random->Next());
+  }
+  if (random->UniformReal() > kMissing) {
+    message.set_command_timestamp(RandomInteger(random));
+  }
+  if (random->UniformReal() > kMissing) {
+    RandomTeamInfo(random, message.mutable_yellow());
+  }
+  if (random->UniformReal() > kMissing) {
+    RandomTeamInfo(random, message.mutable_blue());
+  }
+  if (random->Uniform(4) == 0) {
+    SSL_Referee_Point* position = message.mutable_designated_position();
+    if (random->UniformReal() > kMissing) position->set_x(random->Next());
+    if (random->UniformReal() > kMissing) position->set_y(random->Next());
+  }
+  if (random->Uniform(4) == 0) {
+    AddRandomUnknownFields(1, random, message.mutable_unknown_fields());
+  }
+  string serialized;
+  message.SerializePartialToString(&serialized);
+  if (random->Uniform(8) == 0) {
+    // Stage or command, with a value that may be invalid.
+    AppendVarint((random->Uniform(2) == 0) ? 0x10 : 0x20, &serialized);
+    AppendVarint(RandomInteger(random), &serialized);
+  }
+  if (random->Uniform(8) == 0) {
+    // A second message, merged into the first by the parser.
+    serialized += RandomReferee(random);
+  }
+  return serialized;
+}
+
+// Returns a random serialized UDPMessageWrapper, with unknown fields and
+// fields that occur several times.
+string RandomEnvelope(const vector<string>& payloads, Random* random) {
+  UDPMessageWrapper message;
+  if (random->Uniform(4) > 0) message.set_address(RandomBytes(16, random));
+  if (random->Uniform(4) > 0) message.set_port(RandomInteger(random));
+  if (random->Uniform(4) > 0) message.set_timestamp(RandomInteger(random));
+  if (random->Uniform(4) > 0) {
+    message.set_data(payloads.empty() ?
+        RandomBytes(64, random) : payloads[random->Uniform(payloads.size())]);
+  }
+  if (random->Uniform(4) == 0) {
+    AddRandomUnknownFields(1, random, message.mutable_unknown_fields());
+  }
+  string serialized;
+  message.SerializeToString(&serialized);
+  if (random->Uniform(8) == 0) serialized += RandomEnvelope(payloads, random);
+  return serialized;
+}
+
+// Apply one to four random mutations to a byte string: bit flips, byte
+// changes, truncation, insertions, deletions and duplicated ranges.
+void MutateBytes(Random* random, string* bytes) {
+  static const char kBytes[] = { '\x00', '\x7F', '\x80', '\xFF' };
+  const int num_mutations = 1 + random->Uniform(4);
+  for (int i = 0; i < num_mutations; ++i) {
+    const size_t position = random->Uniform(bytes->size() + 1);
+    const bool at_byte = (position < bytes->size());
+    switch (random->Uniform(6)) {
+      case 0: {
+        if (at_byte) (*bytes)[position] ^= (1 << random->Uniform(8));
+      } break;
+      case 1: {
+        if (at_byte) (*bytes)[position] = kBytes[random->Uniform(4)];
+      } break;
+      case 2: {
+        bytes->resize(position);
+      } break;
+      case 3: {
+        bytes->insert(position, 1, static_cast<char>(random->Next()));
+      } break;
+      case 4: {
+        if (at_byte) bytes->erase(position, 1);
+      } break;
+      default: {
+        const size_t size = random->Uniform(bytes->size() - position + 1);
+        bytes->insert(random->Uniform(bytes->size() + 1),
+                      bytes->substr(position, size));
+      }
+    }
+  }
+}
+
+// Returns a fuzzed input: a generated message, a mutated sample or generated
+// message, or random bytes.
+string FuzzInput(const vector<string>& samples,
+                 const string& generated,
+                 Random* random) {
+  switch (random->Uniform(4)) {
+    case 0: {
+      return generated;
+    }
+    case 1: {
+      string input = generated;
+      MutateBytes(random, &input);
+      return input;
+    }
+    case 2: {
+      if (samples.empty()) return generated;
+      string input = samples[random->Uniform(samples.size())];
+      MutateBytes(random, &input);
+      return input;
+    }
+    default: {
+      return RandomBytes(64, random);
+    }
+  }
+}
+
+// Counts of inputs of a decoder verification.
+struct VerifyCounts {
+  VerifyCounts() : accepted(0), rejected(0), mismatched(0) {}
+  uint64_t accepted;
+  uint64_t rejected;
+  uint64_t mismatched;
+};
+
+// Count the outcome of an input. Prints the first mismatches in hex.
+void CountOutcome(const char* decoder,
+                  const string& input,
+                  bool parsed,
+                  bool decoded,
+                  bool same_values,
+                  VerifyCounts* counts) {
+  static const uint64_t kMaxPrinted = 10;
+  if (parsed == decoded && (!parsed || same_values)) {
+    ++(parsed ? counts->accepted : counts->rejected);
+    return;
+  }
+  if (++counts->mismatched > kMaxPrinted) return;
+  fprintf(stderr, "%s mismatch, parsed:%d decoded:%d input:",
+          decoder, parsed, decoded);
+  for (size_t i = 0; i < input.size(); ++i) {
+    fprintf(stderr, " %02X", static_cast<uint8_t>(input[i]));
+  }
+  fprintf(stderr, "\n");
+}
+
+// Returns true iff a string is equal to the string of other_size bytes at
+// other.
+bool NameIs(const string& name, const char* other, size_t other_size) {
+  return (name.size() == other_size &&
+          (other_size == 0 || memcmp(name.data(), other, other_size) == 0));
+}
+
+// Verify that DecodeEnvelope() and DecodeReferee() accept exactly the inputs
+// that the generated parsers accept, with the same values of the decoded
+// fields, on the given number of fuzzed inputs each. Returns false on any
+// mismatch.
+bool VerifyDecoders(const BenchmarkInputs& inputs,
+                    uint64_t seed,
+                    int num_inputs) {
+  // The parser logs an error for every message without its required fields.
+  const google::protobuf::LogSilencer log_silencer;
+  Random random(seed);
+  UDPMessageWrapper wrapper;
+  SSL_Referee referee;
+  VerifyCounts envelope_counts;
+  VerifyCounts referee_counts;
+  for (int i = 0; i < num_inputs; ++i) {
+    string input = FuzzInput(
+        inputs.sample_records,
+        RandomEnvelope(inputs.referee_messages, &random),
+        &random);
+    EnvelopeView envelope;
+    bool parsed = wrapper.ParseFromArray(input.data(), input.size());
+    bool decoded = DecodeEnvelope(input.data(), input.size(), &envelope);
+    const bool same_envelope =
+        envelope.address_size == wrapper.address().size() &&
+        (envelope.address_size == 0 ||
+         memcmp(envelope.address, wrapper.address().data(),
+                envelope.address_size) == 0) &&
+        envelope.port == wrapper.port() &&
+        envelope.timestamp == wrapper.timestamp() &&
+        envelope.data_size == wrapper.data().size() &&
+        (envelope.data_size == 0 ||
+         memcmp(envelope.data, wrapper.data().data(), envelope.data_size) == 0);
+    CountOutcome("DecodeEnvelope", input, parsed, decoded, same_envelope,
+                 &envelope_counts);
+
+    input = FuzzInput(inputs.referee_messages, RandomReferee(&random),
+                      &random);
+    RefereeView view;
+    parsed = referee.ParseFromArray(input.data(), input.size());
+    decoded = DecodeReferee(input.data(), input.size(), &view);
+    const bool same_referee =
+        view.packet_timestamp == referee.packet_timestamp() &&
+        view.stage == referee.stage() &&
+        view.command == referee.command() &&
+        view.command_counter == referee.command_counter() &&
+        view.command_timestamp == referee.command_timestamp() &&
+        NameIs(referee.yellow().name(),
+               view.yellow_name, view.yellow_name_size) &&
+        NameIs(referee.blue().name(), view.blue_name, view.blue_name_size);
+    CountOutcome("DecodeReferee", input, parsed, decoded, same_referee,
+                 &referee_counts);
+  }
+  printf("Verified decoders on %d fuzzed inputs each:\n", num_inputs);
+  printf("  DecodeEnvelope: %" PRIu64 " accepted, %" PRIu64 " rejected, "
+         "%" PRIu64 " mismatched\n", envelope_counts.accepted,
+         envelope_counts.rejected, envelope_counts.mismatched);
+  printf("  DecodeReferee:  %" PRIu64 " accepted, %" PRIu64 " rejected, "
+         "%" PRIu64 " mismatched\n", referee_counts.accepted,
+         referee_counts.rejected, referee_counts.mismatched);
+  return (envelope_counts.mismatched == 0 && referee_counts.mismatched == 0);
+}
+
+bool ParseSizes(const char* arg, vector<double>* sizes) {
+  sizes->clear();
+  const char* ptr = arg;
+  while (true) {
+    char* end = NULL;
+    const double value = strtod(ptr, &end);
+    if (end == ptr || value <= 0.0) return false;
+    sizes->push_back(value);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    ptr = end + 1;
+  }
+}
+
+void PrintUsage() {
+  printf("Usage: benchmark [options]\n"
+         "Options:\n"
+         "  -filter TEXT     Only run the benchmarks with TEXT in their name.\n"
+         "  -min-time S      Minimum time of every repetition of a micro\n"
+         "                   benchmark, in seconds. Default: 0.5\n"
+         "  -repetitions N   Repetitions of every micro benchmark, of which\n"
+         "                   the median is reported. Default: 3\n"
+         "  -e2e SIZES       Also run the end-to-end benchmarks on generated\n"
+         "                   logs of the given comma-separated sizes in GB,\n"
+         "                   e.g. 1,10,100.\n"
+         "  -dir DIR         Keep the logs of -e2e in DIR, and reuse them in\n"
+         "                   later runs. Default: a temporary directory,\n"
+         "                   removed at exit, as are all other generated\n"
+         "                   logs.\n"
+         "  -seed S          Seed of the generated logs. Default: 1\n"
+         "  -fuzz N          Verify the wire decoders against the generated\n"
+         "                   parsers on N fuzzed inputs before running the\n"
+         "                   benchmarks, 0 to skip. Default: 100000\n"
+         "  -json FILE       Write the results to FILE as JSON.\n"
+         "  -compare FILE    Compare the results to a baseline JSON file\n"
+         "                   written with -json, and exit with an error if\n"
+         "                   any benchmark is slower by more than the\n"
+         "                   threshold.\n"
+         "  -threshold F     Relative slowdown that is a regression.\n"
+         "                   Default: 0.1\n");
+}
+
+int main(int argc, char* argv[]) {
+  string filter;
+  double min_time = 0.5;
+  int repetitions = 3;
+  vector<double> e2e_sizes;
+  string json_file;
+  string baseline_file;
+  double threshold = 0.1;
+  uint64_t seed = 1;
+  int num_fuzz_inputs = 100000;
+  string log_dir;
+  BenchmarkInputs inputs;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-filter") == 0 && has_value) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "-min-time") == 0 && has_value) {
+      min_time = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-repetitions") == 0 && has_value) {
+      repetitions = max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "-e2e") == 0 && has_value) {
+      if (!ParseSizes(argv[++i], &e2e_sizes)) {
+        fprintf(stderr, "Invalid sizes \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-dir") == 0 && has_value) {
+      log_dir = argv[++i];
+    } else if (strcmp(argv[i], "-seed") == 0 && has_value) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-fuzz") == 0 && has_value) {
+      num_fuzz_inputs = max(0, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "-json") == 0 && has_value) {
+      json_file = argv[++i];
+    } else if (strcmp(argv[i], "-compare") == 0 && has_value) {
+      baseline_file = argv[++i];
+    } else if (strcmp(argv[i], "-threshold") == 0 && has_value) {
+      threshold = atof(argv[++i]);
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+#ifndef __OPTIMIZE__
+  printf("WARNING: benchmark was built without optimization, configure with "
+         "-DCMAKE_BUILD_TYPE=Release\n");
+#endif
+  map<string, double> baseline;
+  if (!baseline_file.empty() && !ReadJson(baseline_file, &baseline)) {
+    return 1;
+  }
+  if (!MakeTempDir()) return 1;
+  inputs.dir = temp_dir_;
+  if (log_dir.empty()) log_dir = temp_dir_;
+
+  // Generate the logs of the micro benchmarks.
+  SyntheticLogParameters sample_parameters;
+  sample_parameters.seed = seed;
+  sample_parameters.duration = kSampleDuration;
+  sample_parameters.autorefs.resize(2);
+  inputs.sample_log = StringPrintf(
+      "%s/benchmark-sample-%" PRIu64 ".log", inputs.dir.c_str(), seed);
+  uint64_t sample_size = 0;
+  if (!GenerateLog(sample_parameters, inputs.sample_log, &sample_size)) {
+    return 1;
+  }
+  SyntheticLogParameters events_parameters;
+  events_parameters.seed = seed;
+  events_parameters.duration = kEventsDuration;
+  events_parameters.event_period = kEventsPeriod;
+  events_parameters.num_cameras = 0;
+  events_parameters.autorefs.resize(2);
+  inputs.events_log = StringPrintf(
+      "%s/benchmark-events-%" PRIu64 ".log", inputs.dir.c_str(), seed);
+  uint64_t events_size = 0;
+  if (!GenerateLog(events_parameters, inputs.events_log, &events_size)) {
+    return 1;
+  }
+  LogReader reader;
+  if (!reader.Open(inputs.sample_log)) return 1;
+  while (reader.ReadRecord()) {
+    inputs.sample_records.push_back(
+        string(reader.record(), reader.record_size()));
+    EnvelopeView envelope;
+    if (DecodeEnvelope(reader.record(), reader.record_size(), &envelope) &&
+        envelope.AddressIs(kRefereeMulticast)) {
+      inputs.referee_messages.push_back(
+          string(envelope.data, envelope.data_size));
+    }
+  }
+  if (num_fuzz_inputs > 0 &&
+      !VerifyDecoders(inputs, seed, num_fuzz_inputs)) {
+    return 1;
+  }
+
+  static const int kNumBenchmarks = 13;
+  const Benchmark kBenchmarks[kNumBenchmarks] = {
+    Benchmark("log/read_record", BM_ReadRecord),
+    Benchmark("log/read_wrapper", BM_ReadWrapper),
+    Benchmark("log/parse_envelope", BM_ParseEnvelope),
+    Benchmark("log/decode_envelope", BM_DecodeEnvelope),
+    Benchmark("referee/parse", BM_ParseReferee),
+    Benchmark("referee/decode", BM_DecodeReferee),
+    Benchmark("evaluator/load_referees", BM_LoadReferees),
+    Benchmark("evaluator/load_vision", BM_LoadVision),
+    Benchmark("evaluator/extract_events", BM_ExtractEvents),
+    Benchmark("evaluator/match_events", BM_MatchEvents),
+    Benchmark("evaluator/evaluate", BM_Evaluate),
+    Benchmark("playback/publish", BM_Publish),
+    Benchmark("logger/serialize_write", BM_LoggerWrite),
+  };
+  printf("%-36s %15s %10s %22s %15s %19s\n",
+         "Benchmark", "Time", "Iterations", "Items", "Bytes", "Allocations");
+  vector<BenchmarkResult> results;
+  bool success = true;
+  for (int i = 0; i < kNumBenchmarks; ++i) {
+    if (kBenchmarks[i].name.find(filter) == string::npos) continue;
+    BenchmarkResult result;
+    if (!RunBenchmark(kBenchmarks[i], inputs, min_time, repetitions,
+                      &result)) {
+      fprintf(stderr, "Benchmark %s failed\n", kBenchmarks[i].name.c_str());
+      success = false;
+      continue;
+    }
+    PrintResult(result);
+    results.push_back(result);
+  }
+  unlink(inputs.sample_log.c_str());
+  unlink(inputs.events_log.c_str());
+
+  const double bytes_per_second =
+      static_cast<double>(sample_size) / kSampleDuration;
+  for (size_t i = 0; i < e2e_sizes.size(); ++i) {
+    vector<BenchmarkResult> e2e_results;
+    if (!RunEndToEnd(e2e_sizes[i], seed, bytes_per_second, log_dir, inputs,
+                     &e2e_results)) {
+      fprintf(stderr, "End-to-end benchmark of %g GB failed\n", e2e_sizes[i]);
+      success = false;
+    }
+    for (size_t j = 0; j < e2e_results.size(); ++j) {
+      if (e2e_results[j].name.find(filter) == string::npos) continue;
+      PrintResult(e2e_results[j]);
+      results.push_back(e2e_results[j]);
+    }
+  }
+
+  if (!json_file.empty() && !WriteJson(json_file, results, seed)) {
+    success = false;
+  }
+  if (!baseline_file.empty() &&
+      CompareToBaseline(results, baseline, threshold) > 0) {
+    success = false;
+  }
+  return success ? 0 : 1;
+}
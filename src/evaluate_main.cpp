@@ -18,522 +18,482 @@
 //
 // Evaluation of automatic referees by comparison to human referee.
 
-#include <arpa/inet.h>
 #include <inttypes.h>
-#include <netinet/in.h>
-#include <signal.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/socket.h>
-#include <time.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
 
-#include "messages_robocup_ssl_wrapper.pb.h"
+#include "autoref_eval/evaluator.h"
+#include "autoref_eval/metrics.h"
+#include "autoref_eval/results_store.h"
+#include "autoref_eval/results_writer.h"
+#include "autoref_results.pb.h"
 #include "referee.pb.h"
-#include "shared/misc_util.h"
-#include "shared/netraw.h"
-#include "shared/util.h"
-#include "udp_message_wrapper.pb.h"
+#include "shared/trace.h"
 
 using std::map;
 using std::max;
 using std::string;
 using std::vector;
 
-// Struct to keep track of a referee events. An "event" is a stop command,
-// followed by one of the following commands:
-  // DIRECT_FREE_YELLOW
-  // DIRECT_FREE_BLUE
-  // INDIRECT_FREE_YELLOW
-  // INDIRECT_FREE_BLUE
-  // GOAL_YELLOW
-  // GOAL_BLUE
-struct RefereeEvent {
-  RefereeEvent() :
-      stop_timestamp(0),
-      command_timestamp(0),
-      command_counter(0),
-      command(SSL_Referee_Command_HALT) {}
-
-  RefereeEvent(uint64_t stop_timestamp,
-               uint64_t command_timestamp,
-               uint32_t command_counter,
-               SSL_Referee_Command command) :
-      stop_timestamp(stop_timestamp),
-      command_timestamp(command_timestamp),
-      command_counter(command_counter),
-      command(command) {}
-
-  // Timestamp that the "STOP" command was sent, previous to the event command.
-  uint64_t stop_timestamp;
-
-  // Timestamp that the command was sent.
-  uint64_t command_timestamp;
-
-  // Value of the command counter when this command was received.
-  uint32_t command_counter;
-
-  // Command for the event.
-  SSL_Referee_Command command;
-};
-
-// Struct to represent the evaluation of a single referee event.
-struct EventEvaluation {
-  enum Evaluation {
-    kUnknown = 0,
-    kTruePositive = 1,
-    kFalsePositive = 2,
-    kFalseNegative = 3
-  };
-
-  EventEvaluation() : value(kUnknown), ignore(true) {}
-
-  EventEvaluation(Evaluation value,
-                  const RefereeEvent& autoref_event,
-                  const RefereeEvent& humanref_event,
-                  bool ignore) :
-      value(kUnknown),
-      autoref_event(autoref_event),
-      humanref_event(humanref_event),
-      ignore(ignore) {}
-
-  const char* ValueString() const {
-    switch (value) {
-      case kTruePositive : {
-        return "TP";
-      } break;
-
-      case kFalsePositive : {
-        return "FP";
-      } break;
-
-      case kFalseNegative : {
-        return "FN";
-      } break;
-
-      default: {
-        return "UN";
-      }
+// Evaluations of every game, indexed by autoref port number.
+map<uint16_t, vector<GameEvaluation> > game_evaluations;
+
+// Event timing over all games, indexed by autoref port number.
+map<uint16_t, EventTiming> event_timings;
+
+// Writers of the evaluations of every event, and of the summaries of every
+// autoref, if open.
+ResultsWriter events_writer;
+ResultsWriter summary_writer;
+bool write_events = false;
+bool write_summaries = false;
+
+// Parts of the logs to evaluate.
+LogFilter log_filter;
+
+// Store of the evaluations of logs, if open.
+ResultsStore results_store;
+bool use_store = false;
+
+// Write the results of an autoref to the open results files.
+bool WriteResults(const string& log_file,
+                  const AutorefEvaluation& evaluation) {
+  TRACE_SCOPE("write");
+  bool success = true;
+  if (write_events) {
+    AutorefEventResult result;
+    for (int i = 0; i < evaluation.evaluations.size(); ++i) {
+      GetEventResult(log_file, evaluation, i, &result);
+      success = events_writer.Write(result) && success;
     }
   }
-
-  // The evaluation of this event.
-  Evaluation value;
-
-  // The autoref event corresponding to this evaluation. Valid for True
-  // Positives and False Positives.
-  RefereeEvent autoref_event;
-
-  // The human referee event corresponding to this evaluation. Valid for True
-  // Positives and False Negatives.
-  RefereeEvent humanref_event;
-
-  // Human-annotated flag to indicate that the evaluator should not count
-  // this event.
-  bool ignore;
-};
-
-bool operator!=(const RefereeEvent& e1, const RefereeEvent& e2) {
-  return (e1.stop_timestamp != e2.stop_timestamp ||
-      e1.command_timestamp != e2.command_timestamp ||
-      e1.command_counter != e2.command_counter ||
-      e1.command != e2.command);
+  if (write_summaries) {
+    AutorefSummaryResult result;
+    GetSummaryResult(log_file, evaluation, &result);
+    success = summary_writer.Write(result) && success;
+  }
+  return success;
 }
 
-bool operator!=(const EventEvaluation& e1, const EventEvaluation& e2) {
-  return (e1.value != e2.value ||
-      e1.autoref_event != e2.autoref_event ||
-      e1.humanref_event != e2.humanref_event);
+void PrintRefereeCommands(const RefereeLog& referee) {
+  for (int i = 0; i < referee.commands.size(); ++i) {
+    const RefereeView& message = referee.commands[i];
+    printf("Referee %d: %4d %s\n",
+           referee.port,
+           message.command_counter,
+           SSL_Referee_Command_Name(message.command).c_str());
+  }
 }
 
-// UDP Multicast address for referees.
-static const char* kRefereeMulticast = "224.5.23.1";
-
-// UDP Multicast address for SSL Vision.
-static const char* kVisionMulticast = "224.5.23.2";
-
-// Port number for SSL Vision.
-static const int kVisionPort = 10006;
-
-// Port number for main refbox.
-static const int kRefboxPort = 10003;
-
-// Referee commands. The first index is for the human refbox, the rest
-// are automatic referees.
-vector<vector<SSL_Referee> > referee_commands;
-
-// Referee events. The first index is for the human refbox, the rest
-// are automatic referees.
-vector<vector<RefereeEvent> > referee_events;
-
-// Port numbers of referees.
-vector<uint16_t> referee_ports;
-
-// Map from referee port number, to index in referee_commands, referee_events,
-// and referee_ports.
-map<uint16_t, int> referee_map;
-
-bool ReadUDPMessageWrapper(FILE* fid, UDPMessageWrapper* message) {
-  uint32_t packet_size = 0;
-  if (fread(&packet_size, sizeof(packet_size), 1, fid) != 1) {
+// Load a log file, and print the commands and events of its referees.
+bool LoadLog(const string& log_file, bool verbose, Evaluator* evaluator) {
+  if (!evaluator->Load(log_file)) {
+    fprintf(stderr, "Error loading log file %s\n", log_file.c_str());
     return false;
   }
-  char* read_buffer = new char[packet_size];
-  const bool success = (fread(read_buffer, 1, packet_size, fid) == packet_size);
-  if (success) {
-    message->ParseFromArray(read_buffer, packet_size);
-  } else {
-    fprintf(stderr, "Error reading packet data of size %d", packet_size);
-    perror("");
+  const vector<RefereeLog>& referees = evaluator->referees();
+  for (int i = 0; i < referees.size(); ++i) {
+    if (verbose) PrintRefereeCommands(referees[i]);
+    printf("Referee %d: %d commands, %d events\n",
+           referees[i].port,
+           static_cast<int>(referees[i].commands.size()),
+           static_cast<int>(referees[i].events.size()));
   }
-  delete[] read_buffer;
-  return success;
-}
-
-void PrintRefereeCommand(const int port_number,
-                         const SSL_Referee& message) {
-  printf("Referee %d: %4d %s\n",
-         port_number,
-         message.command_counter(),
-         SSL_Referee_Command_Name(message.command()).c_str());
-}
-
-void LoadRefereeCommands(const string& log_file) {
-  static const bool kDebug = true;
-  ScopedFile fid(log_file.c_str(), "r");
-  if (fid() == NULL) {
-    perror("Error opening file");
-    exit(1);
+  const VisionStore& vision = evaluator->vision();
+  if (vision.NumFrames() > 0) {
+    printf("Vision: %" PRIu64 " frames, %.1f MB\n",
+           vision.NumFrames(),
+           static_cast<double>(vision.MemoryUsage()) / (1024.0 * 1024.0));
   }
-  // Initialize map, and commands to only track human refbox first, to ensure
-  // that it will correspond to the first entry in referee_commands and
-  // referee_events.
-  referee_map.clear();
-  referee_commands.resize(1);
-  referee_events.resize(1);
-  referee_ports.push_back(kRefboxPort);
-  referee_map[kRefboxPort] = 0;
-  UDPMessageWrapper message;
-  while (ReadUDPMessageWrapper(fid(), &message)) {
-    if (message.address() == kVisionMulticast &&
-        message.port() == kVisionPort) {
-      // Parse vision message.
-      SSL_DetectionFrame vision_message;
-      vision_message.ParseFromString(message.data());
-    } else if (message.address() == kRefereeMulticast) {
-      // Referee message.
-      SSL_Referee referee_message;
-      referee_message.ParseFromString(message.data());
-
-      map<uint16_t, int>::iterator it = referee_map.find(message.port());
-      if (it == referee_map.end()) {
-        // This referee has not bee seen before, allocate space for it.
-        referee_map[message.port()] = referee_commands.size();
-        referee_commands.push_back(vector<SSL_Referee>());
-        referee_events.push_back(vector<RefereeEvent>());
-        referee_ports.push_back(message.port());
-        it = referee_map.find(message.port());
-      }
-      vector<SSL_Referee>& referee = referee_commands[it->second];
-      if (referee.size() == 0 ||
-          referee.back().command_counter() <
-              referee_message.command_counter()) {
-        if (kDebug) {
-          PrintRefereeCommand(message.port(), referee_message);
-        }
-        referee.push_back(referee_message);
-      }
+  const vector<TimeWindow>& windows = evaluator->windows();
+  if (evaluator->filter().IsSet()) {
+    uint64_t duration = 0;
+    for (int i = 0; i < windows.size(); ++i) {
+      duration += windows[i].end - windows[i].begin;
     }
+    printf("Filter: %d windows, %.1f s\n",
+           static_cast<int>(windows.size()),
+           1e-6 * static_cast<double>(duration));
   }
-  for (int i = 0; i < referee_commands.size(); ++i) {
-    printf("Referee %d: %d commands\n",
-            referee_ports[i],
-            static_cast<int>(referee_commands[i].size()));
+  const SSL_GeometryData* geometry = evaluator->geometry();
+  if (geometry != NULL) {
+    printf("Field: %d x %d mm\n",
+           geometry->field().field_length(),
+           geometry->field().field_width());
   }
+  return true;
 }
 
-void IndexRefereeEvents() {
-  for (int i = 0; i < referee_commands.size(); ++i) {
-    const vector<SSL_Referee>& referee = referee_commands[i];
-    uint64_t t_last_stop = 0;
-    for (int j = 0; j < referee.size(); ++j) {
-      const SSL_Referee& command = referee[j];
-      switch (command.command()) {
-        case SSL_Referee_Command_STOP: {
-          t_last_stop = command.command_timestamp();
-        } break;
-
-        case SSL_Referee_Command_DIRECT_FREE_YELLOW:
-        case SSL_Referee_Command_DIRECT_FREE_BLUE:
-        case SSL_Referee_Command_INDIRECT_FREE_YELLOW:
-        case SSL_Referee_Command_INDIRECT_FREE_BLUE:
-        case SSL_Referee_Command_GOAL_YELLOW:
-        case SSL_Referee_Command_GOAL_BLUE: {
-          referee_events[i].push_back(
-              RefereeEvent(t_last_stop,
-                           command.command_timestamp(),
-                           command.command_counter(),
-                           command.command()));
-          t_last_stop = 0;
-        } break;
-
-        default: {
-          // Ignore this command.
-        }
-      }
+// Print the evaluations of an autoref with their vision context: the ball,
+// and the robots nearest to it, at the time of every event.
+void PrintEventContexts(const AutorefEvaluation& evaluation) {
+  printf("Events of autoref %d:\n", evaluation.port);
+  for (int i = 0; i < evaluation.contexts.size(); ++i) {
+    const EventEvaluation& event = evaluation.evaluations[i];
+    const EventContext& context = evaluation.contexts[i];
+    const SSL_Referee_Command command =
+        (event.value == EventEvaluation::kFalsePositive) ?
+        event.autoref_event.command : event.humanref_event.command;
+    printf("%s%s %-20s %.3f",
+           event.ValueString(),
+           event.ignore ? "*" : " ",
+           SSL_Referee_Command_Name(command).c_str(),
+           1e-6 * static_cast<double>(context.t));
+    if (context.has_ball) {
+      printf(" ball (%.0f, %.0f)", context.ball.x, context.ball.y);
+    } else {
+      printf(" no ball");
+    }
+    for (int j = 0; j < context.robots.size(); ++j) {
+      const RobotSample& robot = context.robots[j];
+      printf(" %c%d (%.0f, %.0f)",
+             (robot.team == RobotSample::kYellow) ? 'Y' : 'B',
+             robot.robot_id,
+             robot.x,
+             robot.y);
     }
-    printf("Referee %d: %d events\n",
-           referee_ports[i],
-          static_cast<int>(referee_events[i].size()));
+    printf("\n");
   }
 }
 
-// Returns true iff event e1 does not overlap with event e2, and the events do
-// not overlap, allowing for time delay "td" before event e2.
-bool Before(const RefereeEvent& e1, const RefereeEvent& e2, uint64_t td) {
-  return (e1.command_timestamp < (e2.stop_timestamp -td));
-}
-
-// Returns true iff the events e1 and e2 overlap in time, allowing for time
-// delay "td" before event e1.
-bool Overlaps(const RefereeEvent& e1, const RefereeEvent& e2, uint64_t td) {
-  return (!Before(e1, e2, 0) && !Before(e2, e1, td));
-}
-
-bool LoadEvaluations(const string& evaluations_file,
-                     vector<EventEvaluation>* evaluations_ptr) {
-  vector<EventEvaluation>& evaluations = *evaluations_ptr;
-  ScopedFile fid(evaluations_file, "r");
-  for (int i = 0; i < evaluations.size(); ++i) {
-    EventEvaluation eval;
-    int j = 0;
-    char value_string[32];
-    int ignore_int = 0;
-    int autoref_command_int = 0;
-    int humanref_command_int = 0;
-    const int num_read = 
-        fscanf(fid,
-               "%3d %2s %d "
-               "%"PRIu64" %"PRIu64" %"PRIu32" %d "
-               "%"PRIu64" %"PRIu64" %"PRIu32" %d\n",
-               &i,
-               value_string,
-               &ignore_int,
-               &(eval.autoref_event.stop_timestamp),
-               &(eval.autoref_event.command_timestamp),
-               &(eval.autoref_event.command_counter),
-               &(autoref_command_int),
-               &(eval.humanref_event.stop_timestamp),
-               &(eval.humanref_event.command_timestamp),
-               &(eval.humanref_event.command_counter),
-               &(humanref_command_int));
-    if (num_read != 11) return false;
-    if (strcmp(value_string, "TP") == 0) {
-      eval.value = EventEvaluation::kTruePositive;
-    } else if (strcmp(value_string, "FP") == 0) {
-      eval.value = EventEvaluation::kFalsePositive;
-    } else if (strcmp(value_string, "FN") == 0) {
-      eval.value = EventEvaluation::kFalseNegative;
-    }
-    if (ignore_int == 0) {
-      eval.ignore = false;
-    } else {
-      eval.ignore = true;
+bool EvaluateAutorefs(const string& log_file, bool verbose, bool context) {
+  printf("Evaluating log file %s\n", log_file.c_str());
+  Evaluator evaluator;
+  evaluator.set_load_vision(context);
+  evaluator.set_filter(log_filter);
+  vector<AutorefEvaluation> evaluations;
+  // The store does not keep vision contexts.
+  const StoredLogResult* stored = (use_store && !context) ?
+      results_store.Find(log_file, evaluator.ParametersHash()) : NULL;
+  if (stored != NULL) {
+    printf("Using stored evaluation\n");
+    if (!RestoreEvaluations(evaluator, *stored, &evaluations)) return false;
+  } else {
+    if (!LoadLog(log_file, verbose, &evaluator) ||
+        !evaluator.Evaluate(&evaluations)) {
+      return false;
     }
-    eval.autoref_event.command =
-        static_cast<SSL_Referee_Command>(autoref_command_int);
-    eval.humanref_event.command =
-        static_cast<SSL_Referee_Command>(humanref_command_int);
-    if (eval != evaluations[i]) {
+    StoredLogResult result;
+    if (use_store &&
+        (!MakeStoredResult(evaluator, log_file, evaluations, &result) ||
+         !results_store.Append(result))) {
       return false;
     }
   }
+  for (int i = 0; i < evaluations.size(); ++i) {
+    const AutorefEvaluation& evaluation = evaluations[i];
+    const GameEvaluation& game = evaluation.game;
+    const Metrics metrics = game.GetMetrics();
+    if (evaluation.annotated) {
+      printf("Succesfully loaded previous annotated evaluation of autoref "
+             "%d\n",
+             evaluation.port);
+    }
+    printf("Autoref %d:\n"
+           "True Positives: %d\n"
+           "False Positives: %d\n"
+           "False Negatives: %d\n"
+           "Precision: %.3f\n"
+           "Recall: %.3f\n"
+           "F1 Score: %.3f\n",
+           evaluation.port,
+           game.true_positives,
+           game.false_positives,
+           game.false_negatives,
+           metrics.precision,
+           metrics.recall,
+           metrics.f1_score);
+    evaluation.timing.Print(stdout);
+    if (context) PrintEventContexts(evaluation);
+    if (!WriteResults(log_file, evaluation)) return false;
+    game_evaluations[evaluation.port].push_back(game);
+    event_timings[evaluation.port].Merge(evaluation.timing);
+  }
   return true;
 }
 
-void SaveEvaluations(const string& evaluations_file,
-                     const vector<EventEvaluation>& evaluations) {
-  ScopedFile fid(evaluations_file, "w");
-  for (int i = 0; i < evaluations.size(); ++i) {
-    const EventEvaluation& eval = evaluations[i];
-    fprintf(fid,
-            "%3d %2s %d "
-            "%"PRIu64" %"PRIu64" %"PRIu32" %d "
-            "%"PRIu64" %"PRIu64" %"PRIu32" %d\n",
-            i,
-            eval.ValueString(),
-            (eval.ignore ? 1 : 0),
-            eval.autoref_event.stop_timestamp,
-            eval.autoref_event.command_timestamp,
-            eval.autoref_event.command_counter,
-            eval.autoref_event.command,
-            eval.humanref_event.stop_timestamp,
-            eval.humanref_event.command_timestamp,
-            eval.humanref_event.command_counter,
-            eval.humanref_event.command);
+// Print the point estimates and bootstrap confidence intervals of the
+// metrics of every autoref, over all the games evaluated.
+void PrintBootstrapIntervals(int num_resamples,
+                             int num_threads,
+                             uint64_t seed,
+                             double confidence) {
+  for (map<uint16_t, vector<GameEvaluation> >::const_iterator it =
+           game_evaluations.begin();
+       it != game_evaluations.end(); ++it) {
+    BootstrapIntervals intervals;
+    ComputeBootstrapIntervals(
+        it->second, num_resamples, num_threads, seed, confidence, &intervals);
+    printf("Autoref %d: %d games, %d events, %d resamples, %.0f%% CI\n"
+           "%-9s %8s %17s %17s\n",
+           it->first,
+           intervals.num_games,
+           intervals.num_events,
+           num_resamples,
+           100.0 * confidence,
+           "", "Estimate", "By event", "By game");
+    static const char* kMetricNames[3] = {"Precision", "Recall", "F1 Score"};
+    float Metrics::* const kMetrics[3] =
+        {&Metrics::precision, &Metrics::recall, &Metrics::f1_score};
+    for (int j = 0; j < 3; ++j) {
+      printf("%-9s %8.3f    [%5.3f, %5.3f]    [%5.3f, %5.3f]\n",
+             kMetricNames[j],
+             intervals.estimate.*kMetrics[j],
+             intervals.event_low.*kMetrics[j],
+             intervals.event_high.*kMetrics[j],
+             intervals.game_low.*kMetrics[j],
+             intervals.game_high.*kMetrics[j]);
+    }
   }
 }
 
-void MergeEvaluations(const string& log_file,
-                      int ref_id,
-                      vector<EventEvaluation>* evaluations_ptr) {
-  vector<EventEvaluation>& evaluations = *evaluations_ptr;
-  int true_positives = 0;
-  int false_positives = 0;
-  int false_negatives = 0;
-
-  // TODO: Try and load the results from possible human corrections.
-  const string evaluations_file_name =
-      StringPrintf("%s.%d.eval", log_file.c_str(), ref_id);
-  if (FileExists(evaluations_file_name) &&
-      LoadEvaluations(evaluations_file_name, evaluations_ptr)) {
-    // Human-annotated evaluations exist, and are consistent. Use them instead.
-    printf("Succesfully loaded previous annotated evaluation %s\n",
-           evaluations_file_name.c_str());
-  } else {
-    // Save the evaluations.
-    SaveEvaluations(evaluations_file_name, evaluations);
+// Evaluate the autorefs for every combination of auto-to-human and
+// human-to-auto delays in the given ranges, and print the precision, recall
+// and F1 score surfaces. The log is read and the events are sorted only once.
+// Human annotations of the evaluations are not used.
+bool SweepTolerances(const string& log_file,
+                     const SweepRange& auto_to_human,
+                     const SweepRange& human_to_auto,
+                     bool verbose) {
+  printf("Sweeping tolerances for log file %s\n", log_file.c_str());
+  Evaluator evaluator;
+  evaluator.set_filter(log_filter);
+  if (!LoadLog(log_file, verbose, &evaluator)) return false;
+  const vector<RefereeLog>& referees = evaluator.referees();
+  if (referees[0].events.empty()) {
+    fprintf(stderr, "ERROR: No human referee events found!\n");
+    return false;
   }
-  for (int i = 0; i < evaluations.size(); ++i) {
-    if (evaluations[i].ignore) continue;
-    switch (evaluations[i].value) {
-      case EventEvaluation::kTruePositive: {
-        ++true_positives;
-      } break;
-      case EventEvaluation::kFalsePositive: {
-        ++false_positives;
-      } break;
-      case EventEvaluation::kFalseNegative: {
-        ++false_negatives;
-      } break;
-      default: {
-        // Should never happen.
-        fprintf(stderr,
-                "ERROR: Unknown evaluation %d for referee %d, command %d\n",
-                evaluations[i].value,
-                ref_id,
-                i);
-        exit(1);
+  for (int i = 1; i < referees.size(); ++i) {
+    vector<SweepPoint> points;
+    evaluator.Sweep(i, auto_to_human, human_to_auto, &points);
+    printf("Autoref %d:\n", referees[i].port);
+    printf("%9s %9s %5s %5s %5s %9s %9s %9s\n",
+           "A2H(s)", "H2A(s)", "TP", "FP", "FN",
+           "Precision", "Recall", "F1");
+    const SweepPoint* best = NULL;
+    for (int j = 0; j < points.size(); ++j) {
+      const SweepPoint& point = points[j];
+      printf("%9.3f %9.3f %5d %5d %5d %9.3f %9.3f %9.3f\n",
+             1e-6 * static_cast<double>(point.auto_to_human_delay),
+             1e-6 * static_cast<double>(point.human_to_auto_delay),
+             point.true_positives,
+             point.false_positives,
+             point.false_negatives,
+             point.metrics.precision,
+             point.metrics.recall,
+             point.metrics.f1_score);
+      if (best == NULL || point.metrics.f1_score > best->metrics.f1_score) {
+        best = &point;
       }
     }
+    if (best != NULL) {
+      printf("Best F1 Score: %.3f at A2H %.3fs, H2A %.3fs\n",
+             best->metrics.f1_score,
+             1e-6 * static_cast<double>(best->auto_to_human_delay),
+             1e-6 * static_cast<double>(best->human_to_auto_delay));
+    }
   }
-  const float precision =
-      static_cast<float>(true_positives) /
-      (static_cast<float>(true_positives) +
-      static_cast<float>(false_positives));
-  const float recall =
-      static_cast<float>(true_positives) /
-      (static_cast<float>(true_positives) +
-      static_cast<float>(false_negatives));
-  const float f1_score = 2.0 * precision * recall / (precision + recall);
-
-  printf("Autoref %d:\n"
-          "True Positives: %d\n"
-          "False Positives: %d\n"
-          "False Negatives: %d\n"
-          "Precision: %.3f\n"
-          "Recall: %.3f\n"
-          "F1 Score: %.3f\n",
-          referee_ports[ref_id],
-          true_positives,
-          false_positives,
-          false_negatives,
-          precision,
-          recall,
-          f1_score);
+  return true;
 }
 
-void EvaluateAutorefs(const string& log_file) {
-  printf("Evaluating log file %s\n", log_file.c_str());
-  LoadRefereeCommands(log_file);
-  IndexRefereeEvents();
-
-
-  // Evaluate the autoref events.
-  const vector<RefereeEvent>& human_referee = referee_events[0];
-  if (human_referee.size() == 0) {
-    fprintf(stderr, "ERROR: No human referee events found!\n");
-    exit(1);
+// Parse a range of the form "min:max:step", in seconds.
+bool ParseSweepRange(const char* arg, SweepRange* range) {
+  double min = 0.0;
+  double max = 0.0;
+  double step = 0.0;
+  if (sscanf(arg, "%lf:%lf:%lf", &min, &max, &step) != 3 ||
+      min < 0.0 || max < min || step < 0.0) {
+    return false;
   }
+  range->min = llround(1e6 * min);
+  range->max = llround(1e6 * max);
+  range->step = llround(1e6 * step);
+  return true;
+}
 
-  // The maximum time delay between an autoref event, and a human referee event
-  // after the autoref event.
-  static const uint64_t kAutoToHumanDelay = 2000000;
-  // The maximum time delay between a human referee event, and an autoref event
-  // after the human referee event.
-  static const uint64_t kHumanToAutoDelay = 0;
-
-  for (int i = 1; i < referee_events.size(); ++i) {
-    const vector<RefereeEvent>& autoref = referee_events[i];
-    int k = 0;
-    vector <EventEvaluation> evaluations;
-    for (int j = 0; j < autoref.size(); ++j) {
-      // Indicates if a matching human referee command has been found.
-      bool match_found = false;
-      // Indicates if the autoref event has been evaluated.
-      bool evaluated = false;
-      do {
-        if (Before(human_referee[k], autoref[j], kHumanToAutoDelay)) {
-          // False negative: The autoref missed a human referee event
-          evaluations.push_back(EventEvaluation(
-              EventEvaluation::kFalseNegative,
-              RefereeEvent(),
-              human_referee[k],
-              false));
-        } else if (Before(autoref[j], human_referee[k], kAutoToHumanDelay)) {
-          // False Positive: No human event overlapped in time with the autoref.
-          evaluations.push_back(EventEvaluation(
-              EventEvaluation::kFalsePositive,
-              autoref[j],
-              RefereeEvent(),
-              false));
-          evaluated = true;
-        } else {
-          // Overlapping in time.
-          match_found = (human_referee[k].command == autoref[j].command);
-        }
-        // If no match found, check the next human referee event.
-        if (!match_found) ++k;
-      } while (!match_found && !evaluated && k < human_referee.size());
-      if (match_found) {
-        // True positive
-        evaluations.push_back(EventEvaluation(
-              EventEvaluation::kTruePositive,
-              autoref[j],
-              human_referee[k],
-              false));
-        // Advance to the next human referee event, since one human referee
-        // event may only match one automatic referee event.
-        ++k;
-      } else if (!evaluated) {
-        // False positive. There are no more human referee events left.
-        evaluations.push_back(EventEvaluation(
-              EventEvaluation::kFalsePositive,
-              autoref[j],
-              RefereeEvent(),
-              false));
-      }
+// Parse a comma-separated list of stage names, e.g.
+// "NORMAL_FIRST_HALF,NORMAL_SECOND_HALF".
+bool ParseStages(const char* arg, vector<SSL_Referee_Stage>* stages) {
+  stages->clear();
+  const string list(arg);
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == string::npos) end = list.size();
+    SSL_Referee_Stage stage;
+    if (!SSL_Referee_Stage_Parse(list.substr(begin, end - begin), &stage)) {
+      return false;
     }
-    // Merge evaluations with possible human correction.
-    MergeEvaluations(log_file, i, &evaluations);
+    stages->push_back(stage);
+    begin = end + 1;
+  }
+  return true;
+}
+
+// Parse a time window of the form "begin:end" in seconds, where either of
+// them may be omitted to select the start or the end of the log.
+bool ParseTimeWindow(const char* arg, bool relative_time, LogFilter* filter) {
+  const char* separator = strchr(arg, ':');
+  if (separator == NULL) return false;
+  double begin = 0.0;
+  double end = 0.0;
+  filter->begin = 0;
+  filter->end = std::numeric_limits<uint64_t>::max();
+  if (separator > arg) {
+    if (sscanf(arg, "%lf", &begin) != 1 || begin < 0.0) return false;
+    filter->begin = llround(1e6 * begin);
   }
+  if (separator[1] != '\0') {
+    if (sscanf(separator + 1, "%lf", &end) != 1 || end < begin) return false;
+    filter->end = llround(1e6 * end);
+  }
+  filter->has_time_window = true;
+  filter->relative_time = relative_time;
+  return true;
 }
 
 void PrintUsage() {
-  printf("Usage: evaluate log_file.log\n");
+  printf("Usage: evaluate [options] log_file1.log [log_file2.log ...]\n"
+         "Options:\n"
+         "  -sweep         Print precision, recall and F1 score for a grid\n"
+         "                 of auto-to-human (-a2h) and human-to-auto (-h2a)\n"
+         "                 delays, in seconds.\n"
+         "                 Defaults: -a2h 0:5:0.25 -h2a 0:2:0.25\n"
+         "  -bootstrap N   Print bootstrap confidence intervals of the\n"
+         "                 metrics over all logs, from N resamples by event\n"
+         "                 and by game (log).\n"
+         "  -confidence C  Confidence level of the intervals. Default: 0.95\n"
+         "  -threads T     Number of bootstrap threads. Default: all CPUs\n"
+         "  -seed S        Seed of the bootstrap resampling.\n"
+         "  -context       Print every event with the positions of the ball\n"
+         "                 and the nearest robots at the time of the event.\n"
+         "  -events FILE   Write the evaluation of every event to FILE.\n"
+         "  -summary FILE  Write the summary of every autoref to FILE.\n"
+         "                 The format is JSON lines for .jsonl files, CSV\n"
+         "                 for .csv files, and size-prefixed\n"
+         "                 AutorefEventResult / AutorefSummaryResult\n"
+         "                 protobufs otherwise.\n"
+         "  -store FILE    Keep the evaluations of the logs in FILE, and\n"
+         "                 only evaluate logs whose contents, annotations\n"
+         "                 or evaluation parameters changed since.\n"
+         "  -stage LIST    Only evaluate the events during the given stages\n"
+         "                 of the game, a comma-separated list of\n"
+         "                 SSL_Referee.Stage names.\n"
+         "  -time B:E      Only evaluate the events from B to E seconds\n"
+         "                 after the start of the log.\n"
+         "  -abstime B:E   Only evaluate the events from UNIX time B to E\n"
+         "                 seconds. B or E may be omitted for the start or\n"
+         "                 end of the log.\n"
+         "  -trace FILE    Write a Chrome trace of the stages of the\n"
+         "                 evaluation to FILE, and print the time spent in\n"
+         "                 every stage. Requires a build with\n"
+         "                 -DENABLE_TRACING=ON.\n"
+         "  -v             Print all referee commands.\n");
 }
 
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
+  vector<string> log_files;
+  bool sweep = false;
+  bool verbose = false;
+  bool context = false;
+  int num_resamples = 0;
+  double confidence = 0.95;
+  int num_threads = max<long>(1, sysconf(_SC_NPROCESSORS_ONLN));
+  uint64_t seed = 1;
+  SweepRange auto_to_human(0, 5000000, 250000);
+  SweepRange human_to_auto(0, 2000000, 250000);
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-sweep") == 0) {
+      sweep = true;
+    } else if (strcmp(argv[i], "-events") == 0 && has_value) {
+      if (!events_writer.Open(argv[++i])) return 1;
+      write_events = true;
+    } else if (strcmp(argv[i], "-summary") == 0 && has_value) {
+      if (!summary_writer.Open(argv[++i])) return 1;
+      write_summaries = true;
+    } else if (strcmp(argv[i], "-store") == 0 && has_value) {
+      if (!results_store.Open(argv[++i])) return 1;
+      use_store = true;
+    } else if (strcmp(argv[i], "-stage") == 0 && has_value) {
+      if (!ParseStages(argv[++i], &log_filter.stages)) {
+        fprintf(stderr, "Invalid stages \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if ((strcmp(argv[i], "-time") == 0 ||
+                strcmp(argv[i], "-abstime") == 0) && has_value) {
+      const bool relative_time = (strcmp(argv[i], "-time") == 0);
+      if (!ParseTimeWindow(argv[++i], relative_time, &log_filter)) {
+        fprintf(stderr, "Invalid time window \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-context") == 0) {
+      context = true;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-a2h") == 0 && has_value) {
+      if (!ParseSweepRange(argv[++i], &auto_to_human)) {
+        fprintf(stderr, "Invalid range \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-h2a") == 0 && has_value) {
+      if (!ParseSweepRange(argv[++i], &human_to_auto)) {
+        fprintf(stderr, "Invalid range \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-bootstrap") == 0 && has_value) {
+      num_resamples = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-confidence") == 0 && has_value) {
+      confidence = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-threads") == 0 && has_value) {
+      num_threads = max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "-seed") == 0 && has_value) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-trace") == 0 && has_value) {
+      if (!StartTracing(argv[++i])) return 1;
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      log_files.push_back(argv[i]);
+    }
+  }
+  if (log_files.empty() || confidence <= 0.0 || confidence >= 1.0) {
     PrintUsage();
     return 1;
   }
-  EvaluateAutorefs(argv[1]);
+  for (size_t i = 0; i < log_files.size(); ++i) {
+    const bool success = sweep ?
+        SweepTolerances(log_files[i], auto_to_human, human_to_auto, verbose) :
+        EvaluateAutorefs(log_files[i], verbose, context);
+    if (!success) return 1;
+  }
+  if (!sweep && log_files.size() > 1) {
+    for (map<uint16_t, EventTiming>::const_iterator it =
+             event_timings.begin();
+         it != event_timings.end(); ++it) {
+      printf("Autoref %d, all %d logs:\n",
+             it->first,
+             static_cast<int>(log_files.size()));
+      it->second.Print(stdout);
+    }
+  }
+  if (!sweep && num_resamples > 0) {
+    PrintBootstrapIntervals(num_resamples, num_threads, seed, confidence);
+  }
+  if (!events_writer.Close() || !summary_writer.Close() || !StopTracing()) {
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,292 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Checks logs written by the logger for damaged records, e.g. a record
+// truncated when the logger was killed, and truncates or repairs them.
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "shared/log_reader.h"
+#include "shared/log_writer.h"
+#include "shared/misc_util.h"
+#include "shared/vision_decoder.h"
+#include "shared/wire_decoder.h"
+
+using std::max;
+using std::string;
+using std::vector;
+
+// UDP Multicast addresses for referees and vision.
+static const char* kRefereeMulticast = "224.5.23.1";
+static const char* kVisionMulticast = "224.5.23.2";
+
+// Options of the checks.
+struct CheckOptions {
+  CheckOptions() :
+      max_record_size(LogReader::kDefaultMaxRecordSize),
+      check_vision(false) {}
+
+  uint32_t max_record_size;
+
+  // Also check that the vision payloads parse, which is slower than reading
+  // the log.
+  bool check_vision;
+};
+
+// Outcome of the check of a log.
+struct CheckResult {
+  CheckResult() :
+      log_size(0), num_records(0), first_timestamp(0), last_timestamp(0),
+      num_damaged_ranges(0), damaged_bytes(0), tail_bytes(0),
+      num_bad_payloads(0) {}
+
+  uint64_t log_size;
+
+  // Valid records, and the receive timestamps of the first and last of them.
+  uint64_t num_records;
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+
+  // Ranges of bytes skipped, in total and at the end of the log.
+  int num_damaged_ranges;
+  uint64_t damaged_bytes;
+  uint64_t tail_bytes;
+
+  // Valid records with a payload that does not parse.
+  uint64_t num_bad_payloads;
+
+  bool damaged() const {
+    return (num_damaged_ranges > 0 || num_bad_payloads > 0);
+  }
+};
+
+// Returns a receive timestamp as seconds since the start of the log.
+double LogTime(uint64_t t, const CheckResult& result) {
+  return 1e-6 * static_cast<double>(t - result.first_timestamp);
+}
+
+// Print a range of bytes skipped, between the records received at
+// t_before, and at t_after (if has_after). The range is [offset - size,
+// offset).
+void PrintDamagedRange(uint64_t offset,
+                       uint64_t size,
+                       LogReader::Status status,
+                       bool has_after,
+                       uint64_t t_after,
+                       const CheckResult& result) {
+  const char* cause =
+      (status == LogReader::kTruncated) ? "truncated record" : "corrupt data";
+  printf("  Bytes %" PRIu64 "-%" PRIu64 " (%" PRIu64 " bytes): %s",
+         offset - size, offset, size, cause);
+  if (result.num_records == 0 && !has_after) {
+    printf(", no valid records\n");
+  } else if (result.num_records == 0) {
+    printf(", before the first record\n");
+  } else if (!has_after) {
+    printf(", after the record received at %.3f s\n",
+           LogTime(result.last_timestamp, result));
+  } else {
+    printf(", between the records received at %.3f s and %.3f s\n",
+           LogTime(result.last_timestamp, result),
+           LogTime(t_after, result));
+  }
+}
+
+// Check all the records of a log, and print every damaged range of bytes and
+// every record with a malformed payload. If repair is not NULL, the valid
+// records with valid payloads are written to it. Returns false if the log
+// could not be read or the repaired log could not be written.
+bool CheckLog(const string& file_name,
+              const CheckOptions& options,
+              LogWriter* repair,
+              CheckResult* result) {
+  *result = CheckResult();
+  LogReader reader;
+  int64_t mtime = 0;
+  if (!GetFileStatus(file_name, &result->log_size, &mtime) ||
+      !reader.Open(file_name)) {
+    perror(("Error reading \"" + file_name + "\"").c_str());
+    return false;
+  }
+  reader.set_max_record_size(options.max_record_size);
+  reader.set_recover(true);
+  VisionDecoder vision;
+  RefereeView referee;
+  while (true) {
+    const bool has_record = reader.ReadRecord();
+    if (reader.status() == LogReader::kReadError) return false;
+    EnvelopeView envelope;
+    if (has_record) {
+      DecodeEnvelope(reader.record(), reader.record_size(), &envelope);
+      if (result->num_records == 0) {
+        result->first_timestamp = envelope.timestamp;
+      }
+    }
+    if (reader.skipped_bytes() > 0) {
+      PrintDamagedRange(reader.record_offset(),
+                        reader.skipped_bytes(),
+                        reader.skip_status(),
+                        has_record,
+                        envelope.timestamp,
+                        *result);
+      ++result->num_damaged_ranges;
+      result->damaged_bytes += reader.skipped_bytes();
+      if (!has_record) result->tail_bytes = reader.skipped_bytes();
+    }
+    if (!has_record) break;
+    ++result->num_records;
+    result->last_timestamp = envelope.timestamp;
+    bool valid_payload = true;
+    if (envelope.AddressIs(kRefereeMulticast)) {
+      valid_payload =
+          DecodeReferee(envelope.data, envelope.data_size, &referee);
+    } else if (options.check_vision && envelope.AddressIs(kVisionMulticast)) {
+      valid_payload = vision.Decode(envelope.data, envelope.data_size);
+    }
+    if (!valid_payload) {
+      printf("  Record at offset %" PRIu64 " received at %.3f s: malformed "
+             "payload from %s:%d\n",
+             reader.record_offset(),
+             LogTime(envelope.timestamp, *result),
+             envelope.Address().c_str(),
+             envelope.port);
+      ++result->num_bad_payloads;
+    } else if (repair != NULL &&
+               !repair->WriteRecord(reader.record(), reader.record_size())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrintUsage() {
+  printf("Usage: logcheck [options] log1 [log2 ...]\n"
+         "Checks logs written by the logger for truncated and corrupt\n"
+         "records, and reports the ranges of bytes lost. Exits with 2 if any\n"
+         "log is damaged, even if it was truncated or repaired.\n"
+         "Options:\n"
+         "  -max-size N      Maximum size of a valid record, in bytes.\n"
+         "                   Default: %u\n"
+         "  -vision          Also check that every vision packet parses.\n"
+         "  -truncate        Truncate logs that are only damaged at their\n"
+         "                   end, e.g. by a killed logger, after their last\n"
+         "                   valid record.\n"
+         "  -repair FILE     Write the valid records of the log, skipping\n"
+         "                   damaged data and malformed payloads, to FILE.\n"
+         "                   Only with a single log.\n",
+         LogReader::kDefaultMaxRecordSize);
+}
+
+int main(int argc, char* argv[]) {
+  CheckOptions options;
+  bool truncate_logs = false;
+  string repair_file;
+  vector<string> log_files;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-max-size") == 0 && has_value) {
+      options.max_record_size = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-vision") == 0) {
+      options.check_vision = true;
+    } else if (strcmp(argv[i], "-truncate") == 0) {
+      truncate_logs = true;
+    } else if (strcmp(argv[i], "-repair") == 0 && has_value) {
+      repair_file = argv[++i];
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      log_files.push_back(argv[i]);
+    }
+  }
+  if (log_files.empty() || options.max_record_size == 0 ||
+      (!repair_file.empty() && (log_files.size() > 1 || truncate_logs))) {
+    PrintUsage();
+    return 1;
+  }
+
+  bool error = false;
+  bool damaged = false;
+  for (size_t i = 0; i < log_files.size(); ++i) {
+    const string& log_file = log_files[i];
+    LogWriter repair;
+    if (!repair_file.empty() && !repair.Open(repair_file)) {
+      perror(("Error opening \"" + repair_file + "\"").c_str());
+      return 1;
+    }
+    printf("%s:\n", log_file.c_str());
+    const uint64_t t_start = GetMonotonicTimeNSec();
+    CheckResult result;
+    const bool repairing = repair.IsOpen();
+    if (!CheckLog(log_file, options, repairing ? &repair : NULL, &result) ||
+        (repairing && !repair.Close())) {
+      fprintf(stderr, "Error checking \"%s\"\n", log_file.c_str());
+      error = true;
+      continue;
+    }
+    const double elapsed =
+        1e-9 * static_cast<double>(GetMonotonicTimeNSec() - t_start);
+    const double megabytes =
+        static_cast<double>(result.log_size) / (1024.0 * 1024.0);
+    printf("  %" PRIu64 " valid records received over %.3f s, %.1f MB "
+           "checked in %.2f s (%.0f MB/s)\n",
+           result.num_records,
+           (result.num_records > 0) ? LogTime(result.last_timestamp, result)
+                                    : 0.0,
+           megabytes,
+           elapsed,
+           megabytes / max(elapsed, 1e-6));
+    if (!result.damaged()) {
+      printf("  OK\n");
+      continue;
+    }
+    damaged = true;
+    printf("  Damaged ranges: %d (%" PRIu64 " bytes lost), records with "
+           "malformed payloads: %" PRIu64 "\n",
+           result.num_damaged_ranges,
+           result.damaged_bytes,
+           result.num_bad_payloads);
+    if (repairing) {
+      printf("  Wrote the valid records to %s\n", repair_file.c_str());
+    }
+    if (!truncate_logs) continue;
+    if (result.tail_bytes != result.damaged_bytes) {
+      printf("  Not truncated, since it is damaged before its end, use "
+             "-repair instead\n");
+    } else if (result.tail_bytes > 0) {
+      const uint64_t size = result.log_size - result.tail_bytes;
+      if (truncate(log_file.c_str(), static_cast<off_t>(size)) != 0) {
+        perror(("Error truncating \"" + log_file + "\"").c_str());
+        error = true;
+        continue;
+      }
+      printf("  Truncated to %" PRIu64 " bytes\n", size);
+    }
+  }
+  if (error) return 1;
+  return damaged ? 2 : 0;
+}
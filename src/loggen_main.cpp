@@ -0,0 +1,192 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Generator of synthetic game logs in the format of the logger, to benchmark
+// the logger, playback and the evaluation without real tournament logs.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "shared/log_generator.h"
+#include "shared/log_writer.h"
+#include "shared/misc_util.h"
+
+using std::max;
+using std::min;
+using std::string;
+using std::vector;
+
+// Parse a comma-separated list of numbers.
+bool ParseList(const char* arg, vector<double>* values) {
+  values->clear();
+  const char* ptr = arg;
+  while (true) {
+    char* end = NULL;
+    const double value = strtod(ptr, &end);
+    if (end == ptr || value < 0.0) return false;
+    values->push_back(value);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    ptr = end + 1;
+  }
+}
+
+void PrintUsage() {
+  printf("Usage: loggen [options] output.log\n"
+         "Options:\n"
+         "  -seed S          Seed of the random generator. Default: 1\n"
+         "  -duration S      Duration of the game in seconds. Default: 600\n"
+         "  -start T         UNIX time of the start of the log, in seconds.\n"
+         "                   Default: 1467331200\n"
+         "  -cameras N       Number of cameras. Default: 4\n"
+         "  -fps F           Frame rate of every camera. Default: 60\n"
+         "  -geometry N      Send the field geometry every N frames of every\n"
+         "                   camera, or never if 0. Default: 30\n"
+         "  -robots N        Number of robots per team. Default: 6\n"
+         "  -division A|B    Field size of division A or B. Default: B\n"
+         "  -referee-rate R  Packet rate of every referee. Default: 10\n"
+         "  -event-period S  Mean duration of play between events, in\n"
+         "                   seconds. Default: 30\n"
+         "  -yellow NAME     Name of the yellow team. Default: Yellow\n"
+         "  -blue NAME       Name of the blue team. Default: Blue\n"
+         "  -autorefs K      Number of autorefs. Default: 2\n"
+         "The following autoref options take a comma-separated list of\n"
+         "values for autorefs 1, 2, ..., K, where the last value is used for\n"
+         "the remaining autorefs:\n"
+         "  -lag S           Mean lag behind the human referee, in seconds.\n"
+         "                   Default: 0.5\n"
+         "  -jitter S        Maximum deviation from the mean lag, in\n"
+         "                   seconds. Default: 0.2\n"
+         "  -miss P          Probability of missing an event. Default: 0.1\n"
+         "  -false-alarm P   Probability of an extra event before every\n"
+         "                   event. Default: 0.05\n"
+         "  -confusion P     Probability of calling an event with a\n"
+         "                   different command. Default: 0.05\n");
+}
+
+int main(int argc, char* argv[]) {
+  SyntheticLogParameters parameters;
+  string output_file;
+  int num_autorefs = 2;
+  // Autoref parameters, by option, and their targets.
+  static const int kNumAutorefOptions = 5;
+  static const char* kAutorefOptions[kNumAutorefOptions] =
+      {"-lag", "-jitter", "-miss", "-false-alarm", "-confusion"};
+  double SyntheticAutorefParameters::* const
+      kAutorefFields[kNumAutorefOptions] = {
+    &SyntheticAutorefParameters::lag,
+    &SyntheticAutorefParameters::jitter,
+    &SyntheticAutorefParameters::miss_rate,
+    &SyntheticAutorefParameters::false_alarm_rate,
+    &SyntheticAutorefParameters::confusion_rate,
+  };
+  vector<double> autoref_values[kNumAutorefOptions];
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    int autoref_option = -1;
+    for (int j = 0; j < kNumAutorefOptions; ++j) {
+      if (strcmp(argv[i], kAutorefOptions[j]) == 0) autoref_option = j;
+    }
+    if (autoref_option >= 0 && has_value) {
+      if (!ParseList(argv[++i], &(autoref_values[autoref_option]))) {
+        fprintf(stderr, "Invalid values \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-seed") == 0 && has_value) {
+      parameters.seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-duration") == 0 && has_value) {
+      parameters.duration = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-start") == 0 && has_value) {
+      parameters.start_time = llround(1e6 * atof(argv[++i]));
+    } else if (strcmp(argv[i], "-cameras") == 0 && has_value) {
+      parameters.num_cameras = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-fps") == 0 && has_value) {
+      parameters.camera_rate = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-geometry") == 0 && has_value) {
+      parameters.geometry_period = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-robots") == 0 && has_value) {
+      parameters.robots_per_team = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-division") == 0 && has_value) {
+      parameters.division_a = (strcmp(argv[++i], "A") == 0);
+    } else if (strcmp(argv[i], "-referee-rate") == 0 && has_value) {
+      parameters.referee_rate = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-event-period") == 0 && has_value) {
+      parameters.event_period = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-yellow") == 0 && has_value) {
+      parameters.yellow_name = argv[++i];
+    } else if (strcmp(argv[i], "-blue") == 0 && has_value) {
+      parameters.blue_name = argv[++i];
+    } else if (strcmp(argv[i], "-autorefs") == 0 && has_value) {
+      num_autorefs = atoi(argv[++i]);
+    } else if (argv[i][0] == '-' || !output_file.empty()) {
+      PrintUsage();
+      return 1;
+    } else {
+      output_file = argv[i];
+    }
+  }
+  if (output_file.empty() ||
+      parameters.duration <= 0.0 ||
+      parameters.num_cameras < 0 ||
+      parameters.camera_rate <= 0.0 ||
+      parameters.geometry_period < 0 ||
+      parameters.robots_per_team < 0 ||
+      parameters.referee_rate <= 0.0 ||
+      parameters.event_period <= 0.0 ||
+      num_autorefs < 0) {
+    PrintUsage();
+    return 1;
+  }
+  parameters.autorefs.resize(num_autorefs);
+  for (int i = 0; i < num_autorefs; ++i) {
+    for (int j = 0; j < kNumAutorefOptions; ++j) {
+      const vector<double>& values = autoref_values[j];
+      if (values.empty()) continue;
+      parameters.autorefs[i].*kAutorefFields[j] =
+          values[min<size_t>(i, values.size() - 1)];
+    }
+  }
+
+  LogWriter writer;
+  if (!writer.Open(output_file)) {
+    perror(("Error opening \"" + output_file + "\"").c_str());
+    return 1;
+  }
+  const uint64_t t_start = GetTimeUSec();
+  if (!GenerateSyntheticLog(parameters, &writer) || !writer.Close()) {
+    fprintf(stderr, "Error writing \"%s\"\n", output_file.c_str());
+    return 1;
+  }
+  const double elapsed = 1e-6 * static_cast<double>(GetTimeUSec() - t_start);
+  const double megabytes =
+      static_cast<double>(writer.bytes_written()) / (1024.0 * 1024.0);
+  printf("Wrote %.1f MB, %.0f s of game, to %s in %.1f s, %.1f MB/s\n",
+         megabytes,
+         parameters.duration,
+         output_file.c_str(),
+         elapsed,
+         megabytes / max(elapsed, 1e-6));
+  return 0;
+}
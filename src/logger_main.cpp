@@ -32,11 +32,13 @@
 #include <string>
 #include <vector>
 
+#include "shared/log_writer.h"
 #include "shared/netraw.h"
 #include "shared/misc_util.h"
 #include "shared/pthread_utils.h"
+#include "shared/stream_recorder.h"
+#include "shared/trace.h"
 #include "shared/util.h"
-#include "udp_message_wrapper.pb.h"
 
 using std::string;
 using std::vector;
@@ -62,8 +64,8 @@ bool run_ = true;
 // Mutex for writing to the log file.
 pthread_mutex_t logging_mutex_ = PTHREAD_MUTEX_INITIALIZER;
 
-// Handle to log file.
-FILE* log_file_ = NULL;
+// Writer of the log file.
+LogWriter log_writer_;
 
 // Verbose mode: print referee events as they are logged.
 bool verbose = false;
@@ -102,6 +104,8 @@ class ProtobufLogger {
     static const bool kDebug = false;
     ProtobufLogger &logger =
         *(reinterpret_cast<ProtobufLogger*>(logger_ptr));
+    TRACE_THREAD_NAME(StringPrintf(
+        "logger %s:%d", logger.ip_address_.c_str(), logger.port_number_));
     // Initialize network multicast client.
     const string net_address(logger.ip_address_.c_str());
     Net::UDP client;
@@ -130,32 +134,25 @@ class ProtobufLogger {
     // Start receive loop.
     Net::Address src;
     char* receive_buffer = new char[kMaxDatagramSize];
-    string write_buffer;
-    UDPMessageWrapper message_wrapper;
-    message_wrapper.set_address(logger.ip_address_);
-    message_wrapper.set_port(logger.port_number_);
+    StreamRecorder recorder(logger.ip_address_,
+                            logger.port_number_,
+                            &log_writer_,
+                            &logging_mutex_);
     while (run_) {
       const int bytes_received =
           client.recv(receive_buffer, kMaxDatagramSize, src);
       if (bytes_received>0) {
+        // The receive itself blocks until the next datagram, and is not
+        // traced.
+        TRACE_SCOPE("log");
         if (verbose || kDebug) {
           printf("Received %d bytes from %s:%d\n",
                 bytes_received,
                 logger.ip_address_.c_str(),
                 logger.port_number_);
         }
-        message_wrapper.set_timestamp(GetTimeUSec());
-        message_wrapper.set_data(receive_buffer, bytes_received);
-        message_wrapper.SerializeToString(&write_buffer);
         // Log data.
-        ScopedLock lock(logging_mutex_);
-
-        // Write size of packet.
-        const uint32_t packet_size = write_buffer.size();
-        fwrite(&packet_size, sizeof(packet_size), 1, log_file_);
-
-        // Write packet payload.
-        fwrite(write_buffer.data(), 1, packet_size, log_file_);
+        recorder.Record(receive_buffer, bytes_received, GetTimeUSec());
       }
     }
     delete receive_buffer;
@@ -174,7 +171,8 @@ void SigIntHandler(int) {
 }
 
 void PrintUsage() {
-  printf("Usage: logger [-v] [address1:port1] [address2:port2] ...\n");
+  printf("Usage: logger [-v] [-trace file] [address1:port1] "
+         "[address2:port2] ...\n");
 }
 
 string GetFileName() {
@@ -211,11 +209,20 @@ int main(int argc, char *argv[]) {
     return 0;
   }
   signal(SIGINT, SigIntHandler);
+  // Start tracing before the logger threads.
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "-trace") == 0 && !StartTracing(argv[i + 1])) {
+      return 1;
+    }
+  }
 
   // Initialize clients, log file.
   const string file_name = GetFileName();
   printf("Logging to %s\n", file_name.c_str());
-  log_file_ = fopen(file_name.c_str(), "w");
+  if (!log_writer_.Open(file_name)) {
+    perror(("Error opening \"" + file_name + "\"").c_str());
+    return 1;
+  }
 
   vector<ProtobufLogger*> loggers;
   // Create logger for SSL Vision.
@@ -230,6 +237,10 @@ int main(int argc, char *argv[]) {
       verbose = true;
       continue;
     }
+    if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+      ++i;
+      continue;
+    }
 
     int port_number = 0;
     string address;
@@ -253,6 +264,7 @@ int main(int argc, char *argv[]) {
     loggers[i] = NULL;
   }
 
-  fclose(log_file_);
-  return 0;
+  ScopedLock lock(logging_mutex_);
+  const bool success = log_writer_.Close();
+  return ((StopTracing() && success) ? 0 : 1);
 }
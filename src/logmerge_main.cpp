@@ -0,0 +1,145 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Merges the logs of several loggers, e.g. of the vision, refbox and autoref
+// machines of an event, into a single log in order of receive time.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "shared/log_merger.h"
+#include "shared/log_writer.h"
+#include "shared/misc_util.h"
+
+using std::max;
+using std::string;
+using std::vector;
+
+// Parse a comma-separated list of numbers.
+bool ParseList(const char* arg, vector<double>* values) {
+  values->clear();
+  const char* ptr = arg;
+  while (true) {
+    char* end = NULL;
+    const double value = strtod(ptr, &end);
+    if (end == ptr) return false;
+    values->push_back(value);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    ptr = end + 1;
+  }
+}
+
+void PrintUsage() {
+  printf("Usage: logmerge [options] -o output.log input1.log [input2.log ...]\n"
+         "Merges logs in order of receive time, in a single pass with\n"
+         "constant memory. Every input should be in order of receive time,\n"
+         "as the logger writes them. Datagrams logged by more than one\n"
+         "logger are written once.\n"
+         "Options:\n"
+         "  -o FILE          Output log.\n"
+         "  -offsets S       Comma-separated clock offsets of the inputs in\n"
+         "                   seconds, in the order of the inputs, added to\n"
+         "                   their receive timestamps. Missing offsets are 0.\n"
+         "  -window S        Identical datagrams (address, port and data) of\n"
+         "                   different inputs received within S seconds of\n"
+         "                   each other are duplicates, 0 to keep all.\n"
+         "                   Default: %g\n",
+         1e-6 * static_cast<double>(LogMerger::kDefaultDedupWindow));
+}
+
+int main(int argc, char* argv[]) {
+  string output_file;
+  vector<double> offsets;
+  double window = 1e-6 * static_cast<double>(LogMerger::kDefaultDedupWindow);
+  vector<string> input_files;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-o") == 0 && has_value) {
+      output_file = argv[++i];
+    } else if (strcmp(argv[i], "-offsets") == 0 && has_value) {
+      if (!ParseList(argv[++i], &offsets)) {
+        fprintf(stderr, "Invalid offsets \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-window") == 0 && has_value) {
+      window = atof(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      input_files.push_back(argv[i]);
+    }
+  }
+  if (output_file.empty() || input_files.empty() || window < 0.0 ||
+      offsets.size() > input_files.size()) {
+    PrintUsage();
+    return 1;
+  }
+  if (std::find(input_files.begin(), input_files.end(), output_file) !=
+      input_files.end()) {
+    fprintf(stderr, "The output log cannot be one of the inputs\n");
+    return 1;
+  }
+  offsets.resize(input_files.size(), 0.0);
+
+  LogMerger merger;
+  merger.set_dedup_window(llround(1e6 * window));
+  for (size_t i = 0; i < input_files.size(); ++i) {
+    merger.AddInput(input_files[i], llround(1e6 * offsets[i]));
+  }
+  LogWriter writer;
+  if (!writer.Open(output_file)) {
+    perror(("Error opening \"" + output_file + "\"").c_str());
+    return 1;
+  }
+  const uint64_t t_start = GetMonotonicTimeNSec();
+  if (!merger.Merge(&writer) || !writer.Close()) {
+    fprintf(stderr, "Error merging into \"%s\"\n", output_file.c_str());
+    return 1;
+  }
+  const double elapsed =
+      1e-9 * static_cast<double>(GetMonotonicTimeNSec() - t_start);
+  for (int i = 0; i < merger.num_inputs(); ++i) {
+    printf("%s: %" PRIu64 " records, %" PRIu64 " duplicates",
+           input_files[i].c_str(),
+           merger.num_read(i),
+           merger.num_duplicates(i));
+    if (merger.num_malformed(i) > 0) {
+      printf(", %" PRIu64 " malformed", merger.num_malformed(i));
+    }
+    printf("\n");
+  }
+  const double megabytes =
+      static_cast<double>(writer.bytes_written()) / (1024.0 * 1024.0);
+  printf("Wrote %" PRIu64 " records, %.1f MB, to %s in %.1f s, %.1f MB/s\n",
+         merger.num_written(),
+         megabytes,
+         output_file.c_str(),
+         elapsed,
+         megabytes / max(elapsed, 1e-6));
+  return 0;
+}
@@ -0,0 +1,305 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Extracts time ranges of a log, or splits a log into one log per game, by
+// copying the byte ranges of the selected records without re-encoding them.
+
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "shared/log_index.h"
+#include "shared/log_reader.h"
+#include "shared/misc_util.h"
+#include "shared/wire_decoder.h"
+
+using std::max;
+using std::min;
+using std::string;
+using std::vector;
+
+// Maximum number of bytes copied at once.
+static const size_t kCopyBlockSize = 1 << 20;
+
+// Default duration of POST_GAME kept at the end of every game, in seconds.
+static const double kDefaultPostGame = 10.0;
+
+// Find the file offset of the first record received at or after time t, or
+// the end of the log if there is none. Returns false on a read error.
+bool FindRecord(const LogIndex& index,
+                uint64_t t,
+                LogReader* reader,
+                uint64_t* offset) {
+  if (!reader->Seek(index.FindOffset(t))) return false;
+  while (true) {
+    *offset = reader->Tell();
+    if (!reader->ReadRecord()) {
+      return (reader->status() != LogReader::kReadError);
+    }
+    EnvelopeView envelope;
+    if (DecodeEnvelope(reader->record(), reader->record_size(), &envelope) &&
+        envelope.timestamp >= t) {
+      return true;
+    }
+  }
+}
+
+// Copy the bytes [begin, end) of a file to a new file, in the kernel if
+// possible. Returns false on error.
+bool CopyRange(const string& input_file,
+               uint64_t begin,
+               uint64_t end,
+               const string& output_file) {
+  ScopedFile input(input_file, "rb", true);
+  if (input() == NULL) return false;
+  FILE* output = fopen(output_file.c_str(), "wb");
+  if (output == NULL) {
+    perror(("Error opening \"" + output_file + "\"").c_str());
+    return false;
+  }
+  off_t offset = static_cast<off_t>(begin);
+  bool use_sendfile = true;
+  bool error = false;
+  while (!error && static_cast<uint64_t>(offset) < end) {
+    const size_t size = static_cast<size_t>(
+        min<uint64_t>(end - offset, kCopyBlockSize));
+    if (use_sendfile) {
+      const ssize_t num_copied =
+          sendfile(fileno(output), fileno(input), &offset, size);
+      if (num_copied > 0) continue;
+      // Not supported for these files, copy through a buffer instead.
+      use_sendfile = false;
+      error = (num_copied == 0 || (errno != EINVAL && errno != ENOSYS));
+      if (!error) {
+        error = (fseeko(input, offset, SEEK_SET) != 0 ||
+                 fseeko(output, offset - static_cast<off_t>(begin),
+                        SEEK_SET) != 0);
+      }
+      continue;
+    }
+    static char buffer[kCopyBlockSize];
+    error = (fread(buffer, 1, size, input) != size ||
+             fwrite(buffer, 1, size, output) != size);
+    offset += size;
+  }
+  if (fclose(output) != 0) error = true;
+  if (error) perror(("Error copying to \"" + output_file + "\"").c_str());
+  return !error;
+}
+
+// Copy the records of a log received in a time window to a new log. Returns
+// false on error.
+bool CopyWindow(const string& log_file,
+                const LogIndex& index,
+                const TimeWindow& window,
+                const string& output_file,
+                uint64_t* size) {
+  LogReader reader;
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  if (!reader.Open(log_file) ||
+      !FindRecord(index, window.begin, &reader, &begin) ||
+      !FindRecord(index, window.end, &reader, &end)) {
+    perror(("Error reading \"" + log_file + "\"").c_str());
+    return false;
+  }
+  *size = end - begin;
+  return CopyRange(log_file, begin, end, output_file);
+}
+
+// Returns a team name that can be part of a file name.
+string FileNamePart(const string& name) {
+  if (name.empty()) return "unknown";
+  string part = name;
+  for (size_t i = 0; i < part.size(); ++i) {
+    const char c = part[i];
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+      part[i] = '_';
+    }
+  }
+  return part;
+}
+
+// Parse a time window of the form "begin:end" in seconds, where either of
+// them may be omitted to select the start or the end of the log.
+bool ParseTimeWindow(const char* arg, TimeWindow* window) {
+  const char* separator = strchr(arg, ':');
+  if (separator == NULL) return false;
+  double begin = 0.0;
+  double end = 0.0;
+  window->begin = 0;
+  window->end = std::numeric_limits<uint64_t>::max();
+  if (separator > arg) {
+    if (sscanf(arg, "%lf", &begin) != 1 || begin < 0.0) return false;
+    window->begin = llround(1e6 * begin);
+  }
+  if (separator[1] != '\0') {
+    if (sscanf(separator + 1, "%lf", &end) != 1 || end < begin) return false;
+    window->end = llround(1e6 * end);
+  }
+  return true;
+}
+
+void PrintUsage() {
+  printf("Usage: logslice [options] input.log\n"
+         "Copies the records of a time window of a log, or of every game of\n"
+         "a log, to new logs, without re-encoding them. The log is indexed\n"
+         "first, unless it already is.\n"
+         "Options:\n"
+         "  -time B:E      Copy the records from B to E seconds after the\n"
+         "                 first record. Either may be omitted.\n"
+         "  -abstime B:E   Copy the records from UNIX time B to E, in\n"
+         "                 seconds.\n"
+         "  -o FILE        Output log of -time and -abstime.\n"
+         "  -games         Split the log into one log per game, named\n"
+         "                 PREFIX-gameN-YELLOW-vs-BLUE.log. A game starts\n"
+         "                 at NORMAL_FIRST_HALF_PRE or at a change of the\n"
+         "                 team names, and ends in POST_GAME.\n"
+         "  -prefix P      Prefix of the logs of -games. Default: the input\n"
+         "                 log without \".log\"\n"
+         "  -post S        Seconds of POST_GAME kept at the end of every\n"
+         "                 game. Default: %g\n"
+         "  -list          Only list the games, without copying them.\n",
+         kDefaultPostGame);
+}
+
+int main(int argc, char* argv[]) {
+  string log_file;
+  string output_file;
+  string prefix;
+  bool has_window = false;
+  bool relative_time = false;
+  TimeWindow window;
+  bool split_games = false;
+  bool list_only = false;
+  double post_game = kDefaultPostGame;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if ((strcmp(argv[i], "-time") == 0 ||
+         strcmp(argv[i], "-abstime") == 0) && has_value) {
+      relative_time = (strcmp(argv[i], "-time") == 0);
+      has_window = true;
+      if (!ParseTimeWindow(argv[++i], &window)) {
+        fprintf(stderr, "Invalid time window \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+      output_file = argv[++i];
+    } else if (strcmp(argv[i], "-games") == 0) {
+      split_games = true;
+    } else if (strcmp(argv[i], "-prefix") == 0 && has_value) {
+      prefix = argv[++i];
+    } else if (strcmp(argv[i], "-post") == 0 && has_value) {
+      post_game = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-list") == 0) {
+      list_only = true;
+    } else if (argv[i][0] == '-' || !log_file.empty()) {
+      PrintUsage();
+      return 1;
+    } else {
+      log_file = argv[i];
+    }
+  }
+  if (log_file.empty() || has_window == split_games ||
+      (has_window && output_file.empty()) || post_game < 0.0) {
+    PrintUsage();
+    return 1;
+  }
+  if (output_file == log_file) {
+    fprintf(stderr, "The output log cannot be the input log\n");
+    return 1;
+  }
+
+  const uint64_t t_start = GetMonotonicTimeNSec();
+  LogIndex index;
+  if (!index.Open(log_file)) return 1;
+  const uint64_t t0 = index.first_timestamp();
+  uint64_t total_size = 0;
+  if (has_window) {
+    if (relative_time) {
+      const uint64_t kMax = std::numeric_limits<uint64_t>::max();
+      window.begin = min(window.begin, kMax - t0) + t0;
+      window.end = min(window.end, kMax - t0) + t0;
+    }
+    if (!CopyWindow(log_file, index, window, output_file, &total_size)) {
+      return 1;
+    }
+    printf("Wrote %.1f MB to %s\n",
+           static_cast<double>(total_size) / (1024.0 * 1024.0),
+           output_file.c_str());
+  } else {
+    if (prefix.empty()) {
+      prefix = log_file;
+      if (prefix.size() > 4 &&
+          prefix.compare(prefix.size() - 4, 4, ".log") == 0) {
+        prefix.resize(prefix.size() - 4);
+      }
+    }
+    vector<GameWindow> games;
+    index.FindGames(llround(1e6 * post_game), &games);
+    if (games.empty()) printf("No games found in %s\n", log_file.c_str());
+    for (size_t i = 0; i < games.size(); ++i) {
+      const GameWindow& game = games[i];
+      printf("Game %d: %s vs %s, from %.1f s to %.1f s (%.1f min)\n",
+             static_cast<int>(i + 1),
+             game.yellow_name.c_str(),
+             game.blue_name.c_str(),
+             1e-6 * static_cast<double>(game.window.begin - t0),
+             1e-6 * static_cast<double>(game.window.end - t0),
+             1e-6 / 60.0 *
+                 static_cast<double>(game.window.end - game.window.begin));
+      if (list_only) continue;
+      const string game_file = StringPrintf(
+          "%s-game%d-%s-vs-%s.log",
+          prefix.c_str(),
+          static_cast<int>(i + 1),
+          FileNamePart(game.yellow_name).c_str(),
+          FileNamePart(game.blue_name).c_str());
+      uint64_t size = 0;
+      if (!CopyWindow(log_file, index, game.window, game_file, &size)) {
+        return 1;
+      }
+      printf("  Wrote %.1f MB to %s\n",
+             static_cast<double>(size) / (1024.0 * 1024.0),
+             game_file.c_str());
+      total_size += size;
+    }
+  }
+  if (list_only) return 0;
+  const double elapsed =
+      1e-9 * static_cast<double>(GetMonotonicTimeNSec() - t_start);
+  const double megabytes = static_cast<double>(total_size) / (1024.0 * 1024.0);
+  printf("Copied %.1f MB in %.2f s (%.0f MB/s)%s\n",
+         megabytes,
+         elapsed,
+         megabytes / max(elapsed, 1e-6),
+         index.built() ? ", including indexing the log" : "");
+  return 0;
+}
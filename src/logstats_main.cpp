@@ -0,0 +1,463 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Reports the packet rates, gaps and jitter of every stream of a log, the
+// frame continuity and latency of every camera, and the command continuity
+// of every referee.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shared/histogram.h"
+#include "shared/log_reader.h"
+#include "shared/misc_util.h"
+#include "shared/wire_decoder.h"
+
+using std::map;
+using std::max;
+using std::min;
+using std::string;
+using std::vector;
+
+// UDP Multicast addresses for referees and vision.
+static const char* kRefereeMulticast = "224.5.23.1";
+static const char* kVisionMulticast = "224.5.23.2";
+
+// Maximum number of gaps printed per stream.
+static const size_t kMaxPrintedGaps = 10;
+
+// Maximum distance that a frame number or command counter goes back by, for
+// the packet to be counted as reordered rather than as a restart of its
+// sender.
+static const uint32_t kMaxReorder = 16;
+
+// Options of the statistics.
+struct StatsOptions {
+  StatsOptions() :
+      interval(10000000), gap_threshold(1000000), print_timeline(false) {}
+
+  // Length of the intervals over which packet rates are measured, in
+  // microseconds.
+  uint64_t interval;
+
+  // Minimum time between two packets of a stream reported as a gap, in
+  // microseconds.
+  uint64_t gap_threshold;
+
+  // Print the packet rate of every interval of every stream.
+  bool print_timeline;
+};
+
+// A time without packets on a stream, in receive timestamps.
+struct Gap {
+  Gap(uint64_t start, uint64_t duration) : start(start), duration(duration) {}
+
+  uint64_t start;
+  uint64_t duration;
+};
+
+// Continuity of a sequence number that a sender increments, e.g. a frame
+// number or command counter.
+struct SequenceStats {
+  SequenceStats() :
+      num_values(0), num_missed(0), num_repeated(0), num_out_of_order(0),
+      num_restarts(0), last(0) {}
+
+  // Add the sequence number of the next packet.
+  void Add(uint32_t value) {
+    if (num_values > 0 && value == last) {
+      ++num_repeated;
+      return;
+    }
+    if (num_values > 0 && value < last && last - value <= kMaxReorder) {
+      // A late packet, which was counted as missed when it was skipped.
+      ++num_out_of_order;
+      if (num_missed > 0) {
+        --num_missed;
+        ++num_values;
+      }
+      return;
+    }
+    if (num_values > 0 && value < last) {
+      ++num_restarts;
+    } else if (num_values > 0) {
+      num_missed += value - last - 1;
+    }
+    ++num_values;
+    last = value;
+  }
+
+  // Distinct values seen, values skipped, packets with the same value as the
+  // previous one, late packets, and times that the value went back by more
+  // than kMaxReorder, e.g. when the sender was restarted.
+  uint64_t num_values;
+  uint64_t num_missed;
+  uint64_t num_repeated;
+  uint64_t num_out_of_order;
+  uint64_t num_restarts;
+
+  // Largest value since the last restart.
+  uint32_t last;
+};
+
+// Frame continuity and latency of a camera.
+struct CameraStats {
+  SequenceStats frames;
+
+  // t_sent - t_capture, in microseconds.
+  Histogram latency;
+};
+
+// Statistics of the packets sent to a multicast address and port.
+struct StreamStats {
+  StreamStats(const string& address, int port) :
+      address(address), port(port), num_packets(0), num_bytes(0),
+      first_timestamp(0), last_timestamp(0), num_gaps(0), longest_gap(0),
+      total_gap(0), num_malformed(0), is_referee(false) {}
+
+  string address;
+  int port;
+
+  uint64_t num_packets;
+  uint64_t num_bytes;
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+
+  // Packets received in every interval since the first packet.
+  vector<uint64_t> interval_packets;
+
+  // Time between consecutive packets, in microseconds.
+  Histogram inter_arrival;
+
+  // The first kMaxPrintedGaps gaps, and all gaps in total.
+  vector<Gap> gaps;
+  uint64_t num_gaps;
+  uint64_t longest_gap;
+  uint64_t total_gap;
+
+  // Payloads that did not decode: for vision, packets without a detection
+  // frame, e.g. geometry packets.
+  uint64_t num_malformed;
+
+  // Continuity of vision payloads, by camera_id.
+  map<uint32_t, CameraStats> cameras;
+
+  // Continuity of the command_counter of referee payloads.
+  bool is_referee;
+  SequenceStats commands;
+};
+
+// Returns a receive timestamp as seconds since the start of the log.
+double LogTime(uint64_t t, uint64_t log_start) {
+  return 1e-6 * (static_cast<double>(t) - static_cast<double>(log_start));
+}
+
+// Returns true iff an envelope was sent to the address and port of a stream.
+bool IsStreamOf(const StreamStats& stream, const EnvelopeView& envelope) {
+  return (stream.port == envelope.port &&
+          stream.address.size() == envelope.address_size &&
+          memcmp(stream.address.data(), envelope.address,
+                 envelope.address_size) == 0);
+}
+
+// Returns the stream of an envelope, added if it was not seen before. Logs
+// have few streams, so they are searched linearly, without building a
+// string.
+StreamStats* FindStream(const EnvelopeView& envelope,
+                        vector<StreamStats>* streams) {
+  for (size_t i = 0; i < streams->size(); ++i) {
+    if (IsStreamOf((*streams)[i], envelope)) return &(*streams)[i];
+  }
+  streams->push_back(StreamStats(envelope.Address(), envelope.port));
+  streams->back().is_referee = envelope.AddressIs(kRefereeMulticast);
+  return &streams->back();
+}
+
+void AddVisionPacket(const EnvelopeView& envelope, StreamStats* stream) {
+  VisionFrameView frame;
+  if (!DecodeVisionFrame(envelope.data, envelope.data_size, &frame)) {
+    ++stream->num_malformed;
+    return;
+  }
+  CameraStats& camera = stream->cameras[frame.camera_id];
+  camera.frames.Add(frame.frame_number);
+  camera.latency.Add(static_cast<int64_t>(
+      llround(1e6 * (frame.t_sent - frame.t_capture))));
+}
+
+void AddRefereePacket(const EnvelopeView& envelope,
+                      RefereeView* view,
+                      StreamStats* stream) {
+  if (!DecodeReferee(envelope.data, envelope.data_size, view)) {
+    ++stream->num_malformed;
+    return;
+  }
+  stream->commands.Add(view->command_counter);
+}
+
+void AddPacket(const EnvelopeView& envelope,
+               const StatsOptions& options,
+               RefereeView* referee,
+               StreamStats* stream) {
+  const uint64_t t = envelope.timestamp;
+  if (stream->num_packets == 0) {
+    stream->first_timestamp = t;
+  } else {
+    const int64_t delta = static_cast<int64_t>(t - stream->last_timestamp);
+    stream->inter_arrival.Add(delta);
+    if (delta > static_cast<int64_t>(options.gap_threshold)) {
+      if (stream->gaps.size() < kMaxPrintedGaps) {
+        stream->gaps.push_back(Gap(stream->last_timestamp, delta));
+      }
+      ++stream->num_gaps;
+      stream->longest_gap = max<uint64_t>(stream->longest_gap, delta);
+      stream->total_gap += delta;
+    }
+  }
+  ++stream->num_packets;
+  stream->num_bytes += envelope.data_size;
+  stream->last_timestamp = max(stream->last_timestamp, t);
+
+  // Packets received before the first packet of the stream, in a log with
+  // timestamps that go back, are counted in the first interval.
+  const uint64_t interval = (t > stream->first_timestamp) ?
+      (t - stream->first_timestamp) / options.interval : 0;
+  if (interval >= stream->interval_packets.size()) {
+    stream->interval_packets.resize(interval + 1, 0);
+  }
+  ++stream->interval_packets[interval];
+
+  if (envelope.AddressIs(kVisionMulticast)) {
+    AddVisionPacket(envelope, stream);
+  } else if (stream->is_referee) {
+    AddRefereePacket(envelope, referee, stream);
+  }
+}
+
+void PrintStream(const StreamStats& stream,
+                 const StatsOptions& options,
+                 uint64_t log_start) {
+  const double duration =
+      1e-6 * static_cast<double>(stream.last_timestamp -
+                                 stream.first_timestamp);
+  const double rate_duration = max(duration, 1e-6);
+  printf("%s:%d\n", stream.address.c_str(), stream.port);
+  printf("  Packets: %" PRIu64 " over %.3f s from %.3f s (%.1f/s), "
+         "%.1f kB (%.1f kB/s)\n",
+         stream.num_packets,
+         duration,
+         LogTime(stream.first_timestamp, log_start),
+         (stream.num_packets > 1) ?
+             static_cast<double>(stream.num_packets - 1) / rate_duration : 0.0,
+         static_cast<double>(stream.num_bytes) / 1024.0,
+         static_cast<double>(stream.num_bytes) / 1024.0 / rate_duration);
+
+  // The last interval is partial, so it is left out of the rates unless it
+  // is the only one.
+  const double interval = 1e-6 * static_cast<double>(options.interval);
+  const size_t num_complete = max<size_t>(stream.interval_packets.size() - 1,
+                                          1);
+  uint64_t min_packets = stream.interval_packets[0];
+  uint64_t max_packets = stream.interval_packets[0];
+  for (size_t i = 1; i < num_complete; ++i) {
+    min_packets = min(min_packets, stream.interval_packets[i]);
+    max_packets = max(max_packets, stream.interval_packets[i]);
+  }
+  printf("  Rate per %.3g s: min %.1f/s, max %.1f/s\n",
+         interval,
+         static_cast<double>(min_packets) / interval,
+         static_cast<double>(max_packets) / interval);
+  if (options.print_timeline) {
+    for (size_t i = 0; i < stream.interval_packets.size(); ++i) {
+      printf("    %10.3f s: %.1f/s\n",
+             LogTime(stream.first_timestamp, log_start) + interval * i,
+             static_cast<double>(stream.interval_packets[i]) / interval);
+    }
+  }
+  stream.inter_arrival.Print(stdout, "  Inter-arrival (us)");
+  printf("  Gaps over %.3f s: %" PRIu64,
+         1e-6 * static_cast<double>(options.gap_threshold),
+         stream.num_gaps);
+  if (stream.num_gaps > 0) {
+    printf(", longest %.3f s, %.3f s in total",
+           1e-6 * static_cast<double>(stream.longest_gap),
+           1e-6 * static_cast<double>(stream.total_gap));
+  }
+  printf("\n");
+  for (size_t i = 0; i < stream.gaps.size(); ++i) {
+    printf("    %.3f s after %.3f s\n",
+           1e-6 * static_cast<double>(stream.gaps[i].duration),
+           LogTime(stream.gaps[i].start, log_start));
+  }
+  if (stream.num_gaps > stream.gaps.size()) {
+    printf("    ... and %" PRIu64 " more\n",
+           stream.num_gaps - stream.gaps.size());
+  }
+
+  for (map<uint32_t, CameraStats>::const_iterator it = stream.cameras.begin();
+       it != stream.cameras.end(); ++it) {
+    const CameraStats& camera = it->second;
+    const SequenceStats& frames = camera.frames;
+    printf("  Camera %u: %" PRIu64 " frames (%.1f/s), %" PRIu64 " dropped, "
+           "%" PRIu64 " repeated, %" PRIu64 " out of order, %" PRIu64
+           " restarts\n",
+           it->first,
+           frames.num_values,
+           static_cast<double>(frames.num_values) / rate_duration,
+           frames.num_missed,
+           frames.num_repeated,
+           frames.num_out_of_order,
+           frames.num_restarts);
+    const string label = StringPrintf("  Camera %u latency (us)", it->first);
+    camera.latency.Print(stdout, label.c_str());
+  }
+  if (stream.is_referee) {
+    const SequenceStats& commands = stream.commands;
+    printf("  Commands: %" PRIu64 ", %" PRIu64 " missed, %" PRIu64
+           " out of order, %" PRIu64 " counter resets, %" PRIu64
+           " malformed packets\n",
+           commands.num_values,
+           commands.num_missed,
+           commands.num_out_of_order,
+           commands.num_restarts,
+           stream.num_malformed);
+  } else if (stream.num_malformed > 0) {
+    printf("  Packets without a detection frame: %" PRIu64 "\n",
+           stream.num_malformed);
+  }
+}
+
+// Scan all the records of a log and print the statistics of its streams.
+// Returns false if the log could not be read.
+bool PrintLogStats(const string& file_name, const StatsOptions& options) {
+  LogReader reader;
+  uint64_t log_size = 0;
+  int64_t mtime = 0;
+  if (!GetFileStatus(file_name, &log_size, &mtime) ||
+      !reader.Open(file_name)) {
+    perror(("Error reading \"" + file_name + "\"").c_str());
+    return false;
+  }
+  const uint64_t t_start = GetMonotonicTimeNSec();
+  vector<StreamStats> streams;
+  RefereeView referee;
+  uint64_t num_records = 0;
+  uint64_t num_malformed = 0;
+  uint64_t log_start = 0;
+  uint64_t log_end = 0;
+  // The last stream is checked first, since packets of a stream tend to
+  // arrive in bursts.
+  StreamStats* stream = NULL;
+  while (reader.ReadRecord()) {
+    EnvelopeView envelope;
+    if (!DecodeEnvelope(reader.record(), reader.record_size(), &envelope)) {
+      ++num_malformed;
+      continue;
+    }
+    log_start = (num_records == 0) ? envelope.timestamp :
+        min(log_start, envelope.timestamp);
+    log_end = max(log_end, envelope.timestamp);
+    ++num_records;
+    if (stream == NULL || !IsStreamOf(*stream, envelope)) {
+      stream = FindStream(envelope, &streams);
+    }
+    AddPacket(envelope, options, &referee, stream);
+  }
+  if (reader.status() == LogReader::kReadError) return false;
+  const double elapsed =
+      1e-9 * static_cast<double>(GetMonotonicTimeNSec() - t_start);
+  const double megabytes = static_cast<double>(log_size) / (1024.0 * 1024.0);
+
+  printf("%s: %" PRIu64 " records over %.3f s, %.1f MB scanned in %.2f s "
+         "(%.0f MB/s)\n",
+         file_name.c_str(),
+         num_records,
+         (num_records > 0) ? LogTime(log_end, log_start) : 0.0,
+         megabytes,
+         elapsed,
+         megabytes / max(elapsed, 1e-6));
+  if (num_malformed > 0) {
+    printf("  Records with a malformed envelope: %" PRIu64 "\n",
+           num_malformed);
+  }
+  if (reader.status() != LogReader::kEnd) {
+    printf("  Damaged at offset %" PRIu64 ", the rest of the log was not "
+           "read, see logcheck\n",
+           reader.record_offset());
+  }
+  for (size_t i = 0; i < streams.size(); ++i) {
+    PrintStream(streams[i], options, log_start);
+  }
+  return true;
+}
+
+void PrintUsage() {
+  printf("Usage: logstats [options] log1 [log2 ...]\n"
+         "Reports for every stream of a log the packet count, byte volume,\n"
+         "packet rate, inter-arrival jitter and gaps; for vision, the frame\n"
+         "continuity and t_sent - t_capture latency of every camera; and\n"
+         "for referees, the continuity of command_counter.\n"
+         "Options:\n"
+         "  -interval S      Interval over which packet rates are measured,\n"
+         "                   in seconds. Default: 10\n"
+         "  -gap S           Minimum time between two packets of a stream\n"
+         "                   reported as a gap, in seconds. Default: 1\n"
+         "  -timeline        Print the packet rate of every interval.\n");
+}
+
+int main(int argc, char* argv[]) {
+  StatsOptions options;
+  vector<string> log_files;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-interval") == 0 && has_value) {
+      options.interval = llround(1e6 * atof(argv[++i]));
+    } else if (strcmp(argv[i], "-gap") == 0 && has_value) {
+      options.gap_threshold = llround(1e6 * atof(argv[++i]));
+    } else if (strcmp(argv[i], "-timeline") == 0) {
+      options.print_timeline = true;
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      log_files.push_back(argv[i]);
+    }
+  }
+  if (log_files.empty() || options.interval == 0) {
+    PrintUsage();
+    return 1;
+  }
+
+  bool error = false;
+  for (size_t i = 0; i < log_files.size(); ++i) {
+    if (!PrintLogStats(log_files[i], options)) {
+      fprintf(stderr, "Error reading \"%s\"\n", log_files[i].c_str());
+      error = true;
+    }
+  }
+  return error ? 1 : 0;
+}
@@ -19,7 +19,10 @@
 // Log playback for SSL-Vision, refbox, and multiple automatic referees.
 
 #include <arpa/inet.h>
+#include <inttypes.h>
+#include <math.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,105 +31,974 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <deque>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "messages_robocup_ssl_wrapper.pb.h"
+#include "referee.pb.h"
+#include "shared/histogram.h"
+#include "shared/log_reader.h"
+#include "shared/message_publisher.h"
 #include "shared/misc_util.h"
 #include "shared/netraw.h"
+#include "shared/pthread_utils.h"
+#include "shared/trace.h"
 #include "shared/util.h"
-#include "udp_message_wrapper.pb.h"
+#include "shared/wire_decoder.h"
 
+using std::deque;
+using std::map;
 using std::max;
 using std::string;
 using std::vector;
 
+// Maximum size of UDP datagrams to receive.
+static const int kMaxDatagramSize = 65536;
 
-// UDP publisher.
-Net::UDP publisher_;
+// UDP Multicast address for referees.
+static const char* kRefereeMulticast = "224.5.23.1";
 
-bool ReadUDPMessageWrapper(FILE* fid, UDPMessageWrapper* message) {
-  uint32_t packet_size = 0;
-  if (fread(&packet_size, sizeof(packet_size), 1, fid) != 1) {
-    return false;
+// UDP Multicast address for SSL Vision.
+static const char* kVisionMulticast = "224.5.23.2";
+
+// Port number for SSL Vision.
+static const int kVisionPort = 10006;
+
+// Offset between the camera_id of a camera and those of its duplicates.
+static const int kCameraIdStride = 8;
+
+// Port of the referee messages of the human referee.
+static const int kRefboxPort = 10003;
+
+// Longest time of the log between a command of the human referee and the
+// command of an autoref that answers it, either way, in microseconds.
+static const uint64_t kMaxAnswerDelay = 2000000;
+
+// Filter to select the records of a log to play back.
+struct StreamFilter {
+  // Returns true iff the record with the given envelope should be played
+  // back. Only vision records are decoded, and only if there are camera
+  // filters.
+  bool Accepts(const EnvelopeView& envelope, bool is_vision) const {
+    if (!include.empty()) {
+      bool included = false;
+      for (size_t i = 0; i < include.size() && !included; ++i) {
+        included = include[i].Matches(
+            envelope.address, envelope.address_size, envelope.port);
+      }
+      if (!included) return false;
+    }
+    for (size_t i = 0; i < exclude.size(); ++i) {
+      if (exclude[i].Matches(
+          envelope.address, envelope.address_size, envelope.port)) {
+        return false;
+      }
+    }
+    if (!is_vision || (include_cameras.empty() && exclude_cameras.empty())) {
+      return true;
+    }
+    uint32_t camera_id = 0;
+    if (!DecodeVisionCameraId(envelope.data, envelope.data_size, &camera_id)) {
+      // Packets without detection frames, e.g. geometry, are not filtered.
+      return true;
+    }
+    if (!include_cameras.empty() &&
+        std::find(include_cameras.begin(), include_cameras.end(), camera_id) ==
+            include_cameras.end()) {
+      return false;
+    }
+    return (std::find(exclude_cameras.begin(),
+                      exclude_cameras.end(),
+                      camera_id) == exclude_cameras.end());
+  }
+
+  // If not empty, only streams matching one of these are played back.
+  vector<StreamPattern> include;
+
+  // Streams matching any of these are not played back.
+  vector<StreamPattern> exclude;
+
+  // If not empty, only vision detections of these cameras are played back.
+  vector<uint32_t> include_cameras;
+
+  // Vision detections of these cameras are not played back.
+  vector<uint32_t> exclude_cameras;
+};
+
+// Publisher of the played back messages, to every target.
+MessagePublisher publisher_;
+
+// Flag to stop the autoref monitor threads.
+bool run_ = true;
+
+// Mutex protecting the state shared between the publisher and the autoref
+// monitor threads.
+pthread_mutex_t monitor_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+// Wall-clock time at which the most recent vision packet was published, or
+// zero if none has been published yet. Protected by monitor_mutex_.
+uint64_t t_last_vision_publish_ = 0;
+
+class AutorefMonitor;
+
+// A STOP or event command of the human referee, as it was played back.
+struct HumanCommand {
+  HumanCommand() : command(0), t_played(0), t_frame(0), window(0) {}
+
+  int command;
+
+  // Wall-clock time at which the command was played back, and at which the
+  // last vision frame before it in the log was published.
+  uint64_t t_played;
+  uint64_t t_frame;
+
+  // Wall-clock time within which autoref commands may answer it, either way:
+  // kMaxAnswerDelay at the speed it was played back at.
+  uint64_t window;
+
+  // Monitors of the autorefs whose commands answered it.
+  vector<const AutorefMonitor*> answered_by;
+};
+
+// Human referee commands played back that autoref commands may still answer.
+// Protected by monitor_mutex_.
+deque<HumanCommand> human_commands_;
+
+// Number of vision datagrams published so far.
+uint64_t vision_packets_sent_ = 0;
+
+// Vision datagram held back to be published after the next one, and the
+// address and port it was originally sent to.
+string held_datagram_;
+string held_address_;
+int held_port_ = 0;
+
+// Options for playback, and for altering the played back vision traffic to
+// stress test autorefs.
+struct PlaybackOptions {
+  PlaybackOptions() :
+      speed(1.0),
+      camera_copies(1),
+      loss(0.0),
+      reorder(0.0),
+      seed(1),
+      stress_max_speed(0.0),
+      stress_level_duration(20000000),
+      stall_period(500000) {}
+
+  // Filter of the records to play back.
+  StreamFilter filter;
+
+  // Time compression factor of the playback.
+  double speed;
+
+  // Number of copies of each camera to publish. Copy k of a camera is
+  // published with its camera_id offset by k * kCameraIdStride.
+  int camera_copies;
+
+  // Probability of dropping each vision datagram.
+  double loss;
+
+  // Probability of delaying each vision datagram till after the next one.
+  double reorder;
+
+  // Seed for the random packet loss and reordering.
+  long seed;
+
+  // If non-zero, the speed is doubled every stress_level_duration, until
+  // it exceeds stress_max_speed.
+  double stress_max_speed;
+
+  // Wall-clock duration of each stress level, in microseconds.
+  uint64_t stress_level_duration;
+
+  // Longest interval between two autoref messages, in microseconds, before
+  // the autoref is considered to have stalled.
+  uint64_t stall_period;
+};
+
+// Statistics of the messages received from an autoref over a period of time.
+struct AutorefStats {
+  AutorefStats() : messages(0), max_interval(0), counter_gaps(0) {}
+
+  // Number of referee messages received.
+  uint64_t messages;
+
+  // Longest interval without messages, in microseconds.
+  uint64_t max_interval;
+
+  // Number of times the command counter skipped one or more values.
+  int counter_gaps;
+};
+
+// Statistics of one level of a stress test.
+struct StressLevelReport {
+  StressLevelReport() : speed(0.0), vision_rate(0.0), degraded(false) {}
+
+  // Time compression factor of the level.
+  double speed;
+
+  // Vision datagrams published per second.
+  double vision_rate;
+
+  // Statistics of each monitored autoref.
+  vector<AutorefStats> autorefs;
+
+  // Indicates if any autoref stalled or skipped commands.
+  bool degraded;
+};
+
+// Returns true iff the command is a STOP or event command, which an autoref
+// command answers if the human referee issued the same.
+bool IsAnswerable(int command) {
+  switch (command) {
+    case SSL_Referee_Command_STOP:
+    case SSL_Referee_Command_DIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_DIRECT_FREE_BLUE:
+    case SSL_Referee_Command_INDIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_INDIRECT_FREE_BLUE:
+    case SSL_Referee_Command_GOAL_YELLOW:
+    case SSL_Referee_Command_GOAL_BLUE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Class to listen to the referee messages of an autoref while the log is
+// being played back, and measure the latency from the vision packet that
+// triggered each new STOP or event command of the autoref to the reception of
+// that command. The autoref does not report which vision frame it acted on,
+// so the command is matched to the same command of the human referee in the
+// log, played back nearest to it within kMaxAnswerDelay, and the triggering
+// frame is the last one published before that human referee command. The
+// latency is hence negative for commands ahead of the human referee.
+class AutorefMonitor {
+ public:
+  // Disable default constructor, and copy constructor.
+  AutorefMonitor();
+  AutorefMonitor(const AutorefMonitor&);
+
+  // Main constructor, that accepts the port number the autoref publishes its
+  // referee messages to.
+  explicit AutorefMonitor(int port_number) :
+      port_number_(port_number),
+      num_unanswered_(0),
+      t_last_receive_(0),
+      t_stats_start_(0) {
+    printf("Monitoring autoref %s:%d\n", kRefereeMulticast, port_number_);
+    pthread_create(&monitor_thread_,
+                   NULL,
+                   AutorefMonitor::MonitorThread,
+                   reinterpret_cast<void*>(this));
+  }
+
+  // Waits for the monitor thread to terminate, which it will do within
+  // kPollPeriod of run_ being cleared.
+  void Join() {
+    pthread_join(monitor_thread_, NULL);
+  }
+
+  int port_number() const { return port_number_; }
+
+  // Print the latency percentiles of every command type received, in
+  // microseconds. Should only be called after Join().
+  void PrintLatencies() const {
+    printf("Autoref %d latencies (us), %" PRIu64 " commands answering no "
+           "human referee command:\n",
+           port_number_,
+           num_unanswered_ + pending_.size());
+    Histogram all_commands;
+    for (map<int, Histogram>::const_iterator it = latencies_.begin();
+         it != latencies_.end(); ++it) {
+      const string name = SSL_Referee_Command_Name(
+          static_cast<SSL_Referee_Command>(it->first));
+      it->second.Print(stdout, name.c_str());
+      all_commands.Merge(it->second);
+    }
+    all_commands.Print(stdout, "ALL");
+  }
+
+  // Match a command of the human referee that was just played back to the
+  // oldest command of the same type that the autoref sent before it, within
+  // its window. Commands sent earlier cannot be answered anymore. Should be
+  // called with monitor_mutex_ locked.
+  void AnswerHumanCommand(HumanCommand* human) {
+    while (!pending_.empty() &&
+           pending_.front().t_receive + human->window < human->t_played) {
+      ++num_unanswered_;
+      pending_.pop_front();
+    }
+    for (deque<PendingCommand>::iterator it = pending_.begin();
+         it != pending_.end(); ++it) {
+      if (it->command != human->command) continue;
+      AddLatency(*it, human);
+      pending_.erase(it);
+      return;
+    }
+  }
+
+  // Returns the statistics of the messages received since the last call, and
+  // resets them. The interval from the last message received to t_now counts
+  // towards the longest interval.
+  AutorefStats EndStats(uint64_t t_now) {
+    ScopedLock lock(monitor_mutex_);
+    AutorefStats stats = stats_;
+    const uint64_t t_last = max(t_last_receive_, t_stats_start_);
+    if (t_last > 0 && t_now > t_last) {
+      stats.max_interval = max(stats.max_interval, t_now - t_last);
+    }
+    stats_ = AutorefStats();
+    t_stats_start_ = t_now;
+    return stats;
+  }
+
+ private:
+  // A new STOP or event command received from the autoref.
+  struct PendingCommand {
+    int command;
+    uint32_t counter;
+    uint64_t t_receive;
+  };
+
+  // Add the latency of an autoref command answering a human referee command.
+  // Should be called with monitor_mutex_ locked.
+  void AddLatency(const PendingCommand& command, HumanCommand* human) {
+    const int64_t latency = static_cast<int64_t>(command.t_receive) -
+        static_cast<int64_t>(human->t_frame);
+    latencies_[command.command].Add(latency);
+    human->answered_by.push_back(this);
+    if (kDebugLatency) {
+      printf("Autoref %d: %4d %s latency %" PRId64 " us\n",
+             port_number_,
+             command.counter,
+             SSL_Referee_Command_Name(
+                 static_cast<SSL_Referee_Command>(command.command)).c_str(),
+             latency);
+    }
+  }
+
+  // Match a new command of the autoref to the latest command of the same
+  // type that the human referee was played back with, within its window, and
+  // that no other command of the autoref answered, or keep it pending until
+  // the human referee issues it. Should be called with monitor_mutex_ locked.
+  void AnswerAutorefCommand(const PendingCommand& command) {
+    for (deque<HumanCommand>::reverse_iterator it = human_commands_.rbegin();
+         it != human_commands_.rend(); ++it) {
+      if (it->command != command.command ||
+          command.t_receive > it->t_played + it->window ||
+          std::find(it->answered_by.begin(), it->answered_by.end(), this) !=
+              it->answered_by.end()) {
+        continue;
+      }
+      AddLatency(command, &(*it));
+      return;
+    }
+    pending_.push_back(command);
+  }
+
+  static void* MonitorThread(void* monitor_ptr) {
+    // Time to wait for a packet before checking for termination, in ms.
+    static const int kPollPeriod = 100;
+    AutorefMonitor& monitor =
+        *(reinterpret_cast<AutorefMonitor*>(monitor_ptr));
+    TRACE_THREAD_NAME(StringPrintf("monitor %d", monitor.port_number_));
+    Net::UDP client;
+    Net::Address multiaddr, interface;
+    multiaddr.setHost(kRefereeMulticast, monitor.port_number_);
+    interface.setAny();
+    if (!client.open(monitor.port_number_, true, true, false)) {
+      fprintf(stderr,
+              "Unable to open UDP network port %d\n",
+              monitor.port_number_);
+      return NULL;
+    }
+    if (!client.addMulticast(multiaddr, interface)) {
+      fprintf(stderr,
+              "Unable to set up UDP multicast for %s:%d\n",
+              kRefereeMulticast,
+              monitor.port_number_);
+      perror("UDP Error");
+      return NULL;
+    }
+
+    Net::Address src;
+    char* receive_buffer = new char[kMaxDatagramSize];
+    RefereeView referee_message;
+    bool have_counter = false;
+    uint32_t last_counter = 0;
+    while (run_) {
+      if (!client.wait(kPollPeriod)) continue;
+      TRACE_SCOPE("recv");
+      const int bytes_received =
+          client.recv(receive_buffer, kMaxDatagramSize, src);
+      const uint64_t t_receive = GetTimeUSec();
+      if (bytes_received <= 0 ||
+          !DecodeReferee(receive_buffer, bytes_received, &referee_message)) {
+        continue;
+      }
+      // The autoref repeats its last command until it issues a new one, so
+      // only changes of the command counter are new commands. The first
+      // message received only establishes the initial counter.
+      const uint32_t counter = referee_message.command_counter;
+      const bool new_command = have_counter && (counter != last_counter);
+
+      ScopedLock lock(monitor_mutex_);
+      ++monitor.stats_.messages;
+      const uint64_t t_last =
+          max(monitor.t_last_receive_, monitor.t_stats_start_);
+      if (t_last > 0 && t_receive > t_last) {
+        monitor.stats_.max_interval =
+            max(monitor.stats_.max_interval, t_receive - t_last);
+      }
+      monitor.t_last_receive_ = t_receive;
+      if (have_counter && counter > last_counter + 1) {
+        ++monitor.stats_.counter_gaps;
+      }
+      have_counter = true;
+      last_counter = counter;
+      if (!new_command || !IsAnswerable(referee_message.command)) continue;
+      PendingCommand command;
+      command.command = referee_message.command;
+      command.counter = counter;
+      command.t_receive = t_receive;
+      monitor.AnswerAutorefCommand(command);
+    }
+    delete[] receive_buffer;
+    return NULL;
   }
-  char* read_buffer = new char[packet_size];
-  const bool success = (fread(read_buffer, 1, packet_size, fid) == packet_size);
-  if (success) {
-    message->ParseFromArray(read_buffer, packet_size);
+
+  // Print the latency of every command matched.
+  static const bool kDebugLatency = false;
+
+  pthread_t monitor_thread_;
+  const int port_number_;
+
+  // Latency histograms in microseconds, indexed by SSL_Referee_Command.
+  // Protected by monitor_mutex_.
+  map<int, Histogram> latencies_;
+
+  // Commands received that the human referee has not issued yet, in order of
+  // reception, and the number of commands that no human referee command
+  // answered within their window. Protected by monitor_mutex_.
+  deque<PendingCommand> pending_;
+  uint64_t num_unanswered_;
+
+  // Statistics since the last call to EndStats(). Protected by
+  // monitor_mutex_.
+  AutorefStats stats_;
+
+  // Wall-clock time of the last message received, and of the last call to
+  // EndStats(). Protected by monitor_mutex_.
+  uint64_t t_last_receive_;
+  uint64_t t_stats_start_;
+};
+
+// Publish the vision datagram held back for reordering, if there is one.
+void PublishHeldDatagram() {
+  if (held_datagram_.empty()) return;
+  publisher_.PublishDatagram(
+      held_datagram_.data(), held_datagram_.size(), held_address_, held_port_);
+  ++vision_packets_sent_;
+  held_datagram_.clear();
+}
+
+// Publish a vision message, duplicating cameras and dropping or reordering
+// datagrams as specified by the options.
+void PublishVisionMessage(const EnvelopeView& message,
+                          const PlaybackOptions& options) {
+  // Reused for every message, so that they do not allocate memory once the
+  // largest packets have been seen.
+  static SSL_WrapperPacket wrapper;
+  static string datagram;
+  if (options.camera_copies <= 1 &&
+      options.loss <= 0.0 &&
+      options.reorder <= 0.0) {
+    publisher_.Publish(message);
+    ++vision_packets_sent_;
+    return;
+  }
+  const string address = message.Address();
+  if (options.camera_copies > 1) {
+    wrapper.ParseFromArray(message.data, message.data_size);
+    // Copies only carry the detection, there is no geometry for the
+    // duplicated cameras.
+    wrapper.clear_geometry();
   } else {
-    fprintf(stderr, "Error reading packet data of size %d", packet_size);
-    perror("");
+    wrapper.Clear();
+  }
+  const int copies = wrapper.has_detection() ? options.camera_copies : 1;
+  const uint32_t camera_id = wrapper.detection().camera_id();
+  for (int k = 0; k < copies; ++k) {
+    if (k == 0) {
+      datagram.assign(message.data, message.data_size);
+    } else {
+      wrapper.mutable_detection()->set_camera_id(
+          camera_id + k * kCameraIdStride);
+      wrapper.SerializeToString(&datagram);
+    }
+    if (drand48() < options.loss) continue;
+    if (held_datagram_.empty() && drand48() < options.reorder) {
+      held_datagram_.swap(datagram);
+      held_address_ = address;
+      held_port_ = message.port;
+      continue;
+    }
+    publisher_.PublishDatagram(
+        datagram.data(), datagram.size(), address, message.port);
+    ++vision_packets_sent_;
+    PublishHeldDatagram();
   }
-  delete[] read_buffer;
-  return success;
 }
 
-void PublishMessage(const UDPMessageWrapper& message) {
-  Net::Address address;
-  address.setHost(message.address().c_str(), message.port());
-  const string& message_data = message.data();
-  if (!publisher_.send(message_data.data(),
-      message_data.size(),
-      address)) {
-    perror("Sendto Error");
-    fprintf(stderr,
-            "Sending UDP datagram to %s:%d failed (maybe too large?). "
-            "Size was: %zu byte(s)\n",
-            message.address().c_str(),
-            message.port(),
-            message_data.size());
+// Record a new command of the human referee as it is played back, if it is a
+// STOP or event command, and match it to the commands of the monitored
+// autorefs received before it.
+void PlayHumanCommand(int command,
+                      double speed,
+                      const vector<AutorefMonitor*>& monitors) {
+  if (!IsAnswerable(command)) return;
+  const uint64_t t_now = GetTimeUSec();
+  ScopedLock lock(monitor_mutex_);
+  if (t_last_vision_publish_ == 0) return;
+  // Forget the commands that can no longer be answered.
+  while (!human_commands_.empty() &&
+         human_commands_.front().t_played + human_commands_.front().window <
+             t_now) {
+    human_commands_.pop_front();
+  }
+  human_commands_.push_back(HumanCommand());
+  HumanCommand& human = human_commands_.back();
+  human.command = command;
+  human.t_played = t_now;
+  human.t_frame = t_last_vision_publish_;
+  human.window = static_cast<uint64_t>(kMaxAnswerDelay / speed);
+  for (size_t i = 0; i < monitors.size(); ++i) {
+    monitors[i]->AnswerHumanCommand(&human);
+  }
+}
+
+// Returns true iff the message was sent to the referee port of one of the
+// monitored autorefs, and should hence not be played back.
+bool IsMonitored(const EnvelopeView& message,
+                 const vector<AutorefMonitor*>& monitors) {
+  if (!message.AddressIs(kRefereeMulticast)) return false;
+  for (size_t i = 0; i < monitors.size(); ++i) {
+    if (monitors[i]->port_number() == message.port) return true;
+  }
+  return false;
+}
+
+// Ends the current level of a stress test, and collects its statistics.
+StressLevelReport EndStressLevel(double speed,
+                                 uint64_t t_level_start,
+                                 uint64_t vision_packets_start,
+                                 const vector<AutorefMonitor*>& monitors,
+                                 const PlaybackOptions& options) {
+  const uint64_t t_now = GetTimeUSec();
+  StressLevelReport report;
+  report.speed = speed;
+  report.vision_rate =
+      1e6 * static_cast<double>(vision_packets_sent_ - vision_packets_start) /
+      static_cast<double>(max<uint64_t>(1, t_now - t_level_start));
+  for (size_t i = 0; i < monitors.size(); ++i) {
+    const AutorefStats stats = monitors[i]->EndStats(t_now);
+    report.autorefs.push_back(stats);
+    if (stats.messages == 0 ||
+        stats.max_interval > options.stall_period ||
+        stats.counter_gaps > 0) {
+      report.degraded = true;
+    }
   }
+  return report;
 }
 
-void PlayLogFile(const string& log_file) {
+void PrintStressReport(const vector<StressLevelReport>& reports,
+                       const vector<AutorefMonitor*>& monitors,
+                       const PlaybackOptions& options) {
+  printf("Stress test with %d camera copies, %.1f%% loss, %.1f%% reorder:\n",
+         options.camera_copies,
+         100.0 * options.loss,
+         100.0 * options.reorder);
+  printf(" Speed  Vision/s  Autoref  Messages  Max interval (ms)  Gaps\n");
+  int highest_sustained = -1;
+  for (size_t i = 0; i < reports.size(); ++i) {
+    const StressLevelReport& report = reports[i];
+    for (size_t j = 0; j < monitors.size(); ++j) {
+      const AutorefStats& stats = report.autorefs[j];
+      printf("%6.2f  %8.1f  %7d  %8" PRIu64 "  %17.1f  %4d%s\n",
+             report.speed,
+             report.vision_rate,
+             monitors[j]->port_number(),
+             stats.messages,
+             1e-3 * static_cast<double>(stats.max_interval),
+             stats.counter_gaps,
+             report.degraded ? "  DEGRADED" : "");
+    }
+    if (report.degraded) break;
+    highest_sustained = i;
+  }
+  if (highest_sustained < 0) {
+    printf("Degraded at the lowest load.\n");
+  } else {
+    printf("Highest sustained load: speed %.2f, %.1f vision datagrams/s\n",
+           reports[highest_sustained].speed,
+           reports[highest_sustained].vision_rate);
+  }
+}
+
+void PlayLogFile(const string& log_file,
+                 const vector<AutorefMonitor*>& monitors,
+                 const PlaybackOptions& options) {
   static const bool kDebug = false;
   printf("Playing log file %s\n", log_file.c_str());
-  ScopedFile fid(log_file.c_str(), "r");
-  if (fid() == NULL) {
+  LogReader reader;
+  if (!reader.Open(log_file)) {
     perror("Error opening file");
     exit(1);
   }
   // Set up UDP publisher.
-  if (!publisher_.open()) {
+  if (!publisher_.Open()) {
     return;
   }
+  srand48(options.seed);
+
+  const bool stress_test = (options.stress_max_speed > 0.0);
+  vector<StressLevelReport> stress_reports;
+  double speed = options.speed;
+  uint64_t t_level_start = GetTimeUSec();
+  uint64_t vision_packets_level_start = vision_packets_sent_;
+  if (stress_test) {
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      monitors[i]->EndStats(t_level_start);
+    }
+  }
 
-  UDPMessageWrapper message;
+  EnvelopeView message;
   uint64_t t_last_publish = 0;
   uint64_t t_last_log = 0;
-  while (ReadUDPMessageWrapper(fid(), &message)) {
-    printf("\r%f ", 1e-6 * static_cast<double>(message.timestamp()));
+  // Number of messages published since the log was last (re)started.
+  int messages_published = 0;
+  // Number of messages not played back because of the filter.
+  uint64_t messages_filtered = 0;
+  // Last command counter of the human referee, to find its new commands.
+  RefereeView human_message;
+  bool have_human_counter = false;
+  uint32_t human_counter = 0;
+  while (true) {
+    if (!reader.ReadRecord()) {
+      // Stress tests loop over the log until the maximum speed is reached.
+      // The datagram held back at the end of a pass is published last.
+      PublishHeldDatagram();
+      if (!stress_test) break;
+      if (messages_published == 0) {
+        fprintf(stderr,
+                "\nError: no messages of the log were played back, ending "
+                "the stress test\n");
+        break;
+      }
+      reader.Rewind();
+      messages_published = 0;
+      t_last_log = 0;
+      t_last_publish = 0;
+      continue;
+    }
+    if (!DecodeEnvelope(reader.record(), reader.record_size(), &message)) {
+      fprintf(stderr, "Skipping malformed record\n");
+      continue;
+    }
+    if (IsMonitored(message, monitors)) continue;
+    const bool is_vision = (message.AddressIs(kVisionMulticast) &&
+                            message.port == kVisionPort);
+    if (!options.filter.Accepts(message, is_vision)) {
+      ++messages_filtered;
+      continue;
+    }
+    printf("\r%f ", 1e-6 * static_cast<double>(message.timestamp));
     fflush(stdout);
     if (kDebug) {
       printf("Publishing %d bytes to %s:%d\n",
-             static_cast<int>(message.data().size()),
-             message.address().c_str(),
-             message.port());
+             static_cast<int>(message.data_size),
+             message.Address().c_str(),
+             message.port);
     }
     // Wait till it is time to publish the next message.
-    const int64_t delta_t_log  =
-        (t_last_log > 0) ? (message.timestamp() - t_last_log) : 0;
+    const int64_t delta_t_log  = (t_last_log > 0) ?
+        static_cast<int64_t>(message.timestamp - t_last_log) / speed : 0;
     const int64_t delta_t_publisher =
         (t_last_publish > 0) ? (GetTimeUSec() - t_last_publish) : 0;
     const int64_t t_wait = max<int64_t>(0, delta_t_log - delta_t_publisher);
-    usleep(t_wait);
+    TRACE_COUNTER("late_us",
+                  max<int64_t>(0, delta_t_publisher - delta_t_log));
+    {
+      TRACE_SCOPE("wait");
+      usleep(t_wait);
+    }
 
-    PublishMessage(message);
+    if (is_vision) {
+      PublishVisionMessage(message, options);
+    } else {
+      publisher_.Publish(message);
+    }
+    ++messages_published;
     t_last_publish = GetTimeUSec();
-    t_last_log = message.timestamp();
+    t_last_log = message.timestamp;
+    if (is_vision) {
+      ScopedLock lock(monitor_mutex_);
+      t_last_vision_publish_ = t_last_publish;
+    } else if (!monitors.empty() &&
+               message.port == kRefboxPort &&
+               message.AddressIs(kRefereeMulticast) &&
+               DecodeReferee(
+                   message.data, message.data_size, &human_message)) {
+      // As for the autorefs, only changes of the command counter are new
+      // commands of the human referee.
+      if (have_human_counter &&
+          human_message.command_counter != human_counter) {
+        PlayHumanCommand(human_message.command, speed, monitors);
+      }
+      have_human_counter = true;
+      human_counter = human_message.command_counter;
+    }
+
+    if (stress_test &&
+        t_last_publish > t_level_start + options.stress_level_duration) {
+      PublishHeldDatagram();
+      stress_reports.push_back(EndStressLevel(
+          speed, t_level_start, vision_packets_level_start, monitors, options));
+      printf("\nSpeed %.2f: %.1f vision datagrams/s%s\n",
+             speed,
+             stress_reports.back().vision_rate,
+             stress_reports.back().degraded ? ", autoref degraded" : "");
+      if (stress_reports.back().degraded) break;
+      speed *= 2.0;
+      if (speed > options.stress_max_speed) break;
+      t_level_start = GetTimeUSec();
+      vision_packets_level_start = vision_packets_sent_;
+    }
   }
   printf("\n");
+  if (messages_filtered > 0) {
+    printf("%" PRIu64 " messages filtered out\n", messages_filtered);
+  }
+  if (stress_test) {
+    PrintStressReport(stress_reports, monitors, options);
+  }
 }
 
 void PrintUsage() {
-  printf("Usage: playback log_file.log\n");
+  printf("Usage: playback [options] log_file.log\n"
+         "Options:\n"
+         "  -t [addr][:offset]   Play back to addr instead of the original\n"
+         "                       addresses, with ports offset by offset.\n"
+         "                       Repeat to play back to several targets\n"
+         "                       at once.\n"
+         "  -l port1[,port2...]  Monitor the autorefs publishing to %s on\n"
+         "                       the listed ports instead of playing back\n"
+         "                       their logged messages, and report the\n"
+         "                       latencies of their STOP and event commands\n"
+         "                       from the vision frame before the same\n"
+         "                       command of the human referee.\n"
+         "  -include [addr][:port]  Only play back the matching streams.\n"
+         "                       Repeat to include several streams.\n"
+         "  -exclude [addr][:port]  Do not play back the matching streams.\n"
+         "  -camera id[,id...]   Only play back these vision cameras.\n"
+         "  -xcamera id[,id...]  Do not play back these vision cameras.\n"
+         "  -remap [addr][:port]=[addr][:port]\n"
+         "                       Play back the matching streams to another\n"
+         "                       address and/or port.\n"
+         "  -speed factor        Time compression factor of the playback.\n"
+         "  -cameras copies      Publish copies of every camera, with\n"
+         "                       camera_id offset by multiples of %d.\n"
+         "  -loss probability    Randomly drop vision datagrams.\n"
+         "  -reorder probability Randomly swap vision datagrams.\n"
+         "  -seed seed           Seed for random loss and reordering.\n"
+         "  -stress max_speed    Double the speed every stress level until\n"
+         "                       max_speed or until a monitored autoref\n"
+         "                       stalls or skips commands, looping the log.\n"
+         "  -level seconds       Duration of each stress level.\n"
+         "  -stall milliseconds  Longest interval between autoref messages\n"
+         "                       before the autoref is considered stalled.\n"
+         "  -trace file          Write a Chrome trace of the stages of the\n"
+         "                       playback to file, and print the time spent\n"
+         "                       in every stage. Requires a build with\n"
+         "                       -DENABLE_TRACING=ON.\n",
+         kRefereeMulticast,
+         kCameraIdStride);
+}
+
+// Parse a target of the form "[address][:port_offset]".
+bool ParseTarget(const char* arg, PlaybackTarget* target) {
+  const char* split = strrchr(arg, ':');
+  if (split == NULL) {
+    target->address = arg;
+    target->port_offset = 0;
+  } else {
+    char* end = NULL;
+    target->address.assign(arg, split - arg);
+    target->port_offset = strtol(split + 1, &end, 10);
+    if (end == split + 1 || *end != '\0') return false;
+  }
+  if (target->address.empty()) return (split != NULL);
+  Net::Address address;
+  return address.setHost(target->address.c_str(), 0);
+}
+
+// Parse a stream pattern of the form "[address][:port]".
+bool ParseStreamPattern(const string& arg, StreamPattern* pattern) {
+  const size_t split = arg.rfind(':');
+  pattern->address = arg.substr(0, split);
+  pattern->port = 0;
+  if (split != string::npos) {
+    char* end = NULL;
+    pattern->port = strtol(arg.c_str() + split + 1, &end, 10);
+    if (*end != '\0' || pattern->port <= 0 || pattern->port > 65535) {
+      return false;
+    }
+  }
+  return (!pattern->address.empty() || pattern->port != 0);
+}
+
+// Parse a remap rule of the form "[address][:port]=[address][:port]".
+bool ParseRemapRule(const string& arg, RemapRule* remap) {
+  const size_t split = arg.find('=');
+  return (split != string::npos &&
+          ParseStreamPattern(arg.substr(0, split), &remap->from) &&
+          ParseStreamPattern(arg.substr(split + 1), &remap->to));
+}
+
+// Parse a comma-separated list of camera ids.
+bool ParseCameraList(const char* arg, vector<uint32_t>* cameras) {
+  while (*arg != '\0') {
+    char* end = NULL;
+    const long camera_id = strtol(arg, &end, 10);
+    if (end == arg || camera_id < 0) return false;
+    cameras->push_back(static_cast<uint32_t>(camera_id));
+    if (*end == ',') ++end;
+    arg = end;
+  }
+  return true;
+}
+
+// Parse a comma-separated list of port numbers.
+bool ParsePortList(const char* arg, vector<int>* ports) {
+  while (*arg != '\0') {
+    char* end = NULL;
+    const long port = strtol(arg, &end, 10);
+    if (end == arg || port <= 0 || port > 65535) return false;
+    ports->push_back(static_cast<int>(port));
+    if (*end == ',') ++end;
+    arg = end;
+  }
+  return true;
 }
 
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
+  // Time to keep listening to the autorefs after the end of the log, in us.
+  static const uint64_t kMonitorDrainPeriod = 1000000;
+  string log_file;
+  vector<int> monitor_ports;
+  PlaybackOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = (i + 1 < argc);
+    if (strcmp(argv[i], "-l") == 0 && has_value) {
+      ++i;
+      if (!ParsePortList(argv[i], &monitor_ports)) {
+        fprintf(stderr, "Invalid port list \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+      ++i;
+      PlaybackTarget target;
+      if (!ParseTarget(argv[i], &target)) {
+        fprintf(stderr, "Invalid target \"%s\"\n", argv[i]);
+        return 1;
+      }
+      publisher_.AddTarget(target);
+    } else if ((strcmp(argv[i], "-include") == 0 ||
+                strcmp(argv[i], "-exclude") == 0) && has_value) {
+      StreamPattern pattern;
+      if (!ParseStreamPattern(argv[i + 1], &pattern)) {
+        fprintf(stderr, "Invalid stream \"%s\"\n", argv[i + 1]);
+        return 1;
+      }
+      if (strcmp(argv[i], "-include") == 0) {
+        options.filter.include.push_back(pattern);
+      } else {
+        options.filter.exclude.push_back(pattern);
+      }
+      ++i;
+    } else if ((strcmp(argv[i], "-camera") == 0 ||
+                strcmp(argv[i], "-xcamera") == 0) && has_value) {
+      vector<uint32_t>* cameras = (strcmp(argv[i], "-camera") == 0) ?
+          &options.filter.include_cameras : &options.filter.exclude_cameras;
+      ++i;
+      if (!ParseCameraList(argv[i], cameras)) {
+        fprintf(stderr, "Invalid camera list \"%s\"\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-remap") == 0 && has_value) {
+      ++i;
+      RemapRule remap;
+      if (!ParseRemapRule(argv[i], &remap)) {
+        fprintf(stderr, "Invalid remap rule \"%s\"\n", argv[i]);
+        return 1;
+      }
+      publisher_.AddRemap(remap);
+    } else if (strcmp(argv[i], "-speed") == 0 && has_value) {
+      options.speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-cameras") == 0 && has_value) {
+      options.camera_copies = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-loss") == 0 && has_value) {
+      options.loss = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-reorder") == 0 && has_value) {
+      options.reorder = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-seed") == 0 && has_value) {
+      options.seed = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-stress") == 0 && has_value) {
+      options.stress_max_speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-level") == 0 && has_value) {
+      options.stress_level_duration = llround(1e6 * atof(argv[++i]));
+    } else if (strcmp(argv[i], "-stall") == 0 && has_value) {
+      options.stall_period = 1e3 * atof(argv[++i]);
+    } else if (strcmp(argv[i], "-trace") == 0 && has_value) {
+      if (!StartTracing(argv[++i])) return 1;
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      log_file = argv[i];
+    }
+  }
+  if (log_file.empty() || options.speed <= 0.0) {
     PrintUsage();
     return 1;
   }
-  PlayLogFile(argv[1]);
-  return 0;
+  if (options.stress_max_speed > 0.0 && monitor_ports.empty()) {
+    fprintf(stderr, "Stress tests require autorefs to monitor (-l).\n");
+    return 1;
+  }
+
+  if (publisher_.num_targets() == 0) {
+    // Play back to the original addresses.
+    publisher_.AddTarget(PlaybackTarget());
+  }
+
+  vector<AutorefMonitor*> monitors;
+  for (size_t i = 0; i < monitor_ports.size(); ++i) {
+    monitors.push_back(new AutorefMonitor(monitor_ports[i]));
+  }
+  PlayLogFile(log_file, monitors, options);
+  if (!monitors.empty()) {
+    usleep(kMonitorDrainPeriod);
+    run_ = false;
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      monitors[i]->Join();
+      monitors[i]->PrintLatencies();
+      delete monitors[i];
+    }
+  }
+  return (StopTracing() ? 0 : 1);
 }
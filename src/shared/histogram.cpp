@@ -0,0 +1,155 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Log-linear histogram of signed integer samples, e.g. time deltas in
+// microseconds.
+
+#include "histogram.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+using std::max;
+using std::min;
+using std::vector;
+
+Histogram::Histogram() : count_(0), min_(0), max_(0), sum_(0.0) {}
+
+int Histogram::BucketIndex(uint64_t magnitude) {
+  static const int kExactLimit = (1 << kPrecisionBits);
+  static const int kSubBuckets = (1 << (kPrecisionBits - 1));
+  if (magnitude < static_cast<uint64_t>(kExactLimit)) {
+    return static_cast<int>(magnitude);
+  }
+  const int msb = 63 - __builtin_clzll(magnitude);
+  const int shift = msb - (kPrecisionBits - 1);
+  const int top = static_cast<int>(magnitude >> shift);
+  return (kExactLimit + (shift - 1) * kSubBuckets + (top - kSubBuckets));
+}
+
+uint64_t Histogram::BucketValue(int index) {
+  static const int kExactLimit = (1 << kPrecisionBits);
+  static const int kSubBuckets = (1 << (kPrecisionBits - 1));
+  if (index < kExactLimit) return static_cast<uint64_t>(index);
+  const int shift = (index - kExactLimit) / kSubBuckets + 1;
+  const uint64_t top = kSubBuckets + (index - kExactLimit) % kSubBuckets;
+  return (top << shift);
+}
+
+void Histogram::Add(int64_t value) {
+  // Magnitude of the value, computed without overflowing on INT64_MIN.
+  const uint64_t magnitude = (value < 0) ?
+      (~static_cast<uint64_t>(value) + 1) : static_cast<uint64_t>(value);
+  vector<uint64_t>& buckets = (value < 0) ? negative_ : positive_;
+  const int index = BucketIndex(magnitude);
+  if (index >= static_cast<int>(buckets.size())) buckets.resize(index + 1, 0);
+  ++buckets[index];
+  if (count_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = min(min_, value);
+    max_ = max(max_, value);
+  }
+  ++count_;
+  sum_ += static_cast<double>(value);
+}
+
+void Histogram::Merge(const Histogram& other) {
+  if (other.count_ == 0) return;
+  if (positive_.size() < other.positive_.size()) {
+    positive_.resize(other.positive_.size(), 0);
+  }
+  if (negative_.size() < other.negative_.size()) {
+    negative_.resize(other.negative_.size(), 0);
+  }
+  for (size_t i = 0; i < other.positive_.size(); ++i) {
+    positive_[i] += other.positive_[i];
+  }
+  for (size_t i = 0; i < other.negative_.size(); ++i) {
+    negative_[i] += other.negative_[i];
+  }
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = min(min_, other.min_);
+    max_ = max(max_, other.max_);
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+void Histogram::Clear() {
+  positive_.clear();
+  negative_.clear();
+  count_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0.0;
+}
+
+double Histogram::Mean() const {
+  if (count_ == 0) return 0.0;
+  return (sum_ / static_cast<double>(count_));
+}
+
+int64_t Histogram::Percentile(double p) const {
+  if (count_ == 0) return 0;
+  // Rank of the requested sample, in [1, count_].
+  uint64_t rank = static_cast<uint64_t>(
+      ceil(p / 100.0 * static_cast<double>(count_)));
+  rank = max<uint64_t>(1, min(rank, count_));
+  uint64_t seen = 0;
+  int64_t value = max_;
+  bool found = false;
+  // Negative samples, from the most negative to the least negative.
+  for (int i = static_cast<int>(negative_.size()) - 1; i >= 0 && !found; --i) {
+    seen += negative_[i];
+    if (seen >= rank) {
+      value = -static_cast<int64_t>(BucketValue(i));
+      found = true;
+    }
+  }
+  for (size_t i = 0; i < positive_.size() && !found; ++i) {
+    seen += positive_[i];
+    if (seen >= rank) {
+      value = static_cast<int64_t>(BucketValue(i));
+      found = true;
+    }
+  }
+  return max(min_, min(max_, value));
+}
+
+void Histogram::Print(FILE* out, const char* label) const {
+  fprintf(out,
+          "%-24s n=%-7" PRIu64 " min=%-9" PRId64 " p50=%-9" PRId64
+          " p95=%-9" PRId64 " p99=%-9" PRId64 " max=%" PRId64 "\n",
+          label,
+          count_,
+          Min(),
+          Percentile(50.0),
+          Percentile(95.0),
+          Percentile(99.0),
+          Max());
+}
@@ -0,0 +1,87 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Log-linear histogram of signed integer samples, e.g. time deltas in
+// microseconds.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+// Histogram of signed 64-bit samples. Magnitudes below 2^kPrecisionBits are
+// stored exactly, larger magnitudes are stored with kPrecisionBits - 1
+// significant bits, i.e. with a relative error below 1%. The memory used is
+// proportional to the logarithm of the largest magnitude added, and two
+// histograms can be merged by adding up their bucket counts.
+class Histogram {
+ public:
+  Histogram();
+
+  // Add a single sample.
+  void Add(int64_t value);
+
+  // Add all the samples of another histogram to this one.
+  void Merge(const Histogram& other);
+
+  // Remove all samples.
+  void Clear();
+
+  // Number of samples added.
+  uint64_t Count() const { return count_; }
+
+  // Smallest and largest samples added, exact. Zero if empty.
+  int64_t Min() const { return (count_ > 0) ? min_ : 0; }
+  int64_t Max() const { return (count_ > 0) ? max_ : 0; }
+
+  // Mean of the samples added, exact. Zero if empty.
+  double Mean() const;
+
+  // Returns the sample at percentile p, for p in [0, 100], rounded towards
+  // zero to the resolution of its bucket and clamped to [Min(), Max()]. Zero
+  // if empty.
+  int64_t Percentile(double p) const;
+
+  // Print count, min, p50, p95, p99 and max on a single line.
+  void Print(FILE* out, const char* label) const;
+
+ private:
+  static const int kPrecisionBits = 8;
+
+  // Returns the bucket index of a sample magnitude.
+  static int BucketIndex(uint64_t magnitude);
+
+  // Returns the smallest magnitude that falls into a bucket.
+  static uint64_t BucketValue(int index);
+
+  // Bucket counts for samples >= 0, indexed by magnitude.
+  std::vector<uint64_t> positive_;
+
+  // Bucket counts for samples < 0, indexed by magnitude.
+  std::vector<uint64_t> negative_;
+
+  uint64_t count_;
+  int64_t min_;
+  int64_t max_;
+  double sum_;
+};
+
+#endif  // HISTOGRAM_H_
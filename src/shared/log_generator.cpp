@@ -0,0 +1,754 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Generator of synthetic game logs.
+
+#include "log_generator.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "log_writer.h"
+#include "messages_robocup_ssl_wrapper.pb.h"
+#include "misc_util.h"
+#include "referee.pb.h"
+
+using std::max;
+using std::min;
+using std::string;
+using std::vector;
+
+// UDP Multicast address for referees.
+static const char* kRefereeMulticast = "224.5.23.1";
+
+// UDP Multicast address for SSL Vision.
+static const char* kVisionMulticast = "224.5.23.2";
+
+// Port number for SSL Vision.
+static const int kVisionPort = 10006;
+
+// Port number for main refbox.
+static const int kRefboxPort = 10003;
+
+// Maximum duration of a step of the simulation of the world, in seconds.
+static const double kMaxStep = 0.01;
+
+// Maximum speed of the robots, in mm/s.
+static const double kRobotSpeed = 2000.0;
+
+// Deceleration of the rolling ball, in mm/s^2.
+static const double kBallDeceleration = 400.0;
+
+// Distance from a robot to the ball at which the robot can kick it, in mm.
+static const double kKickDistance = 150.0;
+
+// Overlap of the fields of view of neighbouring cameras, in mm.
+static const double kCameraOverlap = 300.0;
+
+namespace {
+
+// Referee command from a time on.
+struct TimedCommand {
+  TimedCommand(uint64_t t, SSL_Referee_Command command) :
+      t(t), command(command) {}
+  uint64_t t;
+  SSL_Referee_Command command;
+};
+
+// Orders commands by time.
+bool CommandBefore(const TimedCommand& c1, const TimedCommand& c2) {
+  return (c1.t < c2.t);
+}
+
+// Stage of the game from a time on.
+struct TimedStage {
+  TimedStage(uint64_t t, SSL_Referee_Stage stage) : t(t), stage(stage) {}
+  uint64_t t;
+  SSL_Referee_Stage stage;
+};
+
+// Returns true iff a command is the command of an event, as extracted by the
+// evaluator.
+bool IsEventCommand(SSL_Referee_Command command) {
+  switch (command) {
+    case SSL_Referee_Command_DIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_DIRECT_FREE_BLUE:
+    case SSL_Referee_Command_INDIRECT_FREE_YELLOW:
+    case SSL_Referee_Command_INDIRECT_FREE_BLUE:
+    case SSL_Referee_Command_GOAL_YELLOW:
+    case SSL_Referee_Command_GOAL_BLUE: {
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// Returns a random event command: mostly free kicks, and some goals.
+SSL_Referee_Command RandomEventCommand(Random* random) {
+  static const SSL_Referee_Command kFreeKicks[4] = {
+    SSL_Referee_Command_DIRECT_FREE_YELLOW,
+    SSL_Referee_Command_DIRECT_FREE_BLUE,
+    SSL_Referee_Command_INDIRECT_FREE_YELLOW,
+    SSL_Referee_Command_INDIRECT_FREE_BLUE,
+  };
+  if (random->UniformReal() < 0.1) {
+    return (random->Uniform(2) == 0) ?
+        SSL_Referee_Command_GOAL_YELLOW : SSL_Referee_Command_GOAL_BLUE;
+  }
+  return kFreeKicks[random->Uniform(4)];
+}
+
+// Returns a random time in [min, max) seconds, in microseconds.
+uint64_t RandomDelay(double min, double max, Random* random) {
+  return 1e6 * (min + (max - min) * random->UniformReal());
+}
+
+// Generate the stages of a game, and the commands of the human referee.
+// Events (a STOP, followed by a free kick or a goal) happen during the halves
+// after exponentially distributed durations of play.
+void GenerateGame(const SyntheticLogParameters& parameters,
+                  Random* random,
+                  vector<TimedStage>* stages,
+                  vector<TimedCommand>* commands) {
+  const uint64_t t0 = parameters.start_time;
+  const uint64_t duration = 1e6 * parameters.duration;
+  // Start times of the stages, as fractions of the game.
+  static const int kNumStages = 6;
+  static const double kStageStarts[kNumStages] =
+      {0.0, 0.02, 0.48, 0.52, 0.54, 0.99};
+  static const SSL_Referee_Stage kStages[kNumStages] = {
+    SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE,
+    SSL_Referee_Stage_NORMAL_FIRST_HALF,
+    SSL_Referee_Stage_NORMAL_HALF_TIME,
+    SSL_Referee_Stage_NORMAL_SECOND_HALF_PRE,
+    SSL_Referee_Stage_NORMAL_SECOND_HALF,
+    SSL_Referee_Stage_POST_GAME,
+  };
+  stages->clear();
+  commands->clear();
+  commands->push_back(TimedCommand(t0, SSL_Referee_Command_HALT));
+  for (int i = 0; i < kNumStages; ++i) {
+    const uint64_t begin = t0 + kStageStarts[i] * duration;
+    const uint64_t end = (i + 1 < kNumStages) ?
+        (t0 + kStageStarts[i + 1] * duration) : (t0 + duration);
+    stages->push_back(TimedStage(begin, kStages[i]));
+    switch (kStages[i]) {
+      case SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE:
+      case SSL_Referee_Stage_NORMAL_SECOND_HALF_PRE: {
+        commands->push_back(TimedCommand(begin, SSL_Referee_Command_STOP));
+        commands->push_back(TimedCommand(
+            (begin + end) / 2,
+            (kStages[i] == SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE) ?
+            SSL_Referee_Command_PREPARE_KICKOFF_YELLOW :
+            SSL_Referee_Command_PREPARE_KICKOFF_BLUE));
+      } break;
+
+      case SSL_Referee_Stage_NORMAL_FIRST_HALF:
+      case SSL_Referee_Stage_NORMAL_SECOND_HALF: {
+        commands->push_back(
+            TimedCommand(begin, SSL_Referee_Command_NORMAL_START));
+        uint64_t t = begin;
+        while (true) {
+          // Duration of play until the next STOP.
+          t += -1e6 * parameters.event_period *
+              log(1.0 - random->UniformReal());
+          const uint64_t t_command = t + RandomDelay(1.0, 4.0, random);
+          // Time to resume play after the event.
+          const uint64_t t_resume = t_command + RandomDelay(2.0, 5.0, random);
+          if (t_resume >= end) break;
+          const SSL_Referee_Command command = RandomEventCommand(random);
+          commands->push_back(TimedCommand(t, SSL_Referee_Command_STOP));
+          commands->push_back(TimedCommand(t_command, command));
+          if (command == SSL_Referee_Command_GOAL_YELLOW ||
+              command == SSL_Referee_Command_GOAL_BLUE) {
+            // Kickoff of the team that conceded the goal.
+            commands->push_back(TimedCommand(
+                (t_command + t_resume) / 2,
+                (command == SSL_Referee_Command_GOAL_YELLOW) ?
+                SSL_Referee_Command_PREPARE_KICKOFF_BLUE :
+                SSL_Referee_Command_PREPARE_KICKOFF_YELLOW));
+            commands->push_back(
+                TimedCommand(t_resume, SSL_Referee_Command_NORMAL_START));
+          }
+          t = t_resume;
+        }
+      } break;
+
+      default: {
+        commands->push_back(TimedCommand(begin, SSL_Referee_Command_STOP));
+        commands->push_back(
+            TimedCommand((begin + end) / 2, SSL_Referee_Command_HALT));
+      }
+    }
+  }
+}
+
+// Generate the commands of an autoref from those of the human referee: the
+// same commands after a random lag, except for missed events, confused event
+// commands, and extra false alarm events.
+void GenerateAutoref(const SyntheticAutorefParameters& parameters,
+                     const vector<TimedCommand>& human,
+                     Random* random,
+                     vector<TimedCommand>* commands) {
+  commands->clear();
+  const double lag_min = max(0.0, parameters.lag - parameters.jitter);
+  const double lag_max = parameters.lag + parameters.jitter;
+  for (int i = 0; i < human.size(); ++i) {
+    const TimedCommand& command = human[i];
+    const bool is_event =
+        (command.command == SSL_Referee_Command_STOP &&
+         i + 1 < human.size() &&
+         IsEventCommand(human[i + 1].command));
+    if (!is_event) {
+      commands->push_back(TimedCommand(
+          command.t + RandomDelay(lag_min, lag_max, random),
+          command.command));
+      continue;
+    }
+    const TimedCommand& event_command = human[i + 1];
+    ++i;
+    // False alarm in the play before the event, if there is time for it.
+    static const uint64_t kFalseAlarmDuration = 6000000;
+    const uint64_t t_play = (i >= 2) ? human[i - 2].t : command.t;
+    if (random->UniformReal() < parameters.false_alarm_rate &&
+        command.t > t_play + kFalseAlarmDuration) {
+      const uint64_t t = t_play + 1000000 +
+          (command.t - t_play - kFalseAlarmDuration) * random->UniformReal();
+      commands->push_back(TimedCommand(t, SSL_Referee_Command_STOP));
+      commands->push_back(TimedCommand(t + RandomDelay(0.5, 2.0, random),
+                                       RandomEventCommand(random)));
+      commands->push_back(
+          TimedCommand(t + 3000000, SSL_Referee_Command_FORCE_START));
+    }
+    if (random->UniformReal() < parameters.miss_rate) continue;
+    const uint64_t lag = RandomDelay(lag_min, lag_max, random);
+    SSL_Referee_Command event = event_command.command;
+    if (random->UniformReal() < parameters.confusion_rate) {
+      while (event == event_command.command) {
+        event = RandomEventCommand(random);
+      }
+    }
+    commands->push_back(TimedCommand(command.t + lag, command.command));
+    commands->push_back(TimedCommand(event_command.t + lag, event));
+  }
+  std::stable_sort(commands->begin(), commands->end(), CommandBefore);
+}
+
+// A referee that sends SSL_Referee packets periodically, and whenever its
+// command changes.
+class RefereeSource {
+ public:
+  RefereeSource(int port,
+                const SyntheticLogParameters& parameters,
+                const vector<TimedStage>& stages,
+                const vector<TimedCommand>& commands,
+                Random* random) :
+      port_(port),
+      stages_(stages),
+      commands_(commands),
+      period_(1e6 / parameters.referee_rate),
+      next_packet_(parameters.start_time),
+      next_command_(0),
+      next_stage_(0),
+      t_receive_(0) {
+    message_.set_packet_timestamp(0);
+    message_.set_stage(SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE);
+    message_.set_command(SSL_Referee_Command_HALT);
+    message_.set_command_counter(0);
+    message_.set_command_timestamp(parameters.start_time);
+    InitTeam(parameters.yellow_name, message_.mutable_yellow());
+    InitTeam(parameters.blue_name, message_.mutable_blue());
+    ScheduleReceive(random);
+  }
+
+  // Receive time of the next packet.
+  uint64_t NextTime() const { return t_receive_; }
+
+  // Send the next packet.
+  bool Send(Random* random, LogWriter* writer) {
+    const uint64_t t = SendTime();
+    while (next_stage_ < stages_.size() && stages_[next_stage_].t <= t) {
+      message_.set_stage(stages_[next_stage_].stage);
+      ++next_stage_;
+    }
+    while (next_command_ < commands_.size() &&
+           commands_[next_command_].t <= t) {
+      const TimedCommand& command = commands_[next_command_];
+      message_.set_command(command.command);
+      message_.set_command_counter(message_.command_counter() + 1);
+      message_.set_command_timestamp(command.t);
+      if (command.command == SSL_Referee_Command_GOAL_YELLOW) {
+        message_.mutable_yellow()->set_score(message_.yellow().score() + 1);
+      } else if (command.command == SSL_Referee_Command_GOAL_BLUE) {
+        message_.mutable_blue()->set_score(message_.blue().score() + 1);
+      }
+      ++next_command_;
+    }
+    if (t >= next_packet_) next_packet_ += period_;
+    message_.set_packet_timestamp(t);
+    if (next_stage_ < stages_.size()) {
+      const int64_t time_left = min<int64_t>(
+          stages_[next_stage_].t - t, std::numeric_limits<int32_t>::max());
+      message_.set_stage_time_left(time_left);
+    } else {
+      message_.clear_stage_time_left();
+    }
+    message_.SerializeToString(&buffer_);
+    const bool success = writer->Write(kRefereeMulticast,
+                                       port_,
+                                       t_receive_,
+                                       buffer_.data(),
+                                       buffer_.size());
+    ScheduleReceive(random);
+    return success;
+  }
+
+ private:
+  // Send time of the next packet.
+  uint64_t SendTime() const {
+    if (next_command_ < commands_.size()) {
+      return min(next_packet_, commands_[next_command_].t);
+    }
+    return next_packet_;
+  }
+
+  // Set the network delay of the next packet. Packets are received in the
+  // order they were sent, so that the log is in order of receive time.
+  void ScheduleReceive(Random* random) {
+    t_receive_ = max(t_receive_, SendTime() + 200 + random->Uniform(300));
+  }
+
+  static void InitTeam(const string& name, SSL_Referee_TeamInfo* team) {
+    team->set_name(name);
+    team->set_score(0);
+    team->set_red_cards(0);
+    team->set_yellow_cards(0);
+    team->set_timeouts(4);
+    team->set_timeout_time(300000000);
+    team->set_goalie(0);
+  }
+
+  const int port_;
+  const vector<TimedStage>& stages_;
+  const vector<TimedCommand>& commands_;
+  const uint64_t period_;
+  uint64_t next_packet_;
+  size_t next_command_;
+  size_t next_stage_;
+  uint64_t t_receive_;
+  SSL_Referee message_;
+  string buffer_;
+};
+
+// Simulated robot.
+struct SimRobot {
+  double x;
+  double y;
+  double orientation;
+  double target_x;
+  double target_y;
+};
+
+// Simulated world: robots moving to random targets on the field, one robot
+// of each team chasing the ball, and the ball rolling and bouncing off the
+// walls after it is kicked.
+class World {
+ public:
+  World(const SyntheticLogParameters& parameters, uint64_t seed) :
+      random_(seed),
+      field_length_(parameters.division_a ? 12000 : 9000),
+      field_width_(parameters.division_a ? 9000 : 6000),
+      boundary_width_(300),
+      t_(parameters.start_time),
+      ball_x_(0.0),
+      ball_y_(0.0),
+      ball_vx_(0.0),
+      ball_vy_(0.0) {
+    for (int team = 0; team < 2; ++team) {
+      for (int i = 0; i < parameters.robots_per_team; ++i) {
+        SimRobot robot;
+        RandomPoint(&robot.x, &robot.y);
+        RandomPoint(&robot.target_x, &robot.target_y);
+        robot.orientation = 0.0;
+        robots_[team].push_back(robot);
+      }
+    }
+  }
+
+  // Advance the simulation to time t, in microseconds.
+  void Advance(uint64_t t) {
+    while (t_ < t) {
+      const uint64_t step = min<uint64_t>(t - t_, 1e6 * kMaxStep);
+      Step(1e-6 * static_cast<double>(step));
+      t_ += step;
+    }
+  }
+
+  int field_length() const { return field_length_; }
+  int field_width() const { return field_width_; }
+  int boundary_width() const { return boundary_width_; }
+  double ball_x() const { return ball_x_; }
+  double ball_y() const { return ball_y_; }
+
+  // Robots of team 0 (yellow) or 1 (blue).
+  const vector<SimRobot>& robots(int team) const { return robots_[team]; }
+
+ private:
+  void RandomPoint(double* x, double* y) {
+    *x = field_length_ * (random_.UniformReal() - 0.5);
+    *y = field_width_ * (random_.UniformReal() - 0.5);
+  }
+
+  void Step(double dt) {
+    bool kicked = false;
+    const double ball_speed = sqrt(ball_vx_ * ball_vx_ + ball_vy_ * ball_vy_);
+    for (int team = 0; team < 2; ++team) {
+      for (int i = 0; i < robots_[team].size(); ++i) {
+        SimRobot& robot = robots_[team][i];
+        if (i == 0) {
+          robot.target_x = ball_x_;
+          robot.target_y = ball_y_;
+        }
+        const double dx = robot.target_x - robot.x;
+        const double dy = robot.target_y - robot.y;
+        const double distance = sqrt(dx * dx + dy * dy);
+        if (distance < kKickDistance) {
+          if (i == 0 && !kicked && ball_speed < 100.0) {
+            // Kick the ball in a random direction.
+            const double speed = 1000.0 + 5000.0 * random_.UniformReal();
+            const double angle = 2.0 * M_PI * random_.UniformReal();
+            ball_vx_ = speed * cos(angle);
+            ball_vy_ = speed * sin(angle);
+            kicked = true;
+          } else if (i != 0) {
+            RandomPoint(&robot.target_x, &robot.target_y);
+          }
+          continue;
+        }
+        const double move = min(distance, kRobotSpeed * dt);
+        robot.x += move * dx / distance;
+        robot.y += move * dy / distance;
+        robot.orientation = atan2(dy, dx);
+      }
+    }
+    // Roll the ball, and bounce it off the walls.
+    if (ball_speed > 0.0) {
+      const double speed =
+          max(0.0, ball_speed - kBallDeceleration * dt) / ball_speed;
+      ball_vx_ *= speed;
+      ball_vy_ *= speed;
+    }
+    ball_x_ += ball_vx_ * dt;
+    ball_y_ += ball_vy_ * dt;
+    const double max_x = 0.5 * field_length_ + boundary_width_;
+    const double max_y = 0.5 * field_width_ + boundary_width_;
+    if (fabs(ball_x_) > max_x) {
+      ball_x_ = (ball_x_ > 0.0) ? max_x : -max_x;
+      ball_vx_ = -ball_vx_;
+    }
+    if (fabs(ball_y_) > max_y) {
+      ball_y_ = (ball_y_ > 0.0) ? max_y : -max_y;
+      ball_vy_ = -ball_vy_;
+    }
+  }
+
+  Random random_;
+  const int field_length_;
+  const int field_width_;
+  const int boundary_width_;
+  uint64_t t_;
+  double ball_x_;
+  double ball_y_;
+  double ball_vx_;
+  double ball_vy_;
+  vector<SimRobot> robots_[2];
+};
+
+// A camera of SSL-Vision, which sees a stripe of the field across its length,
+// and sends a detection frame of it at a fixed rate.
+class CameraSource {
+ public:
+  CameraSource(int camera_id,
+               const SyntheticLogParameters& parameters,
+               const World& world,
+               Random* random) :
+      camera_id_(camera_id),
+      geometry_period_(parameters.geometry_period),
+      period_(1e6 / parameters.camera_rate),
+      frame_number_(0),
+      t_receive_(0) {
+    const double stripe_length =
+        static_cast<double>(world.field_length() + 2 * world.boundary_width()) /
+        parameters.num_cameras;
+    min_x_ = -0.5 * world.field_length() - world.boundary_width() +
+        camera_id * stripe_length;
+    max_x_ = min_x_ + stripe_length;
+    // The cameras are not synchronized.
+    t_capture_ = parameters.start_time + random->Uniform(period_);
+    ScheduleFrame(random);
+  }
+
+  // Receive time of the next frame.
+  uint64_t NextTime() const { return t_receive_; }
+
+  // Capture time of the next frame.
+  uint64_t capture_time() const { return t_capture_; }
+
+  // Send the next frame of the world, advanced to its capture time.
+  bool Send(const World& world,
+            const SSL_GeometryData& geometry,
+            Random* random,
+            LogWriter* writer) {
+    packet_.Clear();
+    SSL_DetectionFrame* frame = packet_.mutable_detection();
+    frame->set_frame_number(frame_number_);
+    frame->set_t_capture(1e-6 * static_cast<double>(t_capture_));
+    frame->set_t_sent(1e-6 * static_cast<double>(t_sent_));
+    frame->set_camera_id(camera_id_);
+    if (IsVisible(world.ball_x(), random)) {
+      SSL_DetectionBall* ball = frame->add_balls();
+      ball->set_confidence(0.9 + 0.1 * random->UniformReal());
+      ball->set_area(80);
+      ball->set_x(world.ball_x() + Noise(random));
+      ball->set_y(world.ball_y() + Noise(random));
+      ball->set_z(0.0);
+      ball->set_pixel_x(PixelX(world.ball_x()));
+      ball->set_pixel_y(PixelY(world.ball_y(), world));
+    }
+    for (int team = 0; team < 2; ++team) {
+      const vector<SimRobot>& robots = world.robots(team);
+      for (int i = 0; i < robots.size(); ++i) {
+        const SimRobot& robot = robots[i];
+        if (!IsVisible(robot.x, random)) continue;
+        SSL_DetectionRobot* detection = (team == 0) ?
+            frame->add_robots_yellow() : frame->add_robots_blue();
+        detection->set_confidence(0.8 + 0.2 * random->UniformReal());
+        detection->set_robot_id(i);
+        detection->set_x(robot.x + Noise(random));
+        detection->set_y(robot.y + Noise(random));
+        detection->set_orientation(robot.orientation);
+        detection->set_pixel_x(PixelX(robot.x));
+        detection->set_pixel_y(PixelY(robot.y, world));
+        detection->set_height(150.0);
+      }
+    }
+    if (geometry_period_ > 0 && frame_number_ % geometry_period_ == 0) {
+      packet_.mutable_geometry()->CopyFrom(geometry);
+    }
+    packet_.SerializeToString(&buffer_);
+    const bool success = writer->Write(kVisionMulticast,
+                                       kVisionPort,
+                                       t_receive_,
+                                       buffer_.data(),
+                                       buffer_.size());
+    ++frame_number_;
+    t_capture_ += period_;
+    ScheduleFrame(random);
+    return success;
+  }
+
+ private:
+  // Set the processing and network delays of the next frame.
+  void ScheduleFrame(Random* random) {
+    t_sent_ = t_capture_ + 2000 + random->Uniform(3000);
+    t_receive_ = max(t_receive_, t_sent_ + 200 + random->Uniform(300));
+  }
+
+  // Returns true iff an object at x is detected, with a 2% chance of missed
+  // detections.
+  bool IsVisible(double x, Random* random) const {
+    return (x >= min_x_ - kCameraOverlap &&
+            x < max_x_ + kCameraOverlap &&
+            random->Uniform(50) != 0);
+  }
+
+  // Detection noise, in mm.
+  static double Noise(Random* random) {
+    return 10.0 * (random->UniformReal() - 0.5);
+  }
+
+  float PixelX(double x) const {
+    return 780.0 * (x - min_x_) / (max_x_ - min_x_);
+  }
+
+  static float PixelY(double y, const World& world) {
+    return 580.0 * (y / world.field_width() + 0.5);
+  }
+
+  const int camera_id_;
+  const int geometry_period_;
+  const uint64_t period_;
+  double min_x_;
+  double max_x_;
+  uint32_t frame_number_;
+  uint64_t t_capture_;
+  uint64_t t_sent_;
+  uint64_t t_receive_;
+  SSL_WrapperPacket packet_;
+  string buffer_;
+};
+
+void AddLine(const char* name,
+             float x1, float y1, float x2, float y2,
+             SSL_GeometryFieldSize* field) {
+  SSL_FieldLineSegment* line = field->add_field_lines();
+  line->set_name(name);
+  line->mutable_p1()->set_x(x1);
+  line->mutable_p1()->set_y(y1);
+  line->mutable_p2()->set_x(x2);
+  line->mutable_p2()->set_y(y2);
+  line->set_thickness(10.0);
+}
+
+// Field geometry and camera calibrations of the simulated world.
+void GetGeometry(const SyntheticLogParameters& parameters,
+                 const World& world,
+                 SSL_GeometryData* geometry) {
+  const float length = world.field_length();
+  const float width = world.field_width();
+  SSL_GeometryFieldSize* field = geometry->mutable_field();
+  field->set_field_length(world.field_length());
+  field->set_field_width(world.field_width());
+  field->set_goal_width(parameters.division_a ? 1200 : 1000);
+  field->set_goal_depth(180);
+  field->set_boundary_width(world.boundary_width());
+  AddLine("TopTouchLine",
+          -0.5 * length, 0.5 * width, 0.5 * length, 0.5 * width, field);
+  AddLine("BottomTouchLine",
+          -0.5 * length, -0.5 * width, 0.5 * length, -0.5 * width, field);
+  AddLine("LeftGoalLine",
+          -0.5 * length, -0.5 * width, -0.5 * length, 0.5 * width, field);
+  AddLine("RightGoalLine",
+          0.5 * length, -0.5 * width, 0.5 * length, 0.5 * width, field);
+  AddLine("HalfwayLine", 0.0, -0.5 * width, 0.0, 0.5 * width, field);
+  AddLine("CenterLine", -0.5 * length, 0.0, 0.5 * length, 0.0, field);
+  SSL_FieldCicularArc* arc = field->add_field_arcs();
+  arc->set_name("CenterCircle");
+  arc->mutable_center()->set_x(0.0);
+  arc->mutable_center()->set_y(0.0);
+  arc->set_radius(500.0);
+  arc->set_a1(0.0);
+  arc->set_a2(2.0 * M_PI);
+  arc->set_thickness(10.0);
+  for (int i = 0; i < parameters.num_cameras; ++i) {
+    const float stripe_length =
+        (length + 2 * world.boundary_width()) / parameters.num_cameras;
+    SSL_GeometryCameraCalibration* calib = geometry->add_calib();
+    calib->set_camera_id(i);
+    calib->set_focal_length(500.0);
+    calib->set_principal_point_x(390.0);
+    calib->set_principal_point_y(290.0);
+    calib->set_distortion(0.1);
+    calib->set_q0(1.0);
+    calib->set_q1(0.0);
+    calib->set_q2(0.0);
+    calib->set_q3(0.0);
+    calib->set_tx(0.0);
+    calib->set_ty(0.0);
+    calib->set_tz(4000.0);
+    calib->set_derived_camera_world_tx(
+        -0.5 * length - world.boundary_width() + (i + 0.5) * stripe_length);
+    calib->set_derived_camera_world_ty(0.0);
+    calib->set_derived_camera_world_tz(4000.0);
+  }
+}
+
+}  // namespace
+
+bool GenerateSyntheticLog(const SyntheticLogParameters& parameters,
+                          LogWriter* writer) {
+  // Independent random streams, so that e.g. changing the autorefs does not
+  // change the game or the vision.
+  Random seeder(parameters.seed);
+  Random game_random(seeder.Next());
+  Random world_random(seeder.Next());
+  Random network_random(seeder.Next());
+
+  vector<TimedStage> stages;
+  vector<vector<TimedCommand> > commands(1 + parameters.autorefs.size());
+  GenerateGame(parameters, &game_random, &stages, &(commands[0]));
+  for (int i = 0; i < parameters.autorefs.size(); ++i) {
+    Random autoref_random(seeder.Next());
+    GenerateAutoref(parameters.autorefs[i],
+                    commands[0],
+                    &autoref_random,
+                    &(commands[i + 1]));
+  }
+
+  World world(parameters, world_random.Next());
+  SSL_GeometryData geometry;
+  GetGeometry(parameters, world, &geometry);
+  vector<CameraSource*> cameras;
+  for (int i = 0; i < parameters.num_cameras; ++i) {
+    cameras.push_back(
+        new CameraSource(i, parameters, world, &network_random));
+  }
+  vector<RefereeSource*> referees;
+  for (int i = 0; i < commands.size(); ++i) {
+    const int port = (i == 0) ? kRefboxPort : (kSyntheticAutorefPort + i - 1);
+    referees.push_back(new RefereeSource(
+        port, parameters, stages, commands[i], &network_random));
+  }
+
+  // Write the packets of all sources in order of receive time, as the logger
+  // does. Sources are numbered cameras first, then referees.
+  typedef std::pair<uint64_t, int> QueueEntry;
+  std::priority_queue<QueueEntry,
+                      vector<QueueEntry>,
+                      std::greater<QueueEntry> > queue;
+  for (int i = 0; i < cameras.size(); ++i) {
+    queue.push(QueueEntry(cameras[i]->NextTime(), i));
+  }
+  for (int i = 0; i < referees.size(); ++i) {
+    queue.push(QueueEntry(referees[i]->NextTime(), cameras.size() + i));
+  }
+  const uint64_t t_end = parameters.start_time + 1e6 * parameters.duration;
+  bool success = true;
+  while (success && !queue.empty() && queue.top().first < t_end) {
+    const int source = queue.top().second;
+    queue.pop();
+    if (source < cameras.size()) {
+      CameraSource* camera = cameras[source];
+      world.Advance(camera->capture_time());
+      success = camera->Send(world, geometry, &world_random, writer);
+      queue.push(QueueEntry(camera->NextTime(), source));
+    } else {
+      RefereeSource* referee = referees[source - cameras.size()];
+      success = referee->Send(&network_random, writer);
+      queue.push(QueueEntry(referee->NextTime(), source));
+    }
+  }
+
+  for (int i = 0; i < cameras.size(); ++i) {
+    delete cameras[i];
+  }
+  for (int i = 0; i < referees.size(); ++i) {
+    delete referees[i];
+  }
+  return success;
+}
@@ -0,0 +1,106 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Generator of synthetic game logs in the format of the logger, to benchmark
+// the logger, playback and the evaluation without real tournament logs.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#ifndef LOG_GENERATOR_H_
+#define LOG_GENERATOR_H_
+
+class LogWriter;
+
+// Port number of the first autoref of a synthetic log. Autoref k sends to
+// kSyntheticAutorefPort + k.
+static const int kSyntheticAutorefPort = 10010;
+
+// Parameters of an autoref.
+struct SyntheticAutorefParameters {
+  SyntheticAutorefParameters() :
+      lag(0.5), jitter(0.2), miss_rate(0.1), false_alarm_rate(0.05),
+      confusion_rate(0.05) {}
+
+  // Mean delay of the commands of the autoref after those of the human
+  // referee, and the maximum deviation from the mean, in seconds.
+  double lag;
+  double jitter;
+
+  // Probability that the autoref misses an event of the human referee.
+  double miss_rate;
+
+  // Probability that the autoref calls an extra event, before every event of
+  // the human referee.
+  double false_alarm_rate;
+
+  // Probability that the autoref calls a different command than the human
+  // referee for the same event.
+  double confusion_rate;
+};
+
+// Parameters of the generated log.
+struct SyntheticLogParameters {
+  SyntheticLogParameters() :
+      seed(1), start_time(1467331200000000ULL), duration(600.0),
+      num_cameras(4), camera_rate(60.0), geometry_period(30),
+      robots_per_team(6), division_a(false), referee_rate(10.0),
+      event_period(30.0), yellow_name("Yellow"), blue_name("Blue") {}
+
+  uint64_t seed;
+
+  // Receive timestamp of the start of the log, in microseconds.
+  uint64_t start_time;
+
+  // Duration of the log, in seconds.
+  double duration;
+
+  // Number of cameras, and frame rate of every camera, in Hz.
+  int num_cameras;
+  double camera_rate;
+
+  // Number of frames of a camera between packets with the field geometry.
+  int geometry_period;
+
+  int robots_per_team;
+
+  // Field of division A if set, and of division B otherwise.
+  bool division_a;
+
+  // Rate of the packets of every referee, in Hz.
+  double referee_rate;
+
+  // Mean duration of play between events, in seconds.
+  double event_period;
+
+  std::string yellow_name;
+  std::string blue_name;
+
+  std::vector<SyntheticAutorefParameters> autorefs;
+};
+
+// Write a synthetic log: SSL-Vision cameras sending detection frames of
+// simulated robots and ball, a refbox going through the stages of a game with
+// STOP, free kick and goal sequences, and autorefs following the refbox. The
+// same parameters always produce the same log. Returns false on error.
+bool GenerateSyntheticLog(const SyntheticLogParameters& parameters,
+                          LogWriter* writer);
+
+#endif  // LOG_GENERATOR_H_
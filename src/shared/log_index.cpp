@@ -0,0 +1,263 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+//
+// Index of a log file.
+
+#include "log_index.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "log_index.pb.h"
+#include "log_reader.h"
+#include "misc_util.h"
+#include "referee.pb.h"
+#include "trace.h"
+#include "wire_decoder.h"
+
+using std::string;
+using std::vector;
+
+// UDP Multicast address for referees.
+static const char* kRefereeMulticast = "224.5.23.1";
+
+// Port number for main refbox.
+static const int kRefboxPort = 10003;
+
+// Returns true iff a team name is the given serialized string.
+static bool NameIs(const string& name, const char* other, size_t other_size) {
+  return (name.size() == other_size &&
+          (other_size == 0 || memcmp(name.data(), other, other_size) == 0));
+}
+
+// Orders checkpoints by their timestamps.
+static bool CheckpointBefore(uint64_t t, const LogCheckpoint& checkpoint) {
+  return (t < checkpoint.timestamp());
+}
+
+void IntersectWindows(const vector<TimeWindow>& windows1,
+                      const vector<TimeWindow>& windows2,
+                      vector<TimeWindow>* intersection) {
+  intersection->clear();
+  size_t i = 0;
+  size_t j = 0;
+  while (i < windows1.size() && j < windows2.size()) {
+    const uint64_t begin = std::max(windows1[i].begin, windows2[j].begin);
+    const uint64_t end = std::min(windows1[i].end, windows2[j].end);
+    if (begin < end) intersection->push_back(TimeWindow(begin, end));
+    if (windows1[i].end < windows2[j].end) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+}
+
+const uint64_t LogIndex::kCheckpointPeriod;
+const uint32_t LogIndex::kVersion;
+
+LogIndex::LogIndex() : built_(false) {}
+
+string LogIndex::IndexFile(const string& log_file) {
+  return log_file + ".idx";
+}
+
+bool LogIndex::Open(const string& log_file) {
+  built_ = false;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if (!GetFileStatus(log_file, &size, &mtime)) {
+    perror(("Error reading \"" + log_file + "\"").c_str());
+    return false;
+  }
+  const string index_file = IndexFile(log_file);
+  if (Load(index_file) &&
+      data_.version() == kVersion &&
+      data_.log_size() == size &&
+      data_.log_mtime() == mtime) {
+    return true;
+  }
+  if (!Build(log_file)) return false;
+  built_ = true;
+  if (!Save(index_file)) {
+    fprintf(stderr, "WARNING: Could not save the index \"%s\"\n",
+            index_file.c_str());
+  }
+  return true;
+}
+
+bool LogIndex::Build(const string& log_file) {
+  TRACE_SCOPE("log_index");
+  data_.Clear();
+  LogReader reader;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if (!GetFileStatus(log_file, &size, &mtime) || !reader.Open(log_file)) {
+    perror(("Error reading \"" + log_file + "\"").c_str());
+    return false;
+  }
+  data_.set_version(kVersion);
+  data_.set_log_size(size);
+  data_.set_log_mtime(mtime);
+  uint64_t num_records = 0;
+  uint64_t offset = reader.Tell();
+  LogStageSpan* stage = NULL;
+  while (reader.ReadRecord()) {
+    EnvelopeView envelope;
+    if (DecodeEnvelope(reader.record(), reader.record_size(), &envelope)) {
+      const uint64_t t = envelope.timestamp;
+      // The logger takes the receive timestamps before serializing the
+      // writes, so they are not quite in order. A checkpoint is placed after
+      // the latest record before it, not at the timestamp of its record.
+      if (num_records == 0) {
+        data_.set_first_timestamp(t);
+        data_.set_last_timestamp(t);
+        LogCheckpoint* checkpoint = data_.add_checkpoints();
+        checkpoint->set_timestamp(t);
+        checkpoint->set_offset(offset);
+      } else if (data_.last_timestamp() + 1 >=
+                 data_.checkpoints(data_.checkpoints_size() - 1).timestamp() +
+                     kCheckpointPeriod) {
+        LogCheckpoint* checkpoint = data_.add_checkpoints();
+        checkpoint->set_timestamp(data_.last_timestamp() + 1);
+        checkpoint->set_offset(offset);
+      }
+      data_.set_first_timestamp(std::min(data_.first_timestamp(), t));
+      data_.set_last_timestamp(std::max(data_.last_timestamp(), t));
+      ++num_records;
+      RefereeView referee;
+      if (envelope.port == kRefboxPort &&
+          envelope.AddressIs(kRefereeMulticast) &&
+          DecodeReferee(envelope.data, envelope.data_size, &referee) &&
+          (stage == NULL || stage->stage() != referee.stage ||
+           !NameIs(stage->yellow_name(),
+                   referee.yellow_name, referee.yellow_name_size) ||
+           !NameIs(stage->blue_name(),
+                   referee.blue_name, referee.blue_name_size))) {
+        if (stage != NULL) stage->set_end_timestamp(t);
+        stage = data_.add_stages();
+        stage->set_stage(referee.stage);
+        stage->set_begin_timestamp(t);
+        stage->set_yellow_name(referee.yellow_name, referee.yellow_name_size);
+        stage->set_blue_name(referee.blue_name, referee.blue_name_size);
+      }
+    }
+    offset = reader.Tell();
+  }
+  if (stage != NULL) stage->set_end_timestamp(data_.last_timestamp() + 1);
+  data_.set_num_records(num_records);
+  return true;
+}
+
+bool LogIndex::Load(const string& index_file) {
+  data_.Clear();
+  ScopedFile fid(index_file, "rb");
+  if (fid() == NULL) return false;
+  string buffer;
+  char block[4096];
+  size_t num_read = 0;
+  while ((num_read = fread(block, 1, sizeof(block), fid)) > 0) {
+    buffer.append(block, num_read);
+  }
+  return data_.ParseFromString(buffer);
+}
+
+bool LogIndex::Save(const string& index_file) const {
+  // Write to a temporary file and rename it, so that concurrent readers never
+  // see a partial index.
+  const string temp_file = index_file + ".tmp";
+  string buffer;
+  if (!data_.SerializeToString(&buffer)) return false;
+  {
+    ScopedFile fid(temp_file, "wb");
+    if (fid() == NULL ||
+        fwrite(buffer.data(), 1, buffer.size(), fid) != buffer.size()) {
+      return false;
+    }
+  }
+  return (rename(temp_file.c_str(), index_file.c_str()) == 0);
+}
+
+uint64_t LogIndex::FindOffset(uint64_t t) const {
+  const google::protobuf::RepeatedPtrField<LogCheckpoint>& checkpoints =
+      data_.checkpoints();
+  google::protobuf::RepeatedPtrField<LogCheckpoint>::const_iterator it =
+      std::upper_bound(
+          checkpoints.begin(), checkpoints.end(), t, CheckpointBefore);
+  if (it == checkpoints.begin()) return 0;
+  --it;
+  return it->offset();
+}
+
+void LogIndex::FindStageWindows(const vector<SSL_Referee_Stage>& stages,
+                                vector<TimeWindow>* windows) const {
+  windows->clear();
+  for (int i = 0; i < data_.stages_size(); ++i) {
+    const LogStageSpan& span = data_.stages(i);
+    if (std::find(stages.begin(), stages.end(), span.stage()) ==
+        stages.end()) {
+      continue;
+    }
+    if (!windows->empty() && windows->back().end == span.begin_timestamp()) {
+      windows->back().end = span.end_timestamp();
+    } else {
+      windows->push_back(
+          TimeWindow(span.begin_timestamp(), span.end_timestamp()));
+    }
+  }
+}
+
+void LogIndex::FindGames(uint64_t post_game_duration,
+                         vector<GameWindow>* games) const {
+  games->clear();
+  // Whether the last game has not reached POST_GAME yet.
+  bool in_game = false;
+  for (int i = 0; i < data_.stages_size(); ++i) {
+    const LogStageSpan& span = data_.stages(i);
+    if (span.stage() == SSL_Referee_Stage_POST_GAME) {
+      if (in_game) {
+        games->back().window.end = std::min(
+            span.begin_timestamp() + post_game_duration,
+            span.end_timestamp());
+      }
+      in_game = false;
+      continue;
+    }
+    if (in_game &&
+        (span.stage() != SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE ||
+         data_.stages(i - 1).stage() == span.stage()) &&
+        span.yellow_name() == games->back().yellow_name &&
+        span.blue_name() == games->back().blue_name) {
+      games->back().window.end = span.end_timestamp();
+      continue;
+    }
+    if (in_game) games->back().window.end = span.begin_timestamp();
+    games->push_back(GameWindow());
+    GameWindow& game = games->back();
+    game.window = TimeWindow(span.begin_timestamp(), span.end_timestamp());
+    game.yellow_name = span.yellow_name();
+    game.blue_name = span.blue_name();
+    in_game = true;
+  }
+}
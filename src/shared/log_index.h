@@ -0,0 +1,125 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+//
+// Index of a log file, to read only the parts of a log received in a span of
+// time, or during some stages of the game.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "log_index.pb.h"
+#include "referee.pb.h"
+
+#ifndef LOG_INDEX_H_
+#define LOG_INDEX_H_
+
+// Span [begin, end) of receive timestamps of the records of a log, in
+// microseconds.
+struct TimeWindow {
+  TimeWindow() : begin(0), end(0) {}
+  TimeWindow(uint64_t begin, uint64_t end) : begin(begin), end(end) {}
+
+  // Returns true iff t is in the window.
+  bool Contains(uint64_t t) const { return (t >= begin && t < end); }
+
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Time window of a game of a log, and the names of its teams.
+struct GameWindow {
+  TimeWindow window;
+  std::string yellow_name;
+  std::string blue_name;
+};
+
+// Intersection of two sets of disjoint windows, each in order of time.
+void IntersectWindows(const std::vector<TimeWindow>& windows1,
+                      const std::vector<TimeWindow>& windows2,
+                      std::vector<TimeWindow>* intersection);
+
+// Index of a log: file offsets of the records at regular intervals of their
+// receive timestamps, and the time spans of the stages and team names of the
+// human referee.
+// The index is built by reading the log once, and stored in
+// "<log file>.idx", so that later reads of the log can seek directly to the
+// records of a span of time.
+class LogIndex {
+ public:
+  // Period of the checkpoints of the index, in microseconds.
+  static const uint64_t kCheckpointPeriod = 1000000;
+
+  // Version of the index, to be incremented whenever its contents change.
+  static const uint32_t kVersion = 3;
+
+  LogIndex();
+
+  // Returns the name of the index file of a log.
+  static std::string IndexFile(const std::string& log_file);
+
+  // Load the index of a log from its index file if it is up to date with
+  // the log, or else build it and try to save it to the index file. Failing
+  // to save the index is not an error. Returns false if the log could not be
+  // read.
+  bool Open(const std::string& log_file);
+
+  // Build the index of a log by reading all of it. Returns false on error.
+  bool Build(const std::string& log_file);
+
+  // Load and save the index from and to an index file. Returns false on
+  // error.
+  bool Load(const std::string& index_file);
+  bool Save(const std::string& index_file) const;
+
+  // Returns true iff the last call to Open() built the index.
+  bool built() const { return built_; }
+
+  const LogIndexData& data() const { return data_; }
+
+  // Earliest and latest receive timestamps of the records of the log.
+  uint64_t first_timestamp() const { return data_.first_timestamp(); }
+  uint64_t last_timestamp() const { return data_.last_timestamp(); }
+
+  // Returns the offset of a record such that no record before it was
+  // received at or after time t. Reading from there, about
+  // kCheckpointPeriod of records received before t are read, plus those
+  // that were logged out of order.
+  uint64_t FindOffset(uint64_t t) const;
+
+  // Find the windows of time during which the human referee was in one of
+  // the given stages, in order of time.
+  void FindStageWindows(const std::vector<SSL_Referee_Stage>& stages,
+                        std::vector<TimeWindow>* windows) const;
+
+  // Find the games of the log, in order of time. A game starts when the human
+  // referee enters NORMAL_FIRST_HALF_PRE, changes the team names, or leaves
+  // POST_GAME (or at its first stage, unless POST_GAME). It ends when the
+  // next game starts, or post_game_duration microseconds after it enters
+  // POST_GAME.
+  void FindGames(uint64_t post_game_duration,
+                 std::vector<GameWindow>* games) const;
+
+ private:
+  LogIndexData data_;
+  bool built_;
+};
+
+#endif  // LOG_INDEX_H_
@@ -0,0 +1,179 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Merge of logs written by several loggers into a single log.
+
+#include "log_merger.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "log_reader.h"
+#include "log_writer.h"
+#include "misc_util.h"
+#include "wire_decoder.h"
+
+using std::make_pair;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Entry of the heap of the inputs, by the time of their current records and
+// then by their order, so that the merge is deterministic.
+struct HeapEntry {
+  HeapEntry(uint64_t t, int input) : t(t), input(input) {}
+  bool operator>(const HeapEntry& other) const {
+    return (t > other.t || (t == other.t && input > other.input));
+  }
+  uint64_t t;
+  int input;
+};
+
+}  // namespace
+
+const uint64_t LogMerger::kDefaultDedupWindow;
+
+bool LogMerger::DatagramKey::operator<(const DatagramKey& other) const {
+  if (data_hash != other.data_hash) return (data_hash < other.data_hash);
+  if (address_hash != other.address_hash) {
+    return (address_hash < other.address_hash);
+  }
+  return (port < other.port);
+}
+
+LogMerger::LogMerger() :
+    dedup_window_(kDefaultDedupWindow), num_written_(0) {}
+
+LogMerger::~LogMerger() {
+  CloseInputs();
+}
+
+void LogMerger::AddInput(const string& file_name, int64_t clock_offset) {
+  Input input;
+  input.file_name = file_name;
+  input.clock_offset = clock_offset;
+  inputs_.push_back(input);
+}
+
+void LogMerger::CloseInputs() {
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    delete inputs_[i].reader;
+    inputs_[i].reader = NULL;
+  }
+}
+
+bool LogMerger::Advance(Input* input) {
+  while (input->reader->ReadRecord()) {
+    ++input->num_read;
+    if (!DecodeEnvelope(input->reader->record(),
+                        input->reader->record_size(),
+                        &input->envelope)) {
+      ++input->num_malformed;
+      continue;
+    }
+    input->t = input->envelope.timestamp + input->clock_offset;
+    return true;
+  }
+  return false;
+}
+
+bool LogMerger::IsDuplicate(int input) {
+  const EnvelopeView& envelope = inputs_[input].envelope;
+  const uint64_t t = inputs_[input].t;
+  // Forget the datagrams received before the window.
+  while (!recent_order_.empty() &&
+         recent_order_.front().first + dedup_window_ < t) {
+    map<DatagramKey, Datagram>::iterator it =
+        recent_.find(recent_order_.front().second);
+    if (it != recent_.end() && it->second.t == recent_order_.front().first) {
+      recent_.erase(it);
+    }
+    recent_order_.pop_front();
+  }
+  DatagramKey key;
+  key.address_hash = Hash64(envelope.address, envelope.address_size);
+  key.data_hash = Hash64(envelope.data, envelope.data_size);
+  key.port = envelope.port;
+  map<DatagramKey, Datagram>::iterator it = recent_.find(key);
+  // Identical datagrams of the same input are sent repeatedly, e.g. the
+  // field geometry, and are not duplicates.
+  if (it != recent_.end() && it->second.input != input &&
+      t <= it->second.t + dedup_window_) {
+    return true;
+  }
+  recent_[key] = Datagram(t, input);
+  recent_order_.push_back(make_pair(t, key));
+  return false;
+}
+
+bool LogMerger::Merge(LogWriter* writer) {
+  CloseInputs();
+  recent_.clear();
+  recent_order_.clear();
+  num_written_ = 0;
+  std::priority_queue<HeapEntry, vector<HeapEntry>, std::greater<HeapEntry> >
+      heap;
+  for (int i = 0; i < num_inputs(); ++i) {
+    Input& input = inputs_[i];
+    input.num_read = 0;
+    input.num_duplicates = 0;
+    input.num_malformed = 0;
+    input.reader = new LogReader();
+    if (!input.reader->Open(input.file_name)) {
+      perror(("Error reading \"" + input.file_name + "\"").c_str());
+      CloseInputs();
+      return false;
+    }
+    if (Advance(&input)) heap.push(HeapEntry(input.t, i));
+  }
+  bool success = true;
+  while (success && !heap.empty()) {
+    const int i = heap.top().input;
+    heap.pop();
+    Input& input = inputs_[i];
+    if (dedup_window_ > 0 && IsDuplicate(i)) {
+      ++input.num_duplicates;
+    } else if (input.clock_offset == 0) {
+      success = writer->WriteRecord(input.reader->record(),
+                                    input.reader->record_size());
+      ++num_written_;
+    } else {
+      const EnvelopeView& envelope = input.envelope;
+      address_.assign(envelope.address, envelope.address_size);
+      success = writer->Write(address_, envelope.port, input.t,
+                              envelope.data, envelope.data_size);
+      ++num_written_;
+    }
+    if (Advance(&input)) heap.push(HeapEntry(input.t, i));
+  }
+  for (int i = 0; i < num_inputs(); ++i) {
+    if (inputs_[i].reader->status() == LogReader::kReadError) success = false;
+  }
+  CloseInputs();
+  return success;
+}
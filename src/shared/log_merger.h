@@ -0,0 +1,143 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Merge of logs written by several loggers into a single log, in order of
+// receive time.
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "wire_decoder.h"
+
+#ifndef LOG_MERGER_H_
+#define LOG_MERGER_H_
+
+class LogReader;
+class LogWriter;
+
+// Merges any number of logs into one, in a single streaming pass: the next
+// record written is always the earliest of the next records of the inputs,
+// kept in a heap. Every input should be in order of receive time, as the
+// logger writes them. The receive timestamps of every input can be shifted
+// by a clock offset, to correct for the clocks of different machines.
+// Datagrams that were logged by more than one logger, i.e. with the same
+// address, port and data received by different inputs within the
+// de-duplication window, are written only once. Memory use only depends on
+// the number of inputs and on the datagrams received within the window, not
+// on the size of the inputs.
+class LogMerger {
+ public:
+  // Default de-duplication window, in microseconds.
+  static const uint64_t kDefaultDedupWindow = 100000;
+
+  LogMerger();
+  ~LogMerger();
+
+  // Add an input log, whose receive timestamps are shifted by clock_offset
+  // microseconds.
+  void AddInput(const std::string& file_name, int64_t clock_offset);
+
+  // Set the de-duplication window in microseconds, 0 to write all records.
+  void set_dedup_window(uint64_t window) { dedup_window_ = window; }
+
+  // Merge the inputs into a log. Returns false on error.
+  bool Merge(LogWriter* writer);
+
+  // Number of inputs.
+  int num_inputs() const { return static_cast<int>(inputs_.size()); }
+
+  // Number of records read from an input, and dropped as duplicates or as
+  // malformed.
+  uint64_t num_read(int input) const { return inputs_[input].num_read; }
+  uint64_t num_duplicates(int input) const {
+    return inputs_[input].num_duplicates;
+  }
+  uint64_t num_malformed(int input) const {
+    return inputs_[input].num_malformed;
+  }
+
+  // Number of records written.
+  uint64_t num_written() const { return num_written_; }
+
+ private:
+  // Identity of a datagram, by hashes of its address and data.
+  struct DatagramKey {
+    DatagramKey() : address_hash(0), data_hash(0), port(0) {}
+    bool operator<(const DatagramKey& other) const;
+    uint64_t address_hash;
+    uint64_t data_hash;
+    int port;
+  };
+
+  // Latest receive time and input of a datagram that was written.
+  struct Datagram {
+    Datagram() : t(0), input(0) {}
+    Datagram(uint64_t t, int input) : t(t), input(input) {}
+    uint64_t t;
+    int input;
+  };
+
+  struct Input {
+    Input() :
+        clock_offset(0), reader(NULL), t(0), num_read(0), num_duplicates(0),
+        num_malformed(0) {}
+    std::string file_name;
+    int64_t clock_offset;
+    LogReader* reader;
+    // Envelope of the current record of the reader, and its shifted receive
+    // timestamp.
+    EnvelopeView envelope;
+    uint64_t t;
+    uint64_t num_read;
+    uint64_t num_duplicates;
+    uint64_t num_malformed;
+  };
+
+  // Disable the copy constructor and assignment operator.
+  LogMerger(const LogMerger&);
+  void operator=(const LogMerger&);
+
+  // Read the next valid record of an input. Returns false at its end.
+  bool Advance(Input* input);
+
+  // Returns true iff the current record of an input is a duplicate of a
+  // record of another input written within the window, and else remembers
+  // it as written.
+  bool IsDuplicate(int input);
+
+  // Close all the inputs.
+  void CloseInputs();
+
+  std::vector<Input> inputs_;
+  uint64_t dedup_window_;
+  uint64_t num_written_;
+
+  // Datagrams written within the window, and their keys in order of time.
+  std::map<DatagramKey, Datagram> recent_;
+  std::deque<std::pair<uint64_t, DatagramKey> > recent_order_;
+
+  // Reused to write records with shifted timestamps.
+  std::string address_;
+};
+
+#endif  // LOG_MERGER_H_
@@ -0,0 +1,219 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Reader for log files written by the logger.
+
+#include "log_reader.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+#include "udp_message_wrapper.pb.h"
+#include "wire_decoder.h"
+
+// Number of offsets checked for a valid record per read while resynchronizing.
+static const size_t kScanSize = 1 << 22;
+
+// Returns true iff a serialized envelope has all the fields that the logger
+// writes.
+static bool IsValidEnvelope(const char* record, size_t size) {
+  EnvelopeView envelope;
+  return (DecodeEnvelope(record, size, &envelope) &&
+          envelope.address_size > 0 &&
+          envelope.port > 0 && envelope.port <= 65535 &&
+          envelope.timestamp > 0 &&
+          envelope.data != NULL);
+}
+
+const uint32_t LogReader::kDefaultMaxRecordSize;
+
+LogReader::LogReader() :
+    fid_(NULL), file_size_(0), offset_(0),
+    max_record_size_(kDefaultMaxRecordSize), recover_(false),
+    record_size_(0), status_(kEnd), record_offset_(0), skipped_bytes_(0),
+    skip_status_(kOk) {}
+
+LogReader::~LogReader() {
+  Close();
+}
+
+bool LogReader::Open(const std::string& file_name) {
+  Close();
+  fid_ = fopen(file_name.c_str(), "r");
+  if (fid_ == NULL) return false;
+  struct stat st;
+  file_size_ = (fstat(fileno(fid_), &st) == 0) ? st.st_size : 0;
+  return true;
+}
+
+void LogReader::Close() {
+  if (fid_ != NULL) fclose(fid_);
+  fid_ = NULL;
+  file_size_ = 0;
+  offset_ = 0;
+  record_size_ = 0;
+}
+
+void LogReader::Rewind() {
+  if (fid_ != NULL) rewind(fid_);
+  offset_ = 0;
+  record_size_ = 0;
+}
+
+uint64_t LogReader::Tell() const {
+  return offset_;
+}
+
+bool LogReader::Seek(uint64_t offset) {
+  record_size_ = 0;
+  if (fid_ == NULL ||
+      fseeko(fid_, static_cast<off_t>(offset), SEEK_SET) != 0) {
+    return false;
+  }
+  offset_ = offset;
+  return true;
+}
+
+LogReader::Status LogReader::ReadRecordAtOffset() {
+  uint32_t packet_size = 0;
+  const size_t num_read = fread(&packet_size, 1, sizeof(packet_size), fid_);
+  if (num_read < sizeof(packet_size)) {
+    if (ferror(fid_)) return kReadError;
+    return (num_read == 0) ? kEnd : kTruncated;
+  }
+  if (packet_size > max_record_size_) return kCorrupt;
+  if (buffer_.size() < packet_size) buffer_.resize(packet_size);
+  if (fread(buffer_.data(), 1, packet_size, fid_) != packet_size) {
+    return ferror(fid_) ? kReadError : kTruncated;
+  }
+  offset_ += sizeof(packet_size) + packet_size;
+  if (recover_ && !IsValidEnvelope(buffer_.data(), packet_size)) {
+    return kCorrupt;
+  }
+  record_size_ = packet_size;
+  return kOk;
+}
+
+bool LogReader::IsValidRecord(const char* data,
+                              size_t data_size,
+                              size_t offset,
+                              size_t* size) const {
+  uint32_t packet_size = 0;
+  if (data_size - offset < sizeof(packet_size)) return false;
+  memcpy(&packet_size, data + offset, sizeof(packet_size));
+  if (packet_size > max_record_size_ ||
+      packet_size > data_size - offset - sizeof(packet_size) ||
+      !IsValidEnvelope(data + offset + sizeof(packet_size), packet_size)) {
+    return false;
+  }
+  *size = sizeof(packet_size) + packet_size;
+  return true;
+}
+
+bool LogReader::FindRecord(uint64_t start, uint64_t* offset) {
+  // Every offset of a block is checked for a record and the next one, so
+  // blocks overlap by the size of two records.
+  const size_t max_size = sizeof(uint32_t) + max_record_size_;
+  for (uint64_t base = start; base < file_size_; base += kScanSize) {
+    const size_t size = static_cast<size_t>(
+        std::min<uint64_t>(file_size_ - base, kScanSize + 2 * max_size));
+    if (scan_buffer_.size() < size) scan_buffer_.resize(size);
+    if (fseeko(fid_, static_cast<off_t>(base), SEEK_SET) != 0 ||
+        fread(scan_buffer_.data(), 1, size, fid_) != size) {
+      return false;
+    }
+    const char* const data = scan_buffer_.data();
+    const bool at_end = (base + size == file_size_);
+    const size_t num_offsets = std::min(size, kScanSize);
+    for (size_t i = 0; i < num_offsets; ++i) {
+      size_t record_size = 0;
+      if (!IsValidRecord(data, size, i, &record_size)) continue;
+      const size_t next = i + record_size;
+      size_t next_size = 0;
+      uint32_t next_packet_size = 0;
+      if (size - next >= sizeof(next_packet_size)) {
+        memcpy(&next_packet_size, data + next, sizeof(next_packet_size));
+      }
+      // The next record is valid, or the log ends in the middle of a
+      // plausible one.
+      if (IsValidRecord(data, size, next, &next_size) ||
+          (at_end && next_packet_size <= max_record_size_ &&
+           next + sizeof(next_packet_size) + next_packet_size > size)) {
+        *offset = base + i;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool LogReader::ReadRecord() {
+  TRACE_SCOPE("read");
+  record_size_ = 0;
+  skipped_bytes_ = 0;
+  skip_status_ = kOk;
+  if (fid_ == NULL) {
+    status_ = kEnd;
+    return false;
+  }
+  while (true) {
+    record_offset_ = offset_;
+    status_ = ReadRecordAtOffset();
+    if (status_ == kOk || status_ == kEnd) return (status_ == kOk);
+    if (status_ == kReadError) {
+      perror("Error reading log");
+      return false;
+    }
+    if (!recover_) {
+      fprintf(stderr, "%s record at offset %" PRIu64 ", ignoring the rest of "
+              "the log\n",
+              (status_ == kTruncated) ? "Truncated" : "Corrupt",
+              record_offset_);
+      return false;
+    }
+    if (skip_status_ == kOk) skip_status_ = status_;
+    uint64_t next = file_size_;
+    if (!FindRecord(record_offset_ + 1, &next)) next = file_size_;
+    skipped_bytes_ += next - record_offset_;
+    if (!Seek(next)) {
+      status_ = kReadError;
+      perror("Error reading log");
+      return false;
+    }
+    if (next >= file_size_) {
+      record_offset_ = next;
+      status_ = skip_status_;
+      return false;
+    }
+  }
+}
+
+bool LogReader::Read(UDPMessageWrapper* message) {
+  if (!ReadRecord()) return false;
+  message->ParseFromArray(record(), record_size_);
+  return true;
+}
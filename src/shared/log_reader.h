@@ -0,0 +1,158 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Reader for log files written by the logger. A log is a sequence of
+// records, each a 32-bit packet size followed by a serialized
+// UDPMessageWrapper of that size.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#ifndef LOG_READER_H_
+#define LOG_READER_H_
+
+class UDPMessageWrapper;
+
+class LogReader {
+ public:
+  // Outcome of the last call to ReadRecord().
+  enum Status {
+    // A record was read.
+    kOk,
+    // The end of the log was reached after the last complete record.
+    kEnd,
+    // The log ends with a partial record.
+    kTruncated,
+    // A record is larger than the maximum record size or, in recovery mode,
+    // is not a valid UDPMessageWrapper.
+    kCorrupt,
+    // The file could not be read.
+    kReadError
+  };
+
+  // Default maximum size of a record. Records hold UDP datagrams of at most
+  // 64 kB, so larger packet sizes can only come from corrupt logs.
+  static const uint32_t kDefaultMaxRecordSize = 1 << 20;
+
+  LogReader();
+  ~LogReader();
+
+  // Open a log file for reading. Returns false on error.
+  bool Open(const std::string& file_name);
+
+  // Close the log file, if open.
+  void Close();
+
+  // Returns true iff a log file is open.
+  bool IsOpen() const { return (fid_ != NULL); }
+
+  // Go back to the first record of the log.
+  void Rewind();
+
+  // Returns the file offset of the next record to be read.
+  uint64_t Tell() const;
+
+  // Go to the record at a file offset returned by Tell(). Returns false on
+  // error.
+  bool Seek(uint64_t offset);
+
+  // Set the maximum size of a record. A packet size larger than this is
+  // treated as corruption, rather than allocating a buffer for it.
+  void set_max_record_size(uint32_t size) { max_record_size_ = size; }
+
+  // In recovery mode, every record is validated, and a truncated, oversized
+  // or invalid record is skipped by scanning forward to the next offset at
+  // which a valid record starts. A valid record is followed by the end of the
+  // log, or by another plausible record, and its envelope is a
+  // UDPMessageWrapper with an address, a port, a timestamp and data, as the
+  // logger writes them. Outside of recovery mode, the log ends at the first
+  // truncated or oversized record.
+  void set_recover(bool recover) { recover_ = recover; }
+
+  // Read the next serialized record. The record is valid until the next call.
+  // Returns false at the end of the log, on a read error, or, outside of
+  // recovery mode, at a damaged record; status() tells them apart.
+  bool ReadRecord();
+
+  // Read and parse the next record.
+  bool Read(UDPMessageWrapper* message);
+
+  // The last serialized record read.
+  const char* record() const { return buffer_.data(); }
+  size_t record_size() const { return record_size_; }
+
+  // Outcome of the last call to ReadRecord().
+  Status status() const { return status_; }
+
+  // File offset of the last record read. If ReadRecord() failed, the offset
+  // at which it stopped: the damaged record outside of recovery mode, or the
+  // end of the log.
+  uint64_t record_offset() const { return record_offset_; }
+
+  // In recovery mode, the number of bytes skipped by the last call to
+  // ReadRecord(), right before record_offset().
+  uint64_t skipped_bytes() const { return skipped_bytes_; }
+
+  // Status of the first damaged record of the bytes skipped by the last call
+  // to ReadRecord(), kOk if none were skipped.
+  Status skip_status() const { return skip_status_; }
+
+ private:
+  // Disable the copy constructor and assignment operator.
+  LogReader(const LogReader&);
+  void operator=(const LogReader&);
+
+  // Read and check the record at the current file offset.
+  Status ReadRecordAtOffset();
+
+  // Returns true iff a complete, valid record starts at data[offset], and
+  // sets *size to its size including the packet size.
+  bool IsValidRecord(const char* data,
+                     size_t data_size,
+                     size_t offset,
+                     size_t* size) const;
+
+  // Find the first offset at or after start at which a valid record starts,
+  // followed by the end of the log or another plausible record. Returns false
+  // if there is none.
+  bool FindRecord(uint64_t start, uint64_t* offset);
+
+  FILE* fid_;
+  uint64_t file_size_;
+  uint64_t offset_;
+  uint32_t max_record_size_;
+  bool recover_;
+
+  // Buffer for the serialized records. Only grows, so that reading a log
+  // does not allocate once the largest record has been seen.
+  std::vector<char> buffer_;
+
+  size_t record_size_;
+  Status status_;
+  uint64_t record_offset_;
+  uint64_t skipped_bytes_;
+  Status skip_status_;
+
+  // Buffer of the bytes scanned to resynchronize.
+  std::vector<char> scan_buffer_;
+};
+
+#endif  // LOG_READER_H_
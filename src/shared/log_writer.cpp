@@ -0,0 +1,79 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+//
+// Writer of log files in the format of the logger.
+
+#include "log_writer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "trace.h"
+#include "udp_message_wrapper.pb.h"
+
+LogWriter::LogWriter() : fid_(NULL), error_(false), bytes_written_(0) {}
+
+LogWriter::~LogWriter() {
+  Close();
+}
+
+bool LogWriter::Open(const std::string& file_name) {
+  Close();
+  fid_ = fopen(file_name.c_str(), "w");
+  error_ = false;
+  bytes_written_ = 0;
+  return (fid_ != NULL);
+}
+
+bool LogWriter::Close() {
+  if (fid_ == NULL) return true;
+  if (fclose(fid_) != 0) error_ = true;
+  fid_ = NULL;
+  return !error_;
+}
+
+bool LogWriter::WriteRecord(const char* record, size_t size) {
+  TRACE_SCOPE("write");
+  if (fid_ == NULL) return false;
+  // Write size of packet.
+  const uint32_t packet_size = size;
+  if (fwrite(&packet_size, sizeof(packet_size), 1, fid_) != 1 ||
+      fwrite(record, 1, size, fid_) != size) {
+    if (!error_) perror("Error writing log");
+    error_ = true;
+    return false;
+  }
+  bytes_written_ += sizeof(packet_size) + size;
+  return true;
+}
+
+bool LogWriter::Write(const std::string& address,
+                      int port,
+                      uint64_t timestamp,
+                      const char* data,
+                      size_t size) {
+  message_.set_address(address);
+  message_.set_port(port);
+  message_.set_timestamp(timestamp);
+  message_.mutable_data()->assign(data, size);
+  message_.SerializeToString(&buffer_);
+  return WriteRecord(buffer_.data(), buffer_.size());
+}
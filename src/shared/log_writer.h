@@ -0,0 +1,79 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+//
+// Writer of log files in the format of the logger: a sequence of records,
+// each a 32-bit packet size followed by a serialized UDPMessageWrapper of that
+// size.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "udp_message_wrapper.pb.h"
+
+#ifndef LOG_WRITER_H_
+#define LOG_WRITER_H_
+
+class LogWriter {
+ public:
+  LogWriter();
+  ~LogWriter();
+
+  // Open a log file for writing, replacing it if it exists. Returns false on
+  // error.
+  bool Open(const std::string& file_name);
+
+  // Close the log file, if open. Returns false if any write failed.
+  bool Close();
+
+  // Returns true iff a log file is open.
+  bool IsOpen() const { return (fid_ != NULL); }
+
+  // Write a serialized UDPMessageWrapper as the next record. Returns false on
+  // error.
+  bool WriteRecord(const char* record, size_t size);
+
+  // Write a datagram received from address:port at a timestamp, in
+  // microseconds, as the next record. Returns false on error.
+  bool Write(const std::string& address,
+             int port,
+             uint64_t timestamp,
+             const char* data,
+             size_t size);
+
+  // Number of bytes written to the log file.
+  uint64_t bytes_written() const { return bytes_written_; }
+
+ private:
+  // Disable the copy constructor and assignment operator.
+  LogWriter(const LogWriter&);
+  void operator=(const LogWriter&);
+
+  FILE* fid_;
+  bool error_;
+  uint64_t bytes_written_;
+
+  // Reused by Write(), so that writing does not allocate memory once the
+  // largest record has been written.
+  UDPMessageWrapper message_;
+  std::string buffer_;
+};
+
+#endif  // LOG_WRITER_H_
@@ -0,0 +1,255 @@
+#include "memory_transport.h"
+
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shared/util.h"
+
+namespace Net{
+
+//====================================================================//
+//  Net::MemoryTransport: In-process datagram delivery
+//====================================================================//
+// The per-endpoint queues are bounded multi-producer queues in the style of
+// D. Vyukov: each cell carries a sequence number that tells producers and
+// consumers whether it is free to be written or ready to be read, so that
+// only the queue positions need to be claimed with compare-and-swap.
+
+static uint64_t GetTimeMSec()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return((uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+
+MemoryTransport::MemoryTransport()
+{
+  endpoints = new Endpoint[MaxEndpoints];
+  for(int i=0; i<MaxEndpoints; i++){
+    Endpoint &e = endpoints[i];
+    e.state = Free;
+    e.senders = 0;
+    e.port = 0;
+    e.shared = false;
+    e.loopback = false;
+    e.blocking = false;
+    e.num_groups = 0;
+    e.enqueue_pos = 0;
+    e.dequeue_pos = 0;
+    for(int j=0; j<QueueSize; j++) e.queue[j].sequence = j;
+  }
+  dropped = 0;
+  pthread_mutex_init(&openMutex,NULL);
+}
+
+MemoryTransport::~MemoryTransport()
+{
+  pthread_mutex_destroy(&openMutex);
+  delete[](endpoints);
+}
+
+bool MemoryTransport::conflicts(int port,bool shared) const
+{
+  // port 0 is not bound, like an unbound socket
+  if(port == 0) return(false);
+  for(int i=0; i<MaxEndpoints; i++){
+    const Endpoint &e = endpoints[i];
+    if(__atomic_load_n(&e.state,__ATOMIC_SEQ_CST) != Free &&
+       e.port == port && !(shared && e.shared)){
+      return(true);
+    }
+  }
+  return(false);
+}
+
+int MemoryTransport::open(int port,bool share_port_for_multicasting,
+                          bool multicast_include_localhost,bool blocking)
+{
+  pthread_mutex_lock(&openMutex);
+  if(conflicts(port,share_port_for_multicasting)){
+    pthread_mutex_unlock(&openMutex);
+    fprintf(stderr,"MemoryTransport: port %d already in use\n",port);
+    return(-1);
+  }
+  for(int i=0; i<MaxEndpoints; i++){
+    Endpoint &e = endpoints[i];
+    int expected = Free;
+    if(__atomic_compare_exchange_n(&e.state,&expected,(int)Opening,false,
+                                   __ATOMIC_ACQUIRE,__ATOMIC_RELAXED)){
+      e.port = port;
+      e.shared = share_port_for_multicasting;
+      e.loopback = multicast_include_localhost;
+      e.blocking = blocking;
+      e.num_groups = 0;
+      __atomic_store_n(&e.state,(int)Open,__ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&openMutex);
+      return(i);
+    }
+  }
+  pthread_mutex_unlock(&openMutex);
+  fprintf(stderr,"MemoryTransport: no free endpoints\n");
+  return(-1);
+}
+
+// all endpoints are on the same host, so the interface does not matter
+bool MemoryTransport::addMulticast(int handle,const Address &multiaddr,
+                                   const Address & /*interface*/)
+{
+  if(handle < 0 || handle >= MaxEndpoints) return(false);
+  Endpoint &e = endpoints[handle];
+  const int n = e.num_groups;
+  if(n >= MaxGroups) return(false);
+  e.groups[n] = multiaddr.getInAddr();
+  __atomic_store_n(&e.num_groups,n+1,__ATOMIC_RELEASE);
+  return(true);
+}
+
+void MemoryTransport::close(int handle)
+{
+  if(handle < 0 || handle >= MaxEndpoints) return;
+  Endpoint &e = endpoints[handle];
+  __atomic_store_n(&e.state,(int)Closing,__ATOMIC_SEQ_CST);
+  // wait for senders that saw the endpoint open to finish delivering
+  while(__atomic_load_n(&e.senders,__ATOMIC_SEQ_CST) > 0) sched_yield();
+  e.num_groups = 0;
+  e.enqueue_pos = 0;
+  e.dequeue_pos = 0;
+  for(int j=0; j<QueueSize; j++) e.queue[j].sequence = j;
+  __atomic_store_n(&e.state,(int)Free,__ATOMIC_RELEASE);
+}
+
+bool MemoryTransport::accepts(const Endpoint &e,const Address &dest) const
+{
+  if(e.port != dest.getPort()) return(false);
+  const in_addr_t addr = dest.getInAddr();
+  if(!IN_MULTICAST(ntohl(addr))) return(true);
+  const int n = __atomic_load_n(&e.num_groups,__ATOMIC_ACQUIRE);
+  for(int i=0; i<n; i++){
+    if(e.groups[i] == addr) return(true);
+  }
+  return(false);
+}
+
+bool MemoryTransport::enqueue(Endpoint &e,int src_port,
+                              const void *data,int length)
+{
+  uint64_t pos = __atomic_load_n(&e.enqueue_pos,__ATOMIC_RELAXED);
+  Datagram *cell = NULL;
+  while(true){
+    cell = &e.queue[pos & (QueueSize - 1)];
+    const uint64_t seq = __atomic_load_n(&cell->sequence,__ATOMIC_ACQUIRE);
+    const int64_t diff = (int64_t)seq - (int64_t)pos;
+    if(diff == 0){
+      if(__atomic_compare_exchange_n(&e.enqueue_pos,&pos,pos+1,true,
+                                     __ATOMIC_RELAXED,__ATOMIC_RELAXED)){
+        break;
+      }
+    }else if(diff < 0){
+      // queue full
+      return(false);
+    }else{
+      pos = __atomic_load_n(&e.enqueue_pos,__ATOMIC_RELAXED);
+    }
+  }
+  cell->src_port = src_port;
+  cell->data.assign((const char*)data,length);
+  __atomic_store_n(&cell->sequence,pos+1,__ATOMIC_RELEASE);
+  return(true);
+}
+
+bool MemoryTransport::dequeue(Endpoint &e,void *data,int &length,
+                              int &src_port)
+{
+  uint64_t pos = __atomic_load_n(&e.dequeue_pos,__ATOMIC_RELAXED);
+  Datagram *cell = NULL;
+  while(true){
+    cell = &e.queue[pos & (QueueSize - 1)];
+    const uint64_t seq = __atomic_load_n(&cell->sequence,__ATOMIC_ACQUIRE);
+    const int64_t diff = (int64_t)seq - (int64_t)(pos+1);
+    if(diff == 0){
+      if(__atomic_compare_exchange_n(&e.dequeue_pos,&pos,pos+1,true,
+                                     __ATOMIC_RELAXED,__ATOMIC_RELAXED)){
+        break;
+      }
+    }else if(diff < 0){
+      // queue empty
+      return(false);
+    }else{
+      pos = __atomic_load_n(&e.dequeue_pos,__ATOMIC_RELAXED);
+    }
+  }
+  // like recvfrom(), truncate datagrams larger than the buffer
+  length = min(length,(int)cell->data.size());
+  memcpy(data,cell->data.data(),length);
+  src_port = cell->src_port;
+  __atomic_store_n(&cell->sequence,pos+QueueSize,__ATOMIC_RELEASE);
+  return(true);
+}
+
+bool MemoryTransport::empty(const Endpoint &e) const
+{
+  const uint64_t pos = __atomic_load_n(&e.dequeue_pos,__ATOMIC_RELAXED);
+  const Datagram &cell = e.queue[pos & (QueueSize - 1)];
+  return(__atomic_load_n(&cell.sequence,__ATOMIC_ACQUIRE) != pos+1);
+}
+
+int MemoryTransport::send(int handle,const void *data,int length,
+                          const Address &dest)
+{
+  if(handle < 0 || handle >= MaxEndpoints) return(-1);
+  const int src_port = endpoints[handle].port;
+  // like IP_MULTICAST_LOOP, only loop multicast back to the sender if asked
+  const bool skip_self = !endpoints[handle].loopback &&
+                         IN_MULTICAST(ntohl(dest.getInAddr()));
+  for(int i=0; i<MaxEndpoints; i++){
+    if(skip_self && i == handle) continue;
+    Endpoint &e = endpoints[i];
+    __atomic_add_fetch(&e.senders,1,__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&e.state,__ATOMIC_SEQ_CST) == Open &&
+       accepts(e,dest) &&
+       !enqueue(e,src_port,data,length)){
+      __atomic_add_fetch(&dropped,1,__ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&e.senders,1,__ATOMIC_SEQ_CST);
+  }
+  return(length);
+}
+
+int MemoryTransport::recv(int handle,void *data,int length,Address &src)
+{
+  if(handle < 0 || handle >= MaxEndpoints) return(-1);
+  Endpoint &e = endpoints[handle];
+  int src_port = 0;
+  while(!dequeue(e,data,length,src_port)){
+    if(!e.blocking) return(-1);
+    wait(handle,-1);
+  }
+  src.setInAddr(htonl(INADDR_LOOPBACK),src_port);
+  return(length);
+}
+
+bool MemoryTransport::wait(int handle,int timeout_ms) const
+{
+  // polling interval while waiting, in microseconds
+  static const int PollPeriod = 50;
+  if(handle < 0 || handle >= MaxEndpoints) return(false);
+  const Endpoint &e = endpoints[handle];
+  const uint64_t t_start = GetTimeMSec();
+  while(empty(e)){
+    if(timeout_ms == 0) return(false);
+    if(timeout_ms > 0 && GetTimeMSec() - t_start >= (uint64_t)timeout_ms){
+      return(false);
+    }
+    usleep(PollPeriod);
+  }
+  return(true);
+}
+
+uint64_t MemoryTransport::getDropped() const
+{
+  return(__atomic_load_n(&dropped,__ATOMIC_RELAXED));
+}
+
+}; // namespace Net
@@ -0,0 +1,99 @@
+#ifndef _INCLUDED_MEMORY_TRANSPORT_H_
+#define _INCLUDED_MEMORY_TRANSPORT_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "netraw.h"
+
+namespace Net{
+
+//====================================================================//
+//  Net::MemoryTransport: In-process datagram delivery
+//====================================================================//
+// Delivers datagrams between Net::UDP instances of the same process,
+// without any network. A datagram sent to a port is delivered to every
+// endpoint opened on that port, provided that the endpoint joined the
+// multicast group if the destination is a multicast address. Each endpoint
+// has a bounded lock-free queue; like UDP, datagrams sent to a full queue
+// are dropped.
+//
+// As with sockets, a port can only be opened again if every endpoint on it
+// shares the port for multicasting, and multicast datagrams are only
+// delivered back to the sending endpoint if it includes the localhost.
+//
+// Endpoints may be opened and closed by any thread, but each endpoint
+// should only be read from by one thread at a time.
+
+class MemoryTransport : public Transport{
+public:
+  // Maximum number of open endpoints.
+  static const int MaxEndpoints = 64;
+  // Maximum number of multicast groups joined by an endpoint.
+  static const int MaxGroups = 8;
+  // Number of datagrams each endpoint can queue, a power of two.
+  static const int QueueSize = 1024;
+
+  MemoryTransport();
+  ~MemoryTransport();
+
+  int open(int port,bool share_port_for_multicasting,
+           bool multicast_include_localhost,bool blocking);
+  bool addMulticast(int handle,const Address &multiaddr,
+                    const Address &interface);
+  void close(int handle);
+  int send(int handle,const void *data,int length,const Address &dest);
+  int recv(int handle,void *data,int length,Address &src);
+  bool wait(int handle,int timeout_ms) const;
+
+  // Number of datagrams dropped because a queue was full.
+  uint64_t getDropped() const;
+
+private:
+  struct Datagram{
+    uint64_t sequence;
+    int src_port;
+    std::string data;
+  };
+
+  struct Endpoint{
+    // One of the State values below.
+    int state;
+    // Number of senders currently delivering to this endpoint.
+    int senders;
+    int port;
+    bool shared;
+    bool loopback;
+    bool blocking;
+    int num_groups;
+    in_addr_t groups[MaxGroups];
+    // Queue of received datagrams, see enqueue() and dequeue().
+    uint64_t enqueue_pos;
+    uint64_t dequeue_pos;
+    Datagram queue[QueueSize];
+  };
+
+  enum State{
+    Free = 0,
+    Opening = 1,
+    Open = 2,
+    Closing = 3
+  };
+
+  bool conflicts(int port,bool shared) const;
+  bool accepts(const Endpoint &e,const Address &dest) const;
+  bool enqueue(Endpoint &e,int src_port,const void *data,int length);
+  bool dequeue(Endpoint &e,void *data,int &length,int &src_port);
+  bool empty(const Endpoint &e) const;
+
+  Endpoint *endpoints;
+  uint64_t dropped;
+  // Serializes open(), so that two endpoints cannot claim the same port.
+  pthread_mutex_t openMutex;
+};
+
+}; // namespace Net
+
+#endif
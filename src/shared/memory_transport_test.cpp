@@ -0,0 +1,327 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Tests of the in-process datagram delivery of MemoryTransport: the port and
+// multicast loopback semantics of sockets, and its multi-producer queues
+// when full, with concurrent senders, and with endpoints closed and reopened
+// while datagrams are being sent to them.
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "shared/memory_transport.h"
+#include "shared/netraw.h"
+
+using Net::Address;
+using Net::MemoryTransport;
+using std::vector;
+
+// Multicast group and port of the test datagrams.
+static const char* kGroup = "224.5.23.2";
+static const int kPort = 10006;
+
+// Number of concurrent senders, and of datagrams sent by each unless they
+// are stopped.
+static const int kNumSenders = 4;
+static const int kDatagramsPerSender = 50000;
+
+// Number of times an endpoint is closed and reopened while senders are
+// sending to it.
+static const int kNumReopens = 500;
+
+static int num_failures = 0;
+
+// Record a failure if condition is false.
+void Expect(bool condition, const char* what, int line) {
+  if (condition) return;
+  fprintf(stderr, "Line %d: expected %s\n", line, what);
+  ++num_failures;
+}
+
+#define EXPECT(condition) Expect((condition), #condition, __LINE__)
+
+// A test datagram: the sender, its sequence number, and a filler derived from
+// both, so that torn or mixed up datagrams are detected.
+struct TestDatagram {
+  TestDatagram() : sender(0), sequence(0) {
+    memset(filler, 0, sizeof(filler));
+  }
+
+  TestDatagram(uint32_t sender, uint32_t sequence) :
+      sender(sender), sequence(sequence) {
+    for (size_t i = 0; i < sizeof(filler); ++i) {
+      filler[i] = static_cast<uint8_t>(sender * 31 + sequence + i);
+    }
+  }
+
+  // Returns true iff the filler matches the sender and sequence number.
+  bool IsValid() const {
+    for (size_t i = 0; i < sizeof(filler); ++i) {
+      if (filler[i] != static_cast<uint8_t>(sender * 31 + sequence + i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint32_t sender;
+  uint32_t sequence;
+  uint8_t filler[120];
+};
+
+Address GroupAddress() {
+  Address address;
+  address.setInAddr(inet_addr(kGroup), kPort);
+  return address;
+}
+
+// Open an endpoint on the test port that joined the test group. Returns its
+// handle, or -1 on failure.
+int OpenReceiver(MemoryTransport* transport, bool loopback, bool blocking) {
+  const int handle = transport->open(kPort, true, loopback, blocking);
+  if (handle < 0) return -1;
+  Address any;
+  any.setAny();
+  transport->addMulticast(handle, GroupAddress(), any);
+  return handle;
+}
+
+// Returns the number of datagrams queued on an endpoint, and receives them,
+// without blocking.
+int Drain(MemoryTransport* transport, int handle) {
+  TestDatagram datagram;
+  Address source;
+  int num_received = 0;
+  while (transport->wait(handle, 0) &&
+         transport->recv(handle, &datagram, sizeof(datagram), source) >= 0) {
+    ++num_received;
+  }
+  return num_received;
+}
+
+void TestPortSharing() {
+  MemoryTransport transport;
+  const int exclusive = transport.open(kPort, false, false, false);
+  EXPECT(exclusive >= 0);
+  EXPECT(transport.open(kPort, false, false, false) < 0);
+  EXPECT(transport.open(kPort, true, false, false) < 0);
+  transport.close(exclusive);
+  const int shared1 = transport.open(kPort, true, false, false);
+  const int shared2 = transport.open(kPort, true, false, false);
+  EXPECT(shared1 >= 0);
+  EXPECT(shared2 >= 0);
+  EXPECT(transport.open(kPort, false, false, false) < 0);
+  // Unbound endpoints never conflict.
+  const int unbound1 = transport.open(0, false, false, false);
+  const int unbound2 = transport.open(0, false, false, false);
+  EXPECT(unbound1 >= 0);
+  EXPECT(unbound2 >= 0);
+  transport.close(shared1);
+  transport.close(shared2);
+  transport.close(unbound1);
+  transport.close(unbound2);
+  EXPECT(transport.open(kPort, false, false, false) >= 0);
+}
+
+void TestMulticastLoopback() {
+  MemoryTransport transport;
+  const int quiet = OpenReceiver(&transport, false, false);
+  const int loopback = OpenReceiver(&transport, true, false);
+  const int other = OpenReceiver(&transport, false, false);
+  EXPECT(quiet >= 0 && loopback >= 0 && other >= 0);
+  const TestDatagram datagram(0, 0);
+  transport.send(quiet, &datagram, sizeof(datagram), GroupAddress());
+  EXPECT(Drain(&transport, quiet) == 0);
+  EXPECT(Drain(&transport, loopback) == 1);
+  EXPECT(Drain(&transport, other) == 1);
+  transport.send(loopback, &datagram, sizeof(datagram), GroupAddress());
+  EXPECT(Drain(&transport, quiet) == 1);
+  EXPECT(Drain(&transport, loopback) == 1);
+  EXPECT(Drain(&transport, other) == 1);
+  // Unicast datagrams are delivered to the sender, as with sockets.
+  Address unicast;
+  unicast.setInAddr(htonl(INADDR_LOOPBACK), kPort);
+  transport.send(quiet, &datagram, sizeof(datagram), unicast);
+  EXPECT(Drain(&transport, quiet) == 1);
+}
+
+void TestFullQueue() {
+  static const int kExtra = 10;
+  MemoryTransport transport;
+  const int sender = transport.open(0, false, false, false);
+  const int receiver = OpenReceiver(&transport, false, false);
+  // Fill the queue several times, so that its positions wrap around.
+  for (int pass = 0; pass < 3; ++pass) {
+    for (int i = 0; i < MemoryTransport::QueueSize + kExtra; ++i) {
+      const TestDatagram datagram(0, i);
+      EXPECT(transport.send(sender, &datagram, sizeof(datagram),
+                            GroupAddress()) ==
+             static_cast<int>(sizeof(datagram)));
+    }
+    EXPECT(transport.getDropped() ==
+           static_cast<uint64_t>((pass + 1) * kExtra));
+    TestDatagram datagram;
+    Address source;
+    bool in_order = true;
+    for (int i = 0; i < MemoryTransport::QueueSize; ++i) {
+      const int size =
+          transport.recv(receiver, &datagram, sizeof(datagram), source);
+      in_order = in_order && size == static_cast<int>(sizeof(datagram)) &&
+          datagram.IsValid() && datagram.sequence == static_cast<uint32_t>(i);
+    }
+    EXPECT(in_order);
+    EXPECT(!transport.wait(receiver, 0));
+    EXPECT(transport.recv(receiver, &datagram, sizeof(datagram), source) < 0);
+  }
+}
+
+struct SenderArgs {
+  MemoryTransport* transport;
+  uint32_t id;
+  // If not NULL, send until it is set instead of kDatagramsPerSender times.
+  const bool* stop;
+};
+
+// Send datagrams to the test group.
+void* SenderThread(void* pointer) {
+  const SenderArgs& args = *static_cast<SenderArgs*>(pointer);
+  const int handle = args.transport->open(0, false, false, false);
+  for (uint32_t i = 0;
+       (args.stop == NULL) ? (i < kDatagramsPerSender) :
+                             !__atomic_load_n(args.stop, __ATOMIC_ACQUIRE);
+       ++i) {
+    const TestDatagram datagram(args.id, i);
+    args.transport->send(handle, &datagram, sizeof(datagram), GroupAddress());
+  }
+  args.transport->close(handle);
+  return NULL;
+}
+
+// Start the sender threads.
+void StartSenders(MemoryTransport* transport,
+                  const bool* stop,
+                  vector<pthread_t>* threads,
+                  vector<SenderArgs>* args) {
+  threads->resize(kNumSenders);
+  args->resize(kNumSenders);
+  for (int i = 0; i < kNumSenders; ++i) {
+    (*args)[i].transport = transport;
+    (*args)[i].id = i;
+    (*args)[i].stop = stop;
+    pthread_create(&((*threads)[i]), NULL, SenderThread, &((*args)[i]));
+  }
+}
+
+void JoinSenders(const vector<pthread_t>& threads) {
+  for (size_t i = 0; i < threads.size(); ++i) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+void TestConcurrentSenders() {
+  MemoryTransport transport;
+  const int receiver = OpenReceiver(&transport, false, true);
+  vector<pthread_t> threads;
+  vector<SenderArgs> args;
+  StartSenders(&transport, NULL, &threads, &args);
+  // Every datagram is received or dropped, each sender's in the order sent.
+  vector<int64_t> last_sequence(kNumSenders, -1);
+  uint64_t num_received = 0;
+  bool valid = true;
+  bool in_order = true;
+  TestDatagram datagram;
+  Address source;
+  const uint64_t num_sent =
+      static_cast<uint64_t>(kNumSenders) * kDatagramsPerSender;
+  while (num_received + transport.getDropped() < num_sent) {
+    if (!transport.wait(receiver, 1000)) break;
+    if (transport.recv(receiver, &datagram, sizeof(datagram), source) !=
+        static_cast<int>(sizeof(datagram)) ||
+        !datagram.IsValid() || datagram.sender >= kNumSenders) {
+      valid = false;
+      continue;
+    }
+    in_order = in_order &&
+        static_cast<int64_t>(datagram.sequence) >
+        last_sequence[datagram.sender];
+    last_sequence[datagram.sender] = datagram.sequence;
+    ++num_received;
+  }
+  JoinSenders(threads);
+  num_received += Drain(&transport, receiver);
+  EXPECT(valid);
+  EXPECT(in_order);
+  EXPECT(num_received + transport.getDropped() == num_sent);
+  EXPECT(num_received > 0);
+}
+
+void TestReopenWhileSending() {
+  MemoryTransport transport;
+  vector<pthread_t> threads;
+  vector<SenderArgs> args;
+  bool stop = false;
+  StartSenders(&transport, &stop, &threads, &args);
+  bool valid = true;
+  bool opened = true;
+  uint64_t num_received = 0;
+  for (int i = 0; i < kNumReopens; ++i) {
+    const int receiver = OpenReceiver(&transport, false, false);
+    opened = opened && receiver >= 0;
+    if (receiver < 0) continue;
+    TestDatagram datagram;
+    Address source;
+    for (int j = 0; j < 10; ++j) {
+      if (!transport.wait(receiver, 10)) continue;
+      const int size =
+          transport.recv(receiver, &datagram, sizeof(datagram), source);
+      if (size < 0) continue;
+      valid = valid && size == static_cast<int>(sizeof(datagram)) &&
+          datagram.IsValid();
+      ++num_received;
+    }
+    transport.close(receiver);
+  }
+  __atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+  JoinSenders(threads);
+  EXPECT(valid);
+  EXPECT(opened);
+  EXPECT(num_received > 0);
+  // A reopened endpoint starts empty.
+  const int receiver = OpenReceiver(&transport, false, false);
+  EXPECT(receiver >= 0);
+  EXPECT(Drain(&transport, receiver) == 0);
+}
+
+int main(int argc, char* argv[]) {
+  TestPortSharing();
+  TestMulticastLoopback();
+  TestFullQueue();
+  TestConcurrentSenders();
+  TestReopenWhileSending();
+  if (num_failures > 0) {
+    fprintf(stderr, "%d checks failed\n", num_failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
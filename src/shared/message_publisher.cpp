@@ -0,0 +1,105 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Publishing of the messages of a log to the network, as playback does.
+
+#include "message_publisher.h"
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "netraw.h"
+#include "trace.h"
+
+using std::make_pair;
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+MessagePublisher::MessagePublisher(Net::Transport* transport) :
+    udp_((transport != NULL) ? transport : Net::Transport::getDefault()) {}
+
+bool MessagePublisher::Open() {
+  return udp_.open();
+}
+
+void MessagePublisher::AddTarget(const PlaybackTarget& target) {
+  targets_.push_back(target);
+  destinations_.clear();
+}
+
+void MessagePublisher::AddRemap(const RemapRule& remap) {
+  remaps_.push_back(remap);
+  destinations_.clear();
+}
+
+const vector<Net::Address>& MessagePublisher::GetDestinations(
+    const string& original_host, int original_port) {
+  const pair<string, int> key = make_pair(original_host, original_port);
+  map<pair<string, int>, vector<Net::Address> >::iterator it =
+      destinations_.find(key);
+  if (it != destinations_.end()) return it->second;
+  vector<Net::Address>& destinations = destinations_[key];
+  string host = original_host;
+  int port = original_port;
+  for (size_t i = 0; i < remaps_.size(); ++i) {
+    const RemapRule& remap = remaps_[i];
+    if (remap.from.Matches(host.data(), host.size(), port)) {
+      if (!remap.to.address.empty()) host = remap.to.address;
+      if (remap.to.port != 0) port = remap.to.port;
+      break;
+    }
+  }
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    const PlaybackTarget& target = targets_[i];
+    const string& target_host =
+        target.address.empty() ? host : target.address;
+    Net::Address address;
+    if (!address.setHost(target_host.c_str(), port + target.port_offset)) {
+      fprintf(stderr, "Unable to resolve %s\n", target_host.c_str());
+    }
+    destinations.push_back(address);
+  }
+  return destinations;
+}
+
+bool MessagePublisher::PublishDatagram(const char* data,
+                                       size_t size,
+                                       const string& host,
+                                       int port) {
+  TRACE_SCOPE("publish");
+  const vector<Net::Address>& destinations = GetDestinations(host, port);
+  bool success = true;
+  for (size_t i = 0; i < destinations.size(); ++i) {
+    if (!udp_.send(data, size, destinations[i])) {
+      perror("Sendto Error");
+      fprintf(stderr, "Sending UDP datagram to ");
+      destinations[i].print(stderr);
+      fprintf(stderr,
+              " failed (maybe too large?). Size was: %zu byte(s)\n",
+              size);
+      success = false;
+    }
+  }
+  return success;
+}
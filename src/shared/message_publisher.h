@@ -0,0 +1,124 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Publishing of the messages of a log to the network, as playback does.
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "netraw.h"
+#include "wire_decoder.h"
+
+#ifndef MESSAGE_PUBLISHER_H_
+#define MESSAGE_PUBLISHER_H_
+
+// Destination of played back messages. Messages are sent to the target
+// address, or to their original address if it is empty, with their original
+// port offset by port_offset.
+struct PlaybackTarget {
+  PlaybackTarget() : port_offset(0) {}
+
+  // Unicast or multicast address, or empty to keep the original address.
+  std::string address;
+
+  // Offset added to the original port number.
+  int port_offset;
+};
+
+// Pattern matching streams by address and/or port.
+struct StreamPattern {
+  StreamPattern() : port(0) {}
+
+  // Returns true iff the stream address:port matches the pattern.
+  bool Matches(const char* stream_address,
+               size_t stream_address_size,
+               int stream_port) const {
+    return ((port == 0 || port == stream_port) &&
+            (address.empty() ||
+             (address.size() == stream_address_size &&
+              memcmp(address.data(), stream_address, stream_address_size) ==
+                  0)));
+  }
+
+  // Address to match, or empty to match any address.
+  std::string address;
+
+  // Port to match, or zero to match any port.
+  int port;
+};
+
+// Rule to play back a stream to a different address and/or port.
+struct RemapRule {
+  // Streams to remap.
+  StreamPattern from;
+
+  // New address and port of the streams. Empty address or zero port keep the
+  // original address or port.
+  StreamPattern to;
+};
+
+// Publishes messages originally sent to an address and port to every target,
+// after applying the first matching remap rule. The destination addresses of
+// every original address and port are only resolved the first time.
+class MessagePublisher {
+ public:
+  // Publishes over the default transport of Net::UDP, or over transport if it
+  // is not NULL. The transport must outlive the publisher.
+  explicit MessagePublisher(Net::Transport* transport = NULL);
+
+  // Open the UDP endpoint to publish from. Returns false on error.
+  bool Open();
+
+  // Add a target or a remap rule. Remap rules apply in the order in which
+  // they were added.
+  void AddTarget(const PlaybackTarget& target);
+  void AddRemap(const RemapRule& remap);
+
+  int num_targets() const { return static_cast<int>(targets_.size()); }
+
+  // Publish a datagram originally sent to host:port to every target. Errors
+  // are printed. Returns false if it could not be sent to some target.
+  bool PublishDatagram(const char* data,
+                       size_t size,
+                       const std::string& host,
+                       int port);
+
+  // Publish the datagram of a record of a log.
+  bool Publish(const EnvelopeView& message) {
+    return PublishDatagram(
+        message.data, message.data_size, message.Address(), message.port);
+  }
+
+ private:
+  // Returns the addresses to send a message originally sent to host:port to,
+  // one for every target.
+  const std::vector<Net::Address>& GetDestinations(
+      const std::string& original_host, int original_port);
+
+  Net::UDP udp_;
+  std::vector<RemapRule> remaps_;
+  std::vector<PlaybackTarget> targets_;
+  std::map<std::pair<std::string, int>, std::vector<Net::Address> >
+      destinations_;
+};
+
+#endif  // MESSAGE_PUBLISHER_H_
@@ -23,9 +23,13 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <time.h>
 
+#include <string>
+#include <vector>
+
 ScopedFile::ScopedFile(FILE* fid) : fid_(fid) {}
 
 ScopedFile::ScopedFile(const std::string& file_name,
@@ -70,11 +74,73 @@ uint64_t GetTimeUSec() {
   return (seconds * 1000000 + useconds);
 }
 
+uint64_t GetMonotonicTimeNSec() {
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec);
+}
+
 bool FileExists(const std::string& file_name) {
   struct stat st;
   return(stat(file_name.c_str(), &st) == 0);
 }
 
+bool GetFileStatus(const std::string& file_name,
+                   uint64_t* size,
+                   int64_t* mtime) {
+  struct stat st;
+  if (stat(file_name.c_str(), &st) != 0) return false;
+  *size = st.st_size;
+  *mtime = static_cast<int64_t>(st.st_mtime) * 1000000000LL +
+      st.st_mtim.tv_nsec;
+  return true;
+}
+
+// Hash state of Hash64, updated with 8 bytes at a time.
+static uint64_t HashMix(uint64_t hash, uint64_t word) {
+  hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+  return (hash ^ (hash >> 29));
+}
+
+// Continue a Hash64 over more data. The size must be a multiple of 8, except
+// for the last call.
+static uint64_t HashUpdate(uint64_t hash, const char* data, size_t size) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word = 0;
+    memcpy(&word, data + i, 8);
+    hash = HashMix(hash, word);
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, data + i, size - i);
+    hash = HashMix(hash, word ^ (static_cast<uint64_t>(size - i) << 56));
+  }
+  return hash;
+}
+
+uint64_t Hash64(const char* data, size_t size) {
+  return HashMix(HashUpdate(0xCBF29CE484222325ULL, data, size), size);
+}
+
+bool HashFile(const std::string& file_name, uint64_t* hash) {
+  static const size_t kBlockSize = 1 << 20;
+  ScopedFile fid(file_name, "rb");
+  if (fid() == NULL) return false;
+  std::vector<char> buffer(kBlockSize);
+  uint64_t state = 0xCBF29CE484222325ULL;
+  uint64_t size = 0;
+  size_t num_read = 0;
+  do {
+    num_read = fread(buffer.data(), 1, kBlockSize, fid);
+    state = HashUpdate(state, buffer.data(), num_read);
+    size += num_read;
+  } while (num_read == kBlockSize);
+  if (ferror(fid)) return false;
+  *hash = HashMix(state, size);
+  return true;
+}
+
 std::string StringPrintf(const char* format, ...) {
   va_list al;
   int string_length = 0;
@@ -70,9 +70,50 @@ private:
 // Get timestamp as reported by gettimeofday, in number of microseconds
 uint64_t GetTimeUSec();
 
+// Get the time of a monotonic clock, in nanoseconds, to measure durations.
+uint64_t GetMonotonicTimeNSec();
+
 // Returns truee iff the file specified exists in the file system.
 bool FileExists(const std::string& file_name);
 
+// Get the size of a file, and its modification time in nanoseconds. Returns
+// false on error.
+bool GetFileStatus(const std::string& file_name,
+                   uint64_t* size,
+                   int64_t* mtime);
+
+// Returns a 64-bit hash of a byte string. Not suitable for cryptography.
+uint64_t Hash64(const char* data, size_t size);
+
+// Compute the Hash64 of the contents of a file. Returns false on error.
+bool HashFile(const std::string& file_name, uint64_t* hash);
+
+// SplitMix64 pseudo-random number generator. Not suitable for cryptography.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31));
+  }
+
+  // Returns a uniformly distributed integer in [0, n).
+  uint32_t Uniform(uint32_t n) {
+    return static_cast<uint32_t>(((Next() >> 32) * n) >> 32);
+  }
+
+  // Returns a uniformly distributed real number in [0, 1).
+  double UniformReal() {
+    return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+ private:
+  uint64_t state_;
+};
+
 // Return an std::string created using a printf-like syntax.
 std::string StringPrintf(const char* format, ...)
     __attribute__((format(__printf__,1,2)));
@@ -52,12 +52,28 @@ void Address::setAny(int port)
   addr_len = sizeof(sockaddr_in);
 }
 
+void Address::setInAddr(in_addr_t in_addr,int port)
+{
+  mzero(addr);
+  sockaddr_in *s = (sockaddr_in*)(&addr);
+  s->sin_family = AF_INET;
+  s->sin_addr.s_addr = in_addr;
+  s->sin_port = htons(port);
+  addr_len = sizeof(sockaddr_in);
+}
+
 in_addr_t Address::getInAddr() const
 {
   const sockaddr_in *s = (sockaddr_in*)(&addr);
   return(s->sin_addr.s_addr);
 }
 
+int Address::getPort() const
+{
+  const sockaddr_in *s = (sockaddr_in*)(&addr);
+  return(ntohs(s->sin_port));
+}
+
 void Address::print(FILE *out) const
 {
   if(!addr_len){
@@ -78,17 +94,40 @@ void Address::print(FILE *out) const
 }
 
 //====================================================================//
-//  Net::UDP: Simple raw UDP messaging
+//  Net::Transport: Datagram delivery used by Net::UDP
+//====================================================================//
+
+static Transport *default_transport = NULL;
+
+Transport *Transport::getDefault()
+{
+  if(default_transport == NULL) return(SocketTransport::instance());
+  return(default_transport);
+}
+
+void Transport::setDefault(Transport *transport)
+{
+  default_transport = transport;
+}
+
+//====================================================================//
+//  Net::SocketTransport: Datagram delivery over UDP sockets
 //  (C) James Bruce
 //====================================================================//
 
-bool UDP::open(int port, bool share_port_for_multicasting, bool multicast_include_localhost, bool blocking)
+SocketTransport *SocketTransport::instance()
+{
+  static SocketTransport transport;
+  return(&transport);
+}
+
+int SocketTransport::open(int port, bool share_port_for_multicasting, bool multicast_include_localhost, bool blocking)
 {
   const int TTL = 32;
   
   // open the socket
-  if(fd >= 0) ::close(fd);
-  fd = socket(PF_INET, SOCK_DGRAM, 0);
+  int fd = socket(PF_INET, SOCK_DGRAM, 0);
+  if(fd < 0) return(-1);
 
   // set socket as non-blocking
   int flags = fcntl(fd, F_GETFL, 0);
@@ -120,7 +159,8 @@ bool UDP::open(int port, bool share_port_for_multicasting, bool multicast_includ
   if(ret != 0)
   {
     printf("ERROR %d WHEN SETTING IP_MULTICAST_TTL\n", ret);
-    return false;
+    ::close(fd);
+    return(-1);
   }
 
   // bind socket to port if nonzero
@@ -141,10 +181,10 @@ bool UDP::open(int port, bool share_port_for_multicasting, bool multicast_includ
   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
   */
 
-  return(true);
+  return(fd);
 }
 
-bool UDP::addMulticast(const Address &multiaddr,const Address &interface)
+bool SocketTransport::addMulticast(int fd,const Address &multiaddr,const Address &interface)
 {
   static const bool debug = false;
   struct ip_mreq imreq;
@@ -171,9 +211,53 @@ bool UDP::addMulticast(const Address &multiaddr,const Address &interface)
   return(ret == 0);
 }
 
+void SocketTransport::close(int fd)
+{
+  ::close(fd);
+}
+
+int SocketTransport::send(int fd,const void *data,int length,const Address &dest)
+{
+  return(sendto(fd,data,length,0,&dest.addr,dest.addr_len));
+}
+
+int SocketTransport::recv(int fd,void *data,int length,Address &src)
+{
+  src.addr_len = sizeof(src.addr);
+  return(recvfrom(fd,data,length,0,&src.addr,&src.addr_len));
+}
+
+bool SocketTransport::wait(int fd,int timeout_ms) const
+{
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  return(poll(&pfd,1,timeout_ms) == 1);
+}
+
+//====================================================================//
+//  Net::UDP: Simple raw UDP messaging
+//  (C) James Bruce
+//====================================================================//
+
+bool UDP::open(int port, bool share_port_for_multicasting, bool multicast_include_localhost, bool blocking)
+{
+  if(fd >= 0) transport->close(fd);
+  fd = transport->open(port,share_port_for_multicasting,
+                       multicast_include_localhost,blocking);
+  return(fd >= 0);
+}
+
+bool UDP::addMulticast(const Address &multiaddr,const Address &interface)
+{
+  return(transport->addMulticast(fd,multiaddr,interface));
+}
+
 void UDP::close()
 {
-  if(fd >= 0) ::close(fd);
+  if(fd >= 0) transport->close(fd);
   fd = -1;
 
   sent_packets = 0;
@@ -184,7 +268,7 @@ void UDP::close()
 
 bool UDP::send(const void *data,int length,const Address &dest)
 {
-  int len = sendto(fd,data,length,0,&dest.addr,dest.addr_len);
+  int len = transport->send(fd,data,length,dest);
 
   if(len > 0){
     sent_packets++;
@@ -196,8 +280,7 @@ bool UDP::send(const void *data,int length,const Address &dest)
 
 int UDP::recv(void *data,int length,Address &src)
 {
-  src.addr_len = sizeof(src.addr);
-  int len = recvfrom(fd,data,length,0,&src.addr,&src.addr_len);
+  int len = transport->recv(fd,data,length,src);
 
   if(len > 0){
     recv_packets++;
@@ -209,12 +292,7 @@ int UDP::recv(void *data,int length,Address &src)
 
 bool UDP::wait(int timeout_ms) const
 {
-  pollfd pfd;
-  pfd.fd = fd;
-  pfd.events = POLLIN;
-  pfd.revents = 0;
-
-  return(poll(&pfd,1,timeout_ms) == 1);
+  return(transport->wait(fd,timeout_ms));
 }
 
 }; // namespace Net
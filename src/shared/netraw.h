@@ -29,6 +29,7 @@ public:
 
   bool setHost(const char *hostname,int port);
   void setAny(int port=0);
+  void setInAddr(in_addr_t in_addr,int port);
 
   bool operator==(const Address &a) const
     {return(addr_len==a.addr_len && memcmp(&addr,&a.addr,addr_len)==0);}
@@ -40,10 +41,59 @@ public:
     {reset();}
 
   in_addr_t getInAddr() const;
+  int getPort() const;
 
   void print(FILE *out = stdout) const;
 
   friend class UDP;
+  friend class SocketTransport;
+};
+
+//====================================================================//
+//  Net::Transport: Datagram delivery used by Net::UDP
+//====================================================================//
+
+class Transport{
+public:
+  virtual ~Transport() {}
+
+  // Returns a handle to a new endpoint, or -1 on failure.
+  virtual int open(int port,bool share_port_for_multicasting,
+                   bool multicast_include_localhost,bool blocking) = 0;
+  virtual bool addMulticast(int handle,const Address &multiaddr,
+                            const Address &interface) = 0;
+  virtual void close(int handle) = 0;
+
+  // Return the number of bytes sent or received, or -1 on failure.
+  virtual int send(int handle,const void *data,int length,
+                   const Address &dest) = 0;
+  virtual int recv(int handle,void *data,int length,Address &src) = 0;
+
+  virtual bool wait(int handle,int timeout_ms) const = 0;
+
+  // Transport used by Net::UDP instances constructed without one. Sockets,
+  // unless changed by setDefault().
+  static Transport *getDefault();
+  static void setDefault(Transport *transport);
+};
+
+//====================================================================//
+//  Net::SocketTransport: Datagram delivery over UDP sockets
+//  (C) James Bruce
+//====================================================================//
+
+class SocketTransport : public Transport{
+public:
+  int open(int port,bool share_port_for_multicasting,
+           bool multicast_include_localhost,bool blocking);
+  bool addMulticast(int handle,const Address &multiaddr,
+                    const Address &interface);
+  void close(int handle);
+  int send(int handle,const void *data,int length,const Address &dest);
+  int recv(int handle,void *data,int length,Address &src);
+  bool wait(int handle,int timeout_ms) const;
+
+  static SocketTransport *instance();
 };
 
 //====================================================================//
@@ -52,6 +102,7 @@ public:
 //====================================================================//
 
 class UDP {
+  Transport *transport;
   int fd;
 public:
   unsigned sent_packets;
@@ -59,7 +110,8 @@ public:
   unsigned recv_packets;
   unsigned recv_bytes;
 public:
-  UDP() {fd=-1; close();}
+  UDP() {transport=Transport::getDefault(); fd=-1; close();}
+  explicit UDP(Transport *t) {transport=t; fd=-1; close();}
   ~UDP() {close();}
 
   bool open(int port = 0, bool share_port_for_multicasting=false, bool multicast_include_localhost=false, bool blocking=false);
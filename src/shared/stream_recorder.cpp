@@ -0,0 +1,60 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Recording of the datagrams of a stream to a log, as the logger does.
+
+#include "stream_recorder.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "log_writer.h"
+#include "pthread_utils.h"
+#include "trace.h"
+#include "udp_message_wrapper.pb.h"
+
+using std::string;
+
+StreamRecorder::StreamRecorder(const string& address,
+                               int port,
+                               LogWriter* writer,
+                               pthread_mutex_t* mutex) :
+    writer_(writer), mutex_(mutex) {
+  message_wrapper_.set_address(address);
+  message_wrapper_.set_port(port);
+}
+
+bool StreamRecorder::Record(const char* datagram,
+                            size_t size,
+                            uint64_t receive_timestamp) {
+  message_wrapper_.set_timestamp(receive_timestamp);
+  {
+    TRACE_SCOPE("serialize");
+    // Assign in place, set_data() would allocate a temporary string for
+    // every datagram.
+    message_wrapper_.mutable_data()->assign(datagram, size);
+    message_wrapper_.SerializeToString(&write_buffer_);
+  }
+  ScopedLock lock(*mutex_);
+  const bool success =
+      writer_->WriteRecord(write_buffer_.data(), write_buffer_.size());
+  TRACE_COUNTER("bytes_written", writer_->bytes_written());
+  return success;
+}
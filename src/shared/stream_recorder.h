@@ -0,0 +1,63 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Recording of the datagrams of a stream to a log, as the logger does.
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "udp_message_wrapper.pb.h"
+
+#ifndef STREAM_RECORDER_H_
+#define STREAM_RECORDER_H_
+
+class LogWriter;
+
+// Records the datagrams received from one address and port to a log. Every
+// datagram is wrapped in a UDPMessageWrapper with the address, port and
+// receive timestamp, and written under a mutex shared by the recorders of all
+// the streams of the log. The wrapper and the serialization buffer are
+// reused, so that recording does not allocate memory once the largest
+// datagram has been seen.
+class StreamRecorder {
+ public:
+  // The writer and the mutex must outlive the recorder.
+  StreamRecorder(const std::string& address,
+                 int port,
+                 LogWriter* writer,
+                 pthread_mutex_t* mutex);
+
+  // Record a datagram received at receive_timestamp, in microseconds. The
+  // timestamp is taken by the caller when the datagram is received, before
+  // the mutex is locked, so the records of different streams are not quite
+  // in order of time. Returns false on a write error.
+  bool Record(const char* datagram, size_t size, uint64_t receive_timestamp);
+
+  const std::string& address() const { return message_wrapper_.address(); }
+  int port() const { return message_wrapper_.port(); }
+
+ private:
+  LogWriter* const writer_;
+  pthread_mutex_t* const mutex_;
+  UDPMessageWrapper message_wrapper_;
+  std::string write_buffer_;
+};
+
+#endif  // STREAM_RECORDER_H_
@@ -0,0 +1,361 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Scoped trace spans and counters, written as a Chrome trace.
+
+#include "trace.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "misc_util.h"
+#include "pthread_utils.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+#ifndef ENABLE_TRACING
+
+bool StartTracing(const string& file_name) {
+  fprintf(stderr,
+          "Tracing was not compiled in, configure with "
+          "-DENABLE_TRACING=ON to trace to \"%s\"\n",
+          file_name.c_str());
+  return false;
+}
+
+bool StopTracing() {
+  return true;
+}
+
+#else  // ENABLE_TRACING
+
+// Returns the peak resident set size of the process, in kB.
+static long GetPeakRss() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+// Maximum number of events recorded per thread, later events are only
+// counted in the summary.
+static const size_t kMaxEventsPerThread = 1 << 20;
+
+// Spans shorter than this, in ns, are only counted in the summary, to keep
+// the trace of hot loops small.
+static const uint64_t kMinEventDuration = 10000;
+
+// Minimum interval between recorded values of a counter, in ns.
+static const uint64_t kCounterPeriod = 1000000;
+
+// Maximum nesting depth of spans whose nested time is tracked.
+static const int kMaxDepth = 64;
+
+// A span or counter value, in ns since the start of the trace.
+struct TraceEvent {
+  TraceEvent(const char* name,
+             uint64_t t,
+             uint64_t duration,
+             int64_t value,
+             bool counter) :
+      name(name), t(t), duration(duration), value(value), counter(counter) {}
+  const char* name;
+  uint64_t t;
+  uint64_t duration;
+  int64_t value;
+  bool counter;
+};
+
+// Time spent in a stage, in ns. The self time excludes nested spans.
+struct StageStats {
+  StageStats() : name(NULL), count(0), total_time(0), self_time(0) {}
+  const char* name;
+  uint64_t count;
+  uint64_t total_time;
+  uint64_t self_time;
+};
+
+struct CounterStats {
+  CounterStats() : name(NULL), max(0), t_last_event(0), has_event(false) {}
+  const char* name;
+  int64_t max;
+  uint64_t t_last_event;
+  bool has_event;
+};
+
+// Trace of a single thread. The nesting state is only used by the thread
+// itself, the rest is protected by the mutex, since StopTracing() may be
+// called while other threads are still running.
+struct ThreadTrace {
+  explicit ThreadTrace(int id) : id(id), depth(0), dropped_events(0) {
+    pthread_mutex_init(&mutex, NULL);
+  }
+
+  // Returns the stats of a stage, looked up by the address of its name.
+  StageStats* FindStage(const char* name) {
+    for (size_t i = 0; i < stages.size(); ++i) {
+      if (stages[i].name == name) return &(stages[i]);
+    }
+    stages.push_back(StageStats());
+    stages.back().name = name;
+    return &(stages.back());
+  }
+
+  CounterStats* FindCounter(const char* name) {
+    for (size_t i = 0; i < counters.size(); ++i) {
+      if (counters[i].name == name) return &(counters[i]);
+    }
+    counters.push_back(CounterStats());
+    counters.back().name = name;
+    return &(counters.back());
+  }
+
+  void AddEvent(const TraceEvent& event) {
+    if (events.size() < kMaxEventsPerThread) {
+      events.push_back(event);
+    } else {
+      ++dropped_events;
+    }
+  }
+
+  const int id;
+
+  // Time spent in the spans nested in the open spans, by nesting depth.
+  uint64_t nested_time[kMaxDepth];
+  int depth;
+
+  pthread_mutex_t mutex;
+  string name;
+  vector<TraceEvent> events;
+  vector<StageStats> stages;
+  vector<CounterStats> counters;
+  uint64_t dropped_events;
+};
+
+// Flag to record spans and counters, set between StartTracing() and
+// StopTracing(). Read by all threads, so only accessed atomically.
+static bool tracing_ = false;
+
+static bool IsTracing() {
+  return __atomic_load_n(&tracing_, __ATOMIC_ACQUIRE);
+}
+
+// Monotonic time of the start of the trace, in ns.
+static uint64_t t_trace_start_ = 0;
+
+static string trace_file_;
+
+// Traces of all threads that recorded anything, protected by trace_mutex_.
+// They are never freed, since threads may still use them after StopTracing().
+static pthread_mutex_t trace_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+static vector<ThreadTrace*> threads_;
+
+// Trace of the calling thread.
+static __thread ThreadTrace* thread_trace_ = NULL;
+
+static ThreadTrace* GetThreadTrace() {
+  if (thread_trace_ == NULL) {
+    ScopedLock lock(trace_mutex_);
+    thread_trace_ = new ThreadTrace(threads_.size() + 1);
+    threads_.push_back(thread_trace_);
+  }
+  return thread_trace_;
+}
+
+TraceSpan::TraceSpan(const char* name) :
+    thread_(NULL), name_(name), t_start_(0) {
+  if (!IsTracing()) return;
+  thread_ = GetThreadTrace();
+  if (thread_->depth < kMaxDepth) thread_->nested_time[thread_->depth] = 0;
+  ++thread_->depth;
+  t_start_ = GetMonotonicTimeNSec();
+}
+
+TraceSpan::~TraceSpan() {
+  if (thread_ == NULL) return;
+  const uint64_t duration = GetMonotonicTimeNSec() - t_start_;
+  ThreadTrace& trace = *thread_;
+  --trace.depth;
+  uint64_t self_time = duration;
+  if (trace.depth < kMaxDepth) {
+    self_time -= std::min(duration, trace.nested_time[trace.depth]);
+  }
+  if (trace.depth > 0 && trace.depth <= kMaxDepth) {
+    trace.nested_time[trace.depth - 1] += duration;
+  }
+  ScopedLock lock(trace.mutex);
+  StageStats* stage = trace.FindStage(name_);
+  ++stage->count;
+  stage->total_time += duration;
+  stage->self_time += self_time;
+  if (duration >= kMinEventDuration) {
+    trace.AddEvent(
+        TraceEvent(name_, t_start_ - t_trace_start_, duration, 0, false));
+  }
+}
+
+void TraceCounter(const char* name, int64_t value) {
+  if (!IsTracing()) return;
+  ThreadTrace& trace = *GetThreadTrace();
+  const uint64_t t = GetMonotonicTimeNSec() - t_trace_start_;
+  ScopedLock lock(trace.mutex);
+  CounterStats* counter = trace.FindCounter(name);
+  counter->max = counter->has_event ? std::max(counter->max, value) : value;
+  if (!counter->has_event || t >= counter->t_last_event + kCounterPeriod) {
+    trace.AddEvent(TraceEvent(name, t, 0, value, true));
+    counter->t_last_event = t;
+    counter->has_event = true;
+  }
+}
+
+void SetTraceThreadName(const string& name) {
+  if (!IsTracing()) return;
+  ThreadTrace& trace = *GetThreadTrace();
+  ScopedLock lock(trace.mutex);
+  trace.name = name;
+}
+
+bool StartTracing(const string& file_name) {
+  if (IsTracing()) return false;
+  // Fail early if the trace cannot be written.
+  ScopedFile fid(file_name, "w", true);
+  if (fid() == NULL) return false;
+  trace_file_ = file_name;
+  t_trace_start_ = GetMonotonicTimeNSec();
+  __atomic_store_n(&tracing_, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool StopTracing() {
+  if (!IsTracing()) return true;
+  __atomic_store_n(&tracing_, false, __ATOMIC_RELEASE);
+  const double duration = 1e-9 * (GetMonotonicTimeNSec() - t_trace_start_);
+  const long peak_rss = GetPeakRss();
+  ScopedFile fid(trace_file_, "w", true);
+  if (fid() == NULL) return false;
+  const int pid = getpid();
+  fprintf(fid,
+          "{\"displayTimeUnit\": \"ms\",\n"
+          "\"otherData\": {\"peak_rss_kb\": %ld},\n"
+          "\"traceEvents\": [\n"
+          "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+          "\"args\": {\"name\": \"%s\"}}",
+          peak_rss,
+          pid,
+          program_invocation_short_name);
+
+  // Stats of all threads, merged by name.
+  map<string, StageStats> stages;
+  map<string, int64_t> counter_max;
+  uint64_t num_events = 0;
+  uint64_t dropped_events = 0;
+  ScopedLock lock(trace_mutex_);
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    ThreadTrace& trace = *(threads_[i]);
+    ScopedLock thread_lock(trace.mutex);
+    if (!trace.name.empty()) {
+      fprintf(fid,
+              ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+              "\"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+              pid,
+              trace.id,
+              trace.name.c_str());
+    }
+    for (size_t j = 0; j < trace.events.size(); ++j) {
+      const TraceEvent& event = trace.events[j];
+      if (event.counter) {
+        fprintf(fid,
+                ",\n{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, "
+                "\"pid\": %d, \"tid\": %d, \"args\": {\"value\": %" PRId64 "}}",
+                event.name,
+                1e-3 * event.t,
+                pid,
+                trace.id,
+                event.value);
+      } else {
+        fprintf(fid,
+                ",\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                "\"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                event.name,
+                1e-3 * event.t,
+                1e-3 * event.duration,
+                pid,
+                trace.id);
+      }
+    }
+    num_events += trace.events.size();
+    dropped_events += trace.dropped_events;
+    for (size_t j = 0; j < trace.stages.size(); ++j) {
+      const StageStats& thread_stage = trace.stages[j];
+      StageStats& stage = stages[thread_stage.name];
+      stage.count += thread_stage.count;
+      stage.total_time += thread_stage.total_time;
+      stage.self_time += thread_stage.self_time;
+    }
+    for (size_t j = 0; j < trace.counters.size(); ++j) {
+      const CounterStats& counter = trace.counters[j];
+      map<string, int64_t>::iterator it = counter_max.find(counter.name);
+      if (it == counter_max.end()) {
+        counter_max[counter.name] = counter.max;
+      } else {
+        it->second = std::max(it->second, counter.max);
+      }
+    }
+  }
+  fprintf(fid, "\n]}\n");
+  const bool success = (ferror(fid) == 0);
+
+  printf("Trace written to %s, %" PRIu64 " events",
+         trace_file_.c_str(),
+         num_events);
+  if (dropped_events > 0) {
+    printf(", %" PRIu64 " events dropped", dropped_events);
+  }
+  printf("\nTraced %.3f s, peak RSS %.1f MB\n", duration, peak_rss / 1024.0);
+  printf("%-16s %12s %12s %12s %12s\n",
+         "Stage", "Count", "Total (ms)", "Self (ms)", "Mean (us)");
+  for (map<string, StageStats>::const_iterator it = stages.begin();
+       it != stages.end(); ++it) {
+    const StageStats& stage = it->second;
+    printf("%-16s %12" PRIu64 " %12.1f %12.1f %12.3f\n",
+           it->first.c_str(),
+           stage.count,
+           1e-6 * stage.total_time,
+           1e-6 * stage.self_time,
+           1e-3 * stage.total_time / stage.count);
+  }
+  for (map<string, int64_t>::const_iterator it = counter_max.begin();
+       it != counter_max.end(); ++it) {
+    printf("%-16s max %" PRId64 "\n", it->first.c_str(), it->second);
+  }
+  fflush(stdout);
+  return success;
+}
+
+#endif  // ENABLE_TRACING
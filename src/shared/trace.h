@@ -0,0 +1,84 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Scoped trace spans and counters of the main stages of the tools, written as
+// a Chrome trace (JSON), that chrome://tracing and Perfetto can open. Tracing
+// is compiled out unless ENABLE_TRACING is defined, see the ENABLE_TRACING
+// option in CMakeLists.txt.
+
+#include <stdint.h>
+
+#include <string>
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+// Start recording the spans and counters of all threads, to be written to
+// file_name by StopTracing(). Returns false if the file cannot be written, or
+// if tracing was not compiled in.
+bool StartTracing(const std::string& file_name);
+
+// Stop recording, write the trace file, and print the time spent in every
+// stage and the peak resident set size. Returns false on write errors. Does
+// nothing if tracing was not started.
+bool StopTracing();
+
+#ifdef ENABLE_TRACING
+
+struct ThreadTrace;
+
+// Span of time spent in a stage, from construction to destruction. Spans may
+// be nested, the summary reports the time of every stage both including and
+// excluding the spans nested in it. The name must be a string literal.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name);
+  ~TraceSpan();
+
+ private:
+  // Disable copy constructor.
+  TraceSpan(const TraceSpan&);
+
+  // Trace of the calling thread, or NULL if tracing was not started.
+  ThreadTrace* thread_;
+  const char* name_;
+  uint64_t t_start_;
+};
+
+// Record the value of a counter. The name must be a string literal.
+void TraceCounter(const char* name, int64_t value);
+
+// Name the calling thread in the trace.
+void SetTraceThreadName(const std::string& name);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) \
+    TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_COUNTER(name, value) TraceCounter(name, value)
+#define TRACE_THREAD_NAME(name) SetTraceThreadName(name)
+
+#else  // ENABLE_TRACING
+
+#define TRACE_SCOPE(name)
+#define TRACE_COUNTER(name, value)
+#define TRACE_THREAD_NAME(name)
+
+#endif  // ENABLE_TRACING
+
+#endif  // TRACE_H_
@@ -0,0 +1,101 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Decoder of SSL-Vision packets, which caches the field geometry.
+
+#include "shared/vision_decoder.h"
+
+#include <stdint.h>
+
+#include "messages_robocup_ssl_detection.pb.h"
+#include "messages_robocup_ssl_geometry.pb.h"
+#include "shared/misc_util.h"
+#include "shared/wire_decoder.h"
+
+namespace {
+
+// Field numbers of SSL_WrapperPacket.
+const uint32_t kDetectionField = 1;
+const uint32_t kGeometryField = 2;
+
+}  // namespace
+
+VisionDecoder::VisionDecoder() {
+  Reset();
+}
+
+void VisionDecoder::Reset() {
+  has_detection_ = false;
+  geometry_.Clear();
+  has_geometry_ = false;
+  geometry_changed_ = false;
+  geometry_hash_ = 0;
+  geometry_size_ = 0;
+  num_geometry_packets_ = 0;
+  num_geometry_parses_ = 0;
+}
+
+bool VisionDecoder::Decode(const char* data, size_t size) {
+  has_detection_ = false;
+  geometry_changed_ = false;
+  const char* ptr = data;
+  const char* const end = data + size;
+  const char* detection = NULL;
+  size_t detection_size = 0;
+  const char* geometry = NULL;
+  size_t geometry_size = 0;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    if (field == kDetectionField && wire_type == kWireLengthDelimited) {
+      if (!ReadLengthDelimited(&ptr, end, &detection, &detection_size)) {
+        return false;
+      }
+    } else if (field == kGeometryField && wire_type == kWireLengthDelimited) {
+      if (!ReadLengthDelimited(&ptr, end, &geometry, &geometry_size)) {
+        return false;
+      }
+    } else if (!SkipField(&ptr, end, wire_type)) {
+      return false;
+    }
+  }
+  if (geometry != NULL) {
+    ++num_geometry_packets_;
+    const uint64_t hash = Hash64(geometry, geometry_size);
+    if (!has_geometry_ ||
+        hash != geometry_hash_ ||
+        geometry_size != geometry_size_) {
+      if (!geometry_.ParseFromArray(geometry, geometry_size)) {
+        geometry_.Clear();
+        has_geometry_ = false;
+        return false;
+      }
+      ++num_geometry_parses_;
+      has_geometry_ = true;
+      geometry_changed_ = true;
+      geometry_hash_ = hash;
+      geometry_size_ = geometry_size;
+    }
+  }
+  if (detection != NULL) {
+    if (!detection_.ParseFromArray(detection, detection_size)) return false;
+    has_detection_ = true;
+  }
+  return true;
+}
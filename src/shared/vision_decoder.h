@@ -0,0 +1,81 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Decoder of SSL-Vision packets, which caches the field geometry.
+
+#include <stdint.h>
+
+#include "messages_robocup_ssl_detection.pb.h"
+#include "messages_robocup_ssl_geometry.pb.h"
+
+#ifndef VISION_DECODER_H_
+#define VISION_DECODER_H_
+
+// Decoder of serialized SSL_WrapperPackets. SSL-Vision sends the same field
+// geometry over and over, so the geometry is only parsed when its serialized
+// bytes change, detected by a 64-bit hash of them, and the parsed geometry is
+// kept until then. Decoding reuses the same messages, so that it does not
+// allocate memory once the largest packets have been seen.
+class VisionDecoder {
+ public:
+  VisionDecoder();
+
+  // Forget the geometry, and the counts of geometry packets.
+  void Reset();
+
+  // Decode a serialized SSL_WrapperPacket. Returns false if the packet is
+  // malformed, in which case the detection is invalid.
+  bool Decode(const char* data, size_t size);
+
+  // Returns true iff the last packet decoded had a detection frame.
+  bool has_detection() const { return has_detection_; }
+
+  // The detection frame of the last packet decoded.
+  const SSL_DetectionFrame& detection() const { return detection_; }
+
+  // Returns true iff any packet decoded so far had a geometry.
+  bool has_geometry() const { return has_geometry_; }
+
+  // Returns true iff the last packet decoded had a geometry different from
+  // the previous one.
+  bool geometry_changed() const { return geometry_changed_; }
+
+  // The latest geometry decoded.
+  const SSL_GeometryData& geometry() const { return geometry_; }
+
+  // Number of packets with a geometry, and number of geometries parsed.
+  uint64_t num_geometry_packets() const { return num_geometry_packets_; }
+  uint64_t num_geometry_parses() const { return num_geometry_parses_; }
+
+ private:
+  SSL_DetectionFrame detection_;
+  bool has_detection_;
+
+  SSL_GeometryData geometry_;
+  bool has_geometry_;
+  bool geometry_changed_;
+
+  // Hash and size of the serialized geometry.
+  uint64_t geometry_hash_;
+  size_t geometry_size_;
+
+  uint64_t num_geometry_packets_;
+  uint64_t num_geometry_parses_;
+};
+
+#endif  // VISION_DECODER_H_
@@ -0,0 +1,348 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Minimal decoders of the protobuf wire format, to read a few fields of
+// serialized messages without parsing them completely or allocating memory.
+
+#include "wire_decoder.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "referee.pb.h"
+
+namespace {
+
+// Maximum nesting depth of unknown groups, the recursion limit of the
+// protobuf parser.
+const int kMaxGroupDepth = 100;
+
+// Returns the bit of a field in a bit mask of field numbers below 32.
+uint32_t FieldBit(uint32_t field_number) {
+  return (field_number < 32) ? (1u << field_number) : 0;
+}
+
+// Advances *ptr past the value of a field that is skipped as unknown. Unlike
+// SkipField(), this skips groups, up to their matching end-group tag.
+bool SkipUnknownField(const char** ptr,
+                      const char* end,
+                      uint32_t field_number,
+                      uint32_t wire_type,
+                      int depth) {
+  if (wire_type != kWireStartGroup) return SkipField(ptr, end, wire_type);
+  if (depth >= kMaxGroupDepth) return false;
+  while (*ptr < end) {
+    uint32_t field = 0;
+    uint32_t type = 0;
+    if (!ReadTag(ptr, end, &field, &type)) return false;
+    if (type == kWireEndGroup) return (field == field_number);
+    if (!SkipUnknownField(ptr, end, field, type, depth + 1)) return false;
+  }
+  return false;
+}
+
+// Validates a serialized SSL_Referee.TeamInfo, adds the fields it sets to the
+// bit mask *fields, and sets *name to its name if it has one.
+bool DecodeTeamInfo(const char* data,
+                    size_t size,
+                    uint32_t* fields,
+                    const char** name,
+                    size_t* name_size) {
+  // Field numbers of SSL_Referee.TeamInfo, all uint32 but the name and the
+  // repeated yellow card times.
+  static const uint32_t kNameField = 1;
+  static const uint32_t kYellowCardTimesField = 4;
+  static const uint32_t kGoalieField = 8;
+  const char* ptr = data;
+  const char* const end = data + size;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    const char* value_data = NULL;
+    size_t value_size = 0;
+    uint64_t value = 0;
+    if (field == kNameField && wire_type == kWireLengthDelimited) {
+      if (!ReadLengthDelimited(&ptr, end, name, name_size)) return false;
+    } else if (field == kYellowCardTimesField &&
+               wire_type == kWireLengthDelimited) {
+      // Packed varints.
+      if (!ReadLengthDelimited(&ptr, end, &value_data, &value_size)) {
+        return false;
+      }
+      const char* const value_end = value_data + value_size;
+      while (value_data < value_end) {
+        if (!ReadVarint(&value_data, value_end, &value)) return false;
+      }
+    } else if (field > kNameField && field <= kGoalieField &&
+               wire_type == kWireVarint) {
+      if (!ReadVarint(&ptr, end, &value)) return false;
+    } else {
+      if (!SkipUnknownField(&ptr, end, field, wire_type, 1)) return false;
+      continue;
+    }
+    *fields |= FieldBit(field);
+  }
+  return true;
+}
+
+// Validates a serialized SSL_Referee.Point, and adds the fields it sets to
+// the bit mask *fields.
+bool DecodePoint(const char* data, size_t size, uint32_t* fields) {
+  // Field numbers of SSL_Referee.Point, both floats.
+  static const uint32_t kXField = 1;
+  static const uint32_t kYField = 2;
+  const char* ptr = data;
+  const char* const end = data + size;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    if ((field == kXField || field == kYField) && wire_type == kWireFixed32) {
+      if (!SkipField(&ptr, end, wire_type)) return false;
+      *fields |= FieldBit(field);
+    } else if (!SkipUnknownField(&ptr, end, field, wire_type, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Find the detection frame of a serialized SSL_WrapperPacket. Returns false
+// if the packet is malformed or has no detection frame.
+bool FindDetection(const char* packet,
+                   size_t size,
+                   const char** detection,
+                   size_t* detection_size) {
+  // Field number of SSL_WrapperPacket.detection.
+  static const uint32_t kDetectionField = 1;
+  const char* ptr = packet;
+  const char* const end = packet + size;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    if (field == kDetectionField && wire_type == kWireLengthDelimited) {
+      return ReadLengthDelimited(&ptr, end, detection, detection_size);
+    } else if (!SkipField(&ptr, end, wire_type)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool DecodeEnvelope(const char* record, size_t size, EnvelopeView* view) {
+  // Field numbers of UDPMessageWrapper, see udp_message_wrapper.proto.
+  static const uint32_t kAddressField = 1;
+  static const uint32_t kPortField = 2;
+  static const uint32_t kTimestampField = 3;
+  static const uint32_t kDataField = 4;
+  *view = EnvelopeView();
+  const char* ptr = record;
+  const char* const end = record + size;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    uint64_t value = 0;
+    if (field == kAddressField && wire_type == kWireLengthDelimited) {
+      if (!ReadLengthDelimited(
+          &ptr, end, &view->address, &view->address_size)) {
+        return false;
+      }
+    } else if (field == kPortField && wire_type == kWireVarint) {
+      if (!ReadVarint(&ptr, end, &value)) return false;
+      view->port = static_cast<int32_t>(value);
+    } else if (field == kTimestampField && wire_type == kWireVarint) {
+      if (!ReadVarint(&ptr, end, &value)) return false;
+      view->timestamp = value;
+    } else if (field == kDataField && wire_type == kWireLengthDelimited) {
+      if (!ReadLengthDelimited(&ptr, end, &view->data, &view->data_size)) {
+        return false;
+      }
+    } else if (!SkipUnknownField(&ptr, end, field, wire_type, 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DecodeVisionCameraId(const char* packet,
+                          size_t size,
+                          uint32_t* camera_id) {
+  // Field number of SSL_DetectionFrame.camera_id.
+  static const uint32_t kCameraIdField = 4;
+  const char* detection = NULL;
+  size_t detection_size = 0;
+  if (!FindDetection(packet, size, &detection, &detection_size)) return false;
+  const char* ptr = detection;
+  const char* const detection_end = detection + detection_size;
+  while (ptr < detection_end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, detection_end, &field, &wire_type)) return false;
+    if (field == kCameraIdField && wire_type == kWireVarint) {
+      uint64_t value = 0;
+      if (!ReadVarint(&ptr, detection_end, &value)) return false;
+      *camera_id = static_cast<uint32_t>(value);
+      return true;
+    } else if (!SkipField(&ptr, detection_end, wire_type)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool DecodeVisionFrame(const char* packet,
+                       size_t size,
+                       VisionFrameView* view) {
+  // Field numbers of SSL_DetectionFrame.
+  static const uint32_t kFrameNumberField = 1;
+  static const uint32_t kCaptureTimeField = 2;
+  static const uint32_t kSendTimeField = 3;
+  static const uint32_t kCameraIdField = 4;
+  static const uint32_t kRequiredFields =
+      FieldBit(kFrameNumberField) | FieldBit(kCaptureTimeField) |
+      FieldBit(kSendTimeField) | FieldBit(kCameraIdField);
+  *view = VisionFrameView();
+  const char* detection = NULL;
+  size_t detection_size = 0;
+  if (!FindDetection(packet, size, &detection, &detection_size)) return false;
+  uint32_t fields = 0;
+  const char* ptr = detection;
+  const char* const detection_end = detection + detection_size;
+  while (ptr < detection_end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, detection_end, &field, &wire_type)) return false;
+    uint64_t value = 0;
+    if ((field == kFrameNumberField || field == kCameraIdField) &&
+        wire_type == kWireVarint) {
+      if (!ReadVarint(&ptr, detection_end, &value)) return false;
+      if (field == kFrameNumberField) {
+        view->frame_number = static_cast<uint32_t>(value);
+      } else {
+        view->camera_id = static_cast<uint32_t>(value);
+      }
+    } else if ((field == kCaptureTimeField || field == kSendTimeField) &&
+               wire_type == kWireFixed64) {
+      if (detection_end - ptr < 8) return false;
+      double time = 0.0;
+      memcpy(&time, ptr, sizeof(time));
+      ptr += sizeof(time);
+      if (field == kCaptureTimeField) {
+        view->t_capture = time;
+      } else {
+        view->t_sent = time;
+      }
+    } else if (!SkipField(&ptr, detection_end, wire_type)) {
+      return false;
+    } else {
+      continue;
+    }
+    fields |= FieldBit(field);
+  }
+  return ((fields & kRequiredFields) == kRequiredFields);
+}
+
+bool DecodeReferee(const char* packet, size_t size, RefereeView* view) {
+  // Field numbers of SSL_Referee, see referee.proto.
+  static const uint32_t kPacketTimestampField = 1;
+  static const uint32_t kStageField = 2;
+  static const uint32_t kCommandField = 4;
+  static const uint32_t kCommandCounterField = 5;
+  static const uint32_t kCommandTimestampField = 6;
+  static const uint32_t kYellowField = 7;
+  static const uint32_t kBlueField = 8;
+  static const uint32_t kDesignatedPositionField = 9;
+  static const uint32_t kRequiredFields =
+      FieldBit(kPacketTimestampField) | FieldBit(kStageField) |
+      FieldBit(kCommandField) | FieldBit(kCommandCounterField) |
+      FieldBit(kCommandTimestampField) | FieldBit(kYellowField) |
+      FieldBit(kBlueField);
+  // Required fields of SSL_Referee.TeamInfo and SSL_Referee.Point.
+  static const uint32_t kTeamInfoRequiredFields =
+      FieldBit(1) | FieldBit(2) | FieldBit(3) | FieldBit(5) | FieldBit(6) |
+      FieldBit(7) | FieldBit(8);
+  static const uint32_t kPointRequiredFields = FieldBit(1) | FieldBit(2);
+
+  *view = RefereeView();
+  // Fields set in the message, and in its nested messages. Nested messages
+  // that occur several times are merged.
+  uint32_t fields = 0;
+  uint32_t yellow_fields = 0;
+  uint32_t blue_fields = 0;
+  uint32_t position_fields = 0;
+  const char* ptr = packet;
+  const char* const end = packet + size;
+  while (ptr < end) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    if (!ReadTag(&ptr, end, &field, &wire_type)) return false;
+    if (field >= kPacketTimestampField && field <= kCommandTimestampField &&
+        wire_type == kWireVarint) {
+      uint64_t value = 0;
+      if (!ReadVarint(&ptr, end, &value)) return false;
+      const int enum_value = static_cast<int>(value);
+      if (field == kPacketTimestampField) {
+        view->packet_timestamp = value;
+      } else if (field == kStageField) {
+        // Invalid enum values are kept as unknown fields by the parser.
+        if (!SSL_Referee_Stage_IsValid(enum_value)) continue;
+        view->stage = static_cast<SSL_Referee_Stage>(enum_value);
+      } else if (field == kCommandField) {
+        if (!SSL_Referee_Command_IsValid(enum_value)) continue;
+        view->command = static_cast<SSL_Referee_Command>(enum_value);
+      } else if (field == kCommandCounterField) {
+        view->command_counter = static_cast<uint32_t>(value);
+      } else if (field == kCommandTimestampField) {
+        view->command_timestamp = value;
+      }
+      fields |= FieldBit(field);
+    } else if (field >= kYellowField && field <= kDesignatedPositionField &&
+               wire_type == kWireLengthDelimited) {
+      const char* data = NULL;
+      size_t data_size = 0;
+      if (!ReadLengthDelimited(&ptr, end, &data, &data_size)) return false;
+      if (field == kYellowField) {
+        if (!DecodeTeamInfo(data, data_size, &yellow_fields,
+                            &view->yellow_name, &view->yellow_name_size)) {
+          return false;
+        }
+      } else if (field == kBlueField) {
+        if (!DecodeTeamInfo(data, data_size, &blue_fields,
+                            &view->blue_name, &view->blue_name_size)) {
+          return false;
+        }
+      } else if (!DecodePoint(data, data_size, &position_fields)) {
+        return false;
+      }
+      fields |= FieldBit(field);
+    } else if (!SkipUnknownField(&ptr, end, field, wire_type, 0)) {
+      return false;
+    }
+  }
+  return ((fields & kRequiredFields) == kRequiredFields &&
+          (yellow_fields & kTeamInfoRequiredFields) ==
+              kTeamInfoRequiredFields &&
+          (blue_fields & kTeamInfoRequiredFields) == kTeamInfoRequiredFields &&
+          ((fields & FieldBit(kDesignatedPositionField)) == 0 ||
+           (position_fields & kPointRequiredFields) == kPointRequiredFields));
+}
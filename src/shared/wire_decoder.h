@@ -0,0 +1,206 @@
+//========================================================================
+//  This software is free: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License Version 3,
+//  as published by the Free Software Foundation.
+//
+//  This software is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  Version 3 in the file COPYING that came with this distribution.
+//  If not, see <http://www.gnu.org/licenses/>.
+//========================================================================
+// Copyright 2016 joydeepb@cs.umass.edu
+// College of Information and Computer Sciences
+// University of Massachusetts Amherst
+//
+// Minimal decoders of the protobuf wire format, to read a few fields of
+// serialized messages without parsing them completely or allocating memory.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include "referee.pb.h"
+
+#ifndef WIRE_DECODER_H_
+#define WIRE_DECODER_H_
+
+// Protobuf wire types.
+enum WireType {
+  kWireVarint = 0,
+  kWireFixed64 = 1,
+  kWireLengthDelimited = 2,
+  kWireStartGroup = 3,
+  kWireEndGroup = 4,
+  kWireFixed32 = 5
+};
+
+// Reads a base-128 varint at *ptr and advances *ptr past it. Returns false if
+// the varint is truncated or longer than 10 bytes.
+inline bool ReadVarint(const char** ptr, const char* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *ptr < end; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(*((*ptr)++));
+    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads a field tag at *ptr and advances *ptr past it. As in the protobuf
+// parser, tags are at most 5 bytes, and truncated to 32 bits.
+inline bool ReadTag(const char** ptr,
+                    const char* end,
+                    uint32_t* field_number,
+                    uint32_t* wire_type) {
+  const char* const start = *ptr;
+  uint64_t varint = 0;
+  if (!ReadVarint(ptr, end, &varint) || *ptr - start > 5) return false;
+  const uint32_t tag = static_cast<uint32_t>(varint);
+  *field_number = (tag >> 3);
+  *wire_type = (tag & 0x7);
+  return (*field_number != 0);
+}
+
+// Reads the length prefix of a length-delimited field at *ptr, and advances
+// *ptr past it. *data is set to the start of the field contents. As in the
+// protobuf parser, lengths must fit in 31 bits and at most 5 bytes.
+inline bool ReadLengthDelimited(const char** ptr,
+                                const char* end,
+                                const char** data,
+                                size_t* size) {
+  const char* const start = *ptr;
+  uint64_t length = 0;
+  if (!ReadVarint(ptr, end, &length) || *ptr - start > 5 ||
+      length > 0x7FFFFFFF) {
+    return false;
+  }
+  if (length > static_cast<uint64_t>(end - *ptr)) return false;
+  *data = *ptr;
+  *size = static_cast<size_t>(length);
+  *ptr += length;
+  return true;
+}
+
+// Advances *ptr past the value of a field of the given wire type. Groups are
+// not supported.
+inline bool SkipField(const char** ptr, const char* end, uint32_t wire_type) {
+  switch (wire_type) {
+    case kWireVarint: {
+      uint64_t value = 0;
+      return ReadVarint(ptr, end, &value);
+    }
+    case kWireFixed64: {
+      if (end - *ptr < 8) return false;
+      *ptr += 8;
+      return true;
+    }
+    case kWireLengthDelimited: {
+      const char* data = NULL;
+      size_t size = 0;
+      return ReadLengthDelimited(ptr, end, &data, &size);
+    }
+    case kWireFixed32: {
+      if (end - *ptr < 4) return false;
+      *ptr += 4;
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// View of a serialized UDPMessageWrapper. The pointers point into the
+// serialized record, and are only valid as long as it is.
+struct EnvelopeView {
+  EnvelopeView() :
+      address(NULL), address_size(0), port(0), timestamp(0),
+      data(NULL), data_size(0) {}
+
+  // Returns true iff the address of the envelope is the given string.
+  bool AddressIs(const char* other) const {
+    return (strlen(other) == address_size &&
+            memcmp(address, other, address_size) == 0);
+  }
+
+  // Returns the address as a string.
+  std::string Address() const {
+    return std::string(address, address_size);
+  }
+
+  const char* address;
+  size_t address_size;
+  int32_t port;
+  uint64_t timestamp;
+  const char* data;
+  size_t data_size;
+};
+
+// Decode the fields of a serialized UDPMessageWrapper. Accepts exactly the
+// records that UDPMessageWrapper::ParseFromArray() accepts. Returns false if
+// the record is malformed.
+bool DecodeEnvelope(const char* record, size_t size, EnvelopeView* view);
+
+// Decode the camera_id of the detection frame of a serialized
+// SSL_WrapperPacket. Returns false if the packet is malformed or has no
+// detection frame.
+bool DecodeVisionCameraId(const char* packet, size_t size, uint32_t* camera_id);
+
+// Fields of the detection frame of a serialized SSL_WrapperPacket, other than
+// the detections.
+struct VisionFrameView {
+  VisionFrameView() :
+      frame_number(0), t_capture(0.0), t_sent(0.0), camera_id(0) {}
+
+  uint32_t frame_number;
+  double t_capture;
+  double t_sent;
+  uint32_t camera_id;
+};
+
+// Decode the frame number, capture and send times, and camera id of the
+// detection frame of a serialized SSL_WrapperPacket, without the detections.
+// Returns false if the packet is malformed, or has no detection frame with
+// all of these fields.
+bool DecodeVisionFrame(const char* packet,
+                       size_t size,
+                       VisionFrameView* view);
+
+// The fields of an SSL_Referee message that identify its command, and the
+// team names, decoded without parsing the rest of the team infos. The names
+// point into the message, and are only valid as long as it is.
+struct RefereeView {
+  RefereeView() :
+      packet_timestamp(0), stage(SSL_Referee_Stage_NORMAL_FIRST_HALF_PRE),
+      command(SSL_Referee_Command_HALT), command_counter(0),
+      command_timestamp(0), yellow_name(NULL), yellow_name_size(0),
+      blue_name(NULL), blue_name_size(0) {}
+
+  uint64_t packet_timestamp;
+  SSL_Referee_Stage stage;
+  SSL_Referee_Command command;
+  uint32_t command_counter;
+  uint64_t command_timestamp;
+  const char* yellow_name;
+  size_t yellow_name_size;
+  const char* blue_name;
+  size_t blue_name_size;
+};
+
+// Decode a serialized SSL_Referee message, without allocating memory. The
+// whole message is validated, so that this accepts exactly the messages that
+// SSL_Referee::ParseFromArray() accepts, with the same values of the decoded
+// fields: the wire format of all fields and nested messages, required
+// fields, enum values, and unknown fields including groups. Returns false if
+// the message is malformed.
+bool DecodeReferee(const char* packet, size_t size, RefereeView* view);
+
+#endif  // WIRE_DECODER_H_